@@ -0,0 +1,16 @@
+# writes every *.glsl of SHADER_DIR as one entry of the table in src/shaders.cpp:
+#   cmake -DSHADER_DIR=<dir> -DOUTPUT=<file> -P EmbedShaders.cmake
+file(GLOB shaders RELATIVE ${SHADER_DIR} ${SHADER_DIR}/*.glsl)
+list(SORT shaders)
+set(table "// generated from ${SHADER_DIR} by cmake/EmbedShaders.cmake, do not edit\n")
+foreach(shader ${shaders})
+    file(READ ${SHADER_DIR}/${shader} source)
+    string(APPEND table "{ \"${shader}\", R\"glsl(${source})glsl\" },\n")
+endforeach()
+# only touched when the sources changed, so nothing is rebuilt otherwise
+if(EXISTS ${OUTPUT})
+    file(READ ${OUTPUT} previous)
+endif()
+if(NOT "${previous}" STREQUAL "${table}")
+    file(WRITE ${OUTPUT} "${table}")
+endif()
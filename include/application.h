@@ -5,11 +5,23 @@
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
 #include <filesystem>
-
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include "stb_image_write.h"
+#include <chrono>
+#include <future>
+#include <optional>
 
 #include "utilities.h"
+#include "bvh.h"
+#include "capture.h"
+#include "colorbar.h"
+#include "lod.h"
+#include "parallel.h"
+#include "streaming.h"
+#include "playback.h"
+#include "resources.h"
+#include "shadowing.h"
+
+// after glad, which must come before any other GL header
+#include <GLFW/glfw3.h>
 
 class SpacecraftRenderingTools{
 
@@ -29,22 +41,39 @@ public:
             std::string path = std::filesystem::current_path().string();
             std::strncpy(pathToFolder_.data(), path.c_str(), pathToFolder_.size() - 1);
             pathToFolder_[pathToFolder_.size() - 1] = '\0';
+            std::strncpy(profilePath_.data(), "profile.csv", profilePath_.size() - 1);
 
         };
 
     void init( );
     void mainLoop( );
     void updateRender( );
-    void loadMesh( std::string pathToMesh );
+    // temperatures of a text mesh come from the companion file, if given
+    void loadMesh( std::string pathToMesh, std::string pathToTemperature = "" );
+    void loadBinaryMesh( std::string pathToMesh );
+    void printMemoryFootprint( );
+    // out-of-core mode, keeps at most cacheCapacity timesteps in memory. With
+    // compress the whole dataset is held compressed in memory and decoded from there
+    void openMeshStreaming( std::string pathToMesh, int cacheCapacity, std::string pathToTemperature = "", bool compress = false );
+    // another result set on the mesh of the loaded dataset, drawn side by side
+    // with it. Cases are streamed through their own cache and share the geometry
+    // of the first dataset, so only their attributes add to memory and uploads
+    void addCase( std::string pathToMesh, std::string pathToTemperature = "" );
+    // shaders read from this directory instead of the executable and relinked
+    // whenever a file changes
+    void useShaderDirectory( std::string directory );
+    // schedules frames after input, called from the GLFW callbacks
+    void requestRedraw( int frames = 3 ){ redrawFrames_ = std::max( redrawFrames_, frames ); }
 
 
 private:
 
     GLFWwindow* window_;
-    std::map< float, MeshData > spacecraftData_;
+    std::vector< MeshData > spacecraftData_;
+    TimeIndex timeIndex_;
     int timeSteps_;
-    std::vector< float > times_;
     int numberOfTriangles_;
+    bool sharedGeometry_ = true;
     int windowWidth_;
     int windowHeight_;
     Renderer renderer_;
@@ -53,14 +82,125 @@ private:
     float backgroundColor_[4] = {1.0f, 1.0f, 1.0f, 1.0f};
     float time_;
 
-    // colorbar
-    float temperatureMax_;
-    float temperatureMin_;
-    float xColorbar_ = 0.35f;
-    float yColorbar_ = 0.1f;
-    int verticalColorbar_ = 0;
-    float sizeColorbar_ = 2.0f;
-    float fontSize_ = 15.0f;
+    // streaming
+    std::unique_ptr< TimestepCache > timestepCache_;
+    std::shared_ptr< const MeshData > currentStep_;
+    std::shared_ptr< const MeshData > nextStep_;
+    int currentIndex_ = -1;
+    int cacheCapacity_ = 64;
+    int scrubDirection_ = 1;
+
+    // timesteps around the slider position
+    struct Frame{
+        const MeshData* lower_;
+        const MeshData* upper_;
+        float weight_;
+    };
+    bool interpolate_ = false;
+    Frame currentFrame( );
+    void renderMesh( );
+
+    // comparison, every case maps the shared time cursor onto its own timesteps
+    struct ComparisonCase{
+        std::string name_;
+        std::unique_ptr< TimestepCache > cache_;
+        TimeIndex timeIndex_;
+        RangeStatistics temperatureStatistics_;
+        int currentIndex_ = -1;
+        std::shared_ptr< const MeshData > currentStep_;
+        std::shared_ptr< const MeshData > nextStep_;
+    };
+    std::vector< ComparisonCase > cases_;
+    int caseCacheCapacity_ = 16;
+    // an extra viewport with the first dataset minus the case differenceCase_
+    bool differenceView_ = false;
+    int differenceCase_ = 0;
+    float shadowDifferenceRange_ = 0.5f;
+    float temperatureDifferenceRange_ = 20.0f;   // kelvin
+    Frame caseFrame( ComparisonCase& comparison );
+    void renderCases( const Frame& frame );
+    void drawComparisonControls( );
+
+    // playback
+    Playback playback_;
+    std::unique_ptr< TimestepStager > stager_;
+    void updatePlayback( );
+    void drawPlaybackControls( );
+    void stepTime( int direction );
+    std::shared_ptr< const MeshData > residentStep( int position );
+    bool isReady( int position );
+    void stageTimestep( int position );
+
+    // colorbar, temperature ranges are computed once while loading
+    RangeStatistics temperatureStatistics_;
+    RangeMode temperatureRangeMode_ = RangeMode::GLOBAL;
+    bool hasTemperature_ = false;
+    void scanTemperatures( );
+    ValueRange temperatureRange( ) const;
+    Colorbar colorbar_;
+    std::vector<char> colormapPath_ = std::vector<char>( 256, '\0' );
+    void drawColormapControls( );
+
+    // largest error of the compact vertex format on the displayed timestep
+    QuantizationError quantizationError_;
+    void measureQuantization( );
+
+    // picking, the BVH follows the geometry of the displayed timestep
+    std::shared_ptr< const TriangleBVH > bvh_;
+    double bvhSeconds_ = 0.0;
+    bool hoverPicking_ = true;
+    bool pickRequested_ = false;
+    double pressX_ = 0.0;
+    double pressY_ = 0.0;
+    RayHit hover_;
+    float hoverShadow_ = 0.0f;
+    float hoverTemperature_ = 0.0f;
+    double pickMilliseconds_ = 0.0;
+    // values of the selected triangle at every sorted timestep
+    int selectedTriangle_ = -1;
+    std::vector< float > historyShadow_;
+    std::vector< float > historyTemperature_;
+    double historySeconds_ = 0.0;
+    void updateBVH( const MeshData& mesh );
+    // viewport is x, y, width and height in window coordinates
+    void updatePicking( const Frame& frame, const glm::mat4& projection, const glm::vec4& viewport );
+    void loadHistory( int triangle );
+    void drawPicking( );
+
+    // self-shadowing of the displayed timestep ray traced on the CPU with the
+    // picking BVH, for the sun of the timestep or one set in the panel. Traces
+    // run in the background, the last finished one is shown meanwhile
+    bool traceShadows_ = false;
+    bool customSun_ = false;
+    float sunAzimuth_ = 0.0f;      // degrees from body +x towards +y
+    float sunElevation_ = 30.0f;   // degrees above the body x-y plane
+    // traced minus dataset shadow, to check the external results
+    bool tracedDifference_ = false;
+    ShadowSettings shadowSettings_;
+    struct TraceRequest{
+        uint64_t revision_ = 0;
+        glm::vec3 sun_ = glm::vec3( 0.0f );
+        int subdivisions_ = 0;
+        bool backFacesShadowed_ = true;
+        bool operator==( const TraceRequest& other ) const;
+    };
+    TraceRequest traceRequest_;   // inputs of the running or last trace
+    struct TraceResult{
+        std::shared_ptr< const MeshData > mesh_;
+        double seconds_;
+    };
+    std::future< TraceResult > shadowTrace_;
+    std::shared_ptr< const MeshData > tracedStep_;
+    double traceSeconds_ = 0.0;
+    glm::vec3 traceSun( const MeshData& mesh ) const;
+    const MeshData* updateShadowTrace( const MeshData& mesh );
+    void drawShadowControls( );
+
+    // simplified levels of the geometry, built in the background after loading.
+    // Smaller meshes are always drawn in full
+    std::future< std::shared_ptr< const LevelsOfDetail > > lodBuild_;
+    int lodMinimumTriangles_ = 100000;
+    void startLodBuild( );
 
     // Arcball Camera
     float cameraDistance_ = 100.0f;
@@ -95,12 +235,65 @@ private:
     // helpers
     void setMode( int mode );
     void drawColorbar( );
-    void drawColorbarVertical( );
-    void drawColorbarHorizontal( );
 
-    // screenshot
+    // profiler
+    FrameProfiler profiler_;
+    std::vector<char> profilePath_ = std::vector<char>( 256, '\0' );
+    std::string datasetPath_;
+    void drawProfiler( );
+
+    // on-demand rendering, frames are only drawn when the view changed, while
+    // input is handled, or while playback or recording need a stream of frames
+    struct ViewState{
+        glm::quat rotation_;
+        glm::vec3 panOffset_;
+        float cameraDistance_;
+        float time_;
+        bool interpolate_;
+        VisualizationMode visualizationMode_;
+        RangeMode temperatureRangeMode_;
+        int shadowColormap_;
+        int temperatureColormap_;
+        bool wireFrameOverlay_;
+        bool singlePassOverlay_;
+        bool levelOfDetail_;
+        float lodPixelError_;
+        bool differenceView_;
+        int differenceCase_;
+        float shadowDifferenceRange_;
+        float temperatureDifferenceRange_;
+        bool traceShadows_;
+        bool customSun_;
+        float sunAzimuth_;
+        float sunElevation_;
+        bool tracedDifference_;
+        int shadowSubdivisions_;
+        bool backFacesShadowed_;
+        float wireframeWidth_;
+        float backgroundColor_[4];
+        Colorbar colorbar_;
+        int windowWidth_;
+        int windowHeight_;
+        bool operator==( const ViewState& other ) const;
+    };
+    ViewState viewState( ) const;
+    bool needsRedraw( );
+    bool onDemand_ = true;
+    // ImGui needs a few frames after an input event to settle hover and active states
+    int redrawFrames_ = 3;
+    ViewState lastState_ = { };
+    size_t framesDrawn_ = 0;
+
+    // screenshot, the back buffer is read back through a PBO ring and the PNG
+    // is encoded on worker threads, so capturing does not stall the render loop
     void screenshot( );
+    void collectScreenshots( bool wait = false );
+    std::string screenshotPath( );
     int takeScreenshot_ = 0;
+    bool recording_ = false;
+    int screenshotCount_ = 0;
+    PixelReadback readback_;
+    ImageWriter imageWriter_{ std::max( hardwareThreads( ) - 1, 1 ) };
     std::vector<char> pathToFolder_;
 
 };
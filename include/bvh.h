@@ -0,0 +1,114 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "utilities.h"
+
+struct Ray{
+
+    glm::vec3 origin_;
+    glm::vec3 direction_;   // normalized
+
+};
+
+// ray from the camera through the point x, y of a viewport of the given size,
+// measured in pixels from the top left like the GLFW cursor position
+Ray cameraRay( const glm::mat4& view, const glm::mat4& projection, float x, float y, float width, float height );
+
+// parallel rays with one direction, e.g. towards the sun, traced together.
+// Origins are stored per component so the per-ray loops vectorize
+constexpr int rayPacketSize = 8;
+
+struct RayPacket{
+
+    float x_[ rayPacketSize ];
+    float y_[ rayPacketSize ];
+    float z_[ rayPacketSize ];
+    glm::vec3 direction_;   // normalized
+    uint32_t active_ = 0;   // bit per ray in use
+
+};
+
+struct RayHit{
+
+    int triangle_ = -1;
+    float distance_ = std::numeric_limits< float >::max( );
+    glm::vec3 point_ = glm::vec3( 0.0f );
+
+    bool valid( ) const { return triangle_ >= 0; }
+
+};
+
+// bounding volume hierarchy over the triangles of a geometry, used for picking.
+// The upper levels are split on the calling thread, the subtrees below them
+// are built in parallel. Splits are chosen with a binned surface area heuristic.
+class TriangleBVH{
+
+public:
+
+    TriangleBVH( ) = default;
+    explicit TriangleBVH( std::shared_ptr< const MeshGeometry > geometry, int numberOfThreads = 0 );
+
+    // closest triangle along the ray, front and back faces both count
+    RayHit intersect( const Ray& ray ) const;
+    // bit per active ray of the packet that hits any triangle. The rays share
+    // the traversal: a node is entered while one of them hits its box
+    uint32_t occluded( const RayPacket& packet ) const;
+
+    // bounds of the whole geometry
+    glm::vec3 lower( ) const { return nodes_.empty( ) ? glm::vec3( 0.0f ) : nodes_[ 0 ].min_; }
+    glm::vec3 upper( ) const { return nodes_.empty( ) ? glm::vec3( 0.0f ) : nodes_[ 0 ].max_; }
+    // triangles in the order of the leaves, neighbours in this order lie close together
+    const std::vector< uint32_t >& leafOrder( ) const { return triangles_; }
+
+    const MeshGeometry* geometry( ) const { return geometry_.get( ); }
+    size_t nodes( ) const { return nodes_.size( ); }
+    int depth( ) const { return depth_; }
+
+private:
+
+    // 32 bytes, the two children of an interior node are adjacent
+    struct Node{
+        glm::vec3 min_;
+        uint32_t first_;    // left child, or first entry of triangles_ for a leaf
+        glm::vec3 max_;
+        uint32_t count_;    // triangles of a leaf, 0 for interior nodes
+    };
+
+    // node covering the entries [begin_, end_) of triangles_
+    struct Task{
+        uint32_t node_;
+        uint32_t begin_;
+        uint32_t end_;
+        int depth_;
+    };
+
+    static constexpr uint32_t leafSize = 4;
+    static constexpr int numberOfBins = 16;
+    static constexpr int maximumDepth = 64;
+
+    // sets the bounds of the node and either makes it a leaf (returns false)
+    // or appends its two children to nodes and returns their tasks
+    bool split( const Task& task, std::vector< Node >& nodes, Task children[ 2 ] );
+    // every node below task, in its own node array with the root at 0
+    std::vector< Node > buildSubtree( const Task& task, int& depth );
+
+    std::shared_ptr< const MeshGeometry > geometry_;
+    std::vector< Node > nodes_;
+    std::vector< uint32_t > triangles_;
+    int depth_ = 0;
+
+    // per-triangle bounds and centroids, only while building
+    std::vector< glm::vec3 > lower_;
+    std::vector< glm::vec3 > upper_;
+    std::vector< glm::vec3 > centroids_;
+
+};
+
+#endif // BVH_H
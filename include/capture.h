@@ -0,0 +1,87 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <atomic>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <glad.h>
+
+#include "parallel.h"
+
+// tightly packed RGB pixels as read from OpenGL (bottom row first)
+struct Image{
+
+    int width_ = 0;
+    int height_ = 0;
+    std::vector< unsigned char > pixels_;
+    std::string path_;
+
+};
+
+// asynchronous framebuffer readback through a ring of pixel buffer objects.
+// request( ) only queues the copy on the GPU, the pixels are mapped a frame
+// or two later when its fence has signalled.
+class PixelReadback{
+
+public:
+
+    explicit PixelReadback( int ringSize = 3 ) : ringSize_( ringSize ) { };
+
+    PixelReadback( const PixelReadback& ) = delete;
+    PixelReadback& operator=( const PixelReadback& ) = delete;
+
+    // true when every buffer is in flight and the oldest has to be collected first
+    bool full( ) const { return int( inFlight_.size( ) ) >= ringSize_; }
+    bool empty( ) const { return inFlight_.empty( ); }
+
+    // reads the currently bound read framebuffer, path is handed back with the pixels
+    void request( int width, int height, const std::string& path );
+    // hands back the oldest readback once the GPU is done with it, or blocks for it with wait
+    bool collect( Image& image, bool wait = false );
+
+    // deletes the buffers, call while the context is still current
+    void release( );
+
+private:
+
+    struct Request{
+        GLuint buffer_;
+        GLsync fence_;
+        int width_;
+        int height_;
+        std::string path_;
+    };
+
+    int ringSize_;
+    std::vector< GLuint > freeBuffers_;
+    std::deque< Request > inFlight_;
+
+};
+
+// encodes PNGs on a thread pool
+class ImageWriter{
+
+public:
+
+    // at most maxPending images wait for encoding, write( ) blocks beyond that
+    explicit ImageWriter( int numberOfThreads = 0, size_t maxPending = 8 ) :
+        pool_( numberOfThreads, maxPending ) { };
+
+    void write( Image image );
+    void wait( ) { pool_.wait( ); }
+
+    size_t written( ) const { return written_; }
+    size_t failed( ) const { return failed_; }
+
+private:
+
+    std::atomic< size_t > written_{ 0 };
+    std::atomic< size_t > failed_{ 0 };
+    // declared last, so the workers are joined before the counters go away
+    ThreadPool pool_;
+
+};
+
+#endif // CAPTURE_H
@@ -0,0 +1,173 @@
+#ifndef CODEC_H
+#define CODEC_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "dataset.h"
+
+// Compressed dataset container (.scrtz)
+//
+// Shadow and temperature barely change between consecutive timesteps, so they
+// are stored as quantized differences instead of full floats:
+//
+//   header      CompressedDatasetHeader
+//   frames      one per timestep, 8 byte aligned
+//   positions   float[9*numberOfTriangles], only written again when they change
+//   index       CompressedFrameEntry[timeSteps] at indexOffset_
+//
+// Values are rounded to multiples of the steps in the header, so a decoded
+// value is off by at most half a step. A frame holds the shadow section and,
+// with binaryFlagTemperature, the temperature section. Every keyframeInterval_
+// steps a keyframe stores the quantized values themselves, every other frame
+// the difference to the previous timestep, so random access decodes at most
+// keyframeInterval_ frames. Residuals are zigzag coded and bit packed in blocks
+// of 64 triangles:
+//
+//   uint8   width[numberOfBlocks]     bits per residual, 0 when the whole block is 0
+//   int32   base[numberOfBlocks]      keyframes only, first value of the block; the
+//                                     residuals are differences to the previous triangle
+//   uint64  bits[width] per block     residual i of the block at bit i*width
+
+constexpr char compressedDatasetMagic[ 8 ] = { 'S', 'C', 'R', 'T', 'D', 'L', 'T', '\0' };
+constexpr uint32_t compressedDatasetVersion = 1;
+
+struct CodecSettings{
+
+    float shadowStep_ = 1.0f / 4096.0f;
+    float temperatureStep_ = 0.01f;   // kelvin
+    int keyframeInterval_ = 16;
+
+};
+
+struct CompressedDatasetHeader{
+
+    char magic_[ 8 ];
+    uint32_t version_;
+    uint32_t flags_;
+    uint64_t numberOfTriangles_;
+    uint64_t timeSteps_;
+    uint64_t indexOffset_;
+    uint32_t keyframeInterval_;
+    float shadowStep_;
+    float temperatureStep_;
+    uint32_t reserved_;
+
+};
+
+struct CompressedFrameEntry{
+
+    double header_[ timestepHeaderSize ];   // time, sun vector, rotation matrix as in a .scrt record
+    uint64_t frameOffset_;
+    uint64_t positionsOffset_;
+
+};
+
+// streaming writer for .scrtz files, or for a compressed dataset kept in memory
+class CompressedDatasetWriter{
+
+public:
+
+    // an empty path keeps the dataset in memory, see release( )
+    CompressedDatasetWriter( const std::string& path, int numberOfTriangles, bool temperature,
+        const CodecSettings& settings = CodecSettings( ) );
+    ~CompressedDatasetWriter( );
+
+    CompressedDatasetWriter( const CompressedDatasetWriter& ) = delete;
+    CompressedDatasetWriter& operator=( const CompressedDatasetWriter& ) = delete;
+
+    // append one timestep given as a full mesh.txt row, plus the row of the
+    // temperature file when the writer was created with temperatures
+    void write( const std::vector< double >& row, const std::vector< double >* temperature = nullptr );
+    // append one timestep of a binary dataset
+    void write( const TimestepView& timestep );
+    // append one timestep from its .scrt header and values, positions is nullptr
+    // when they are the same as in the previous timestep
+    void write( const double* header, const float* shadow, const float* temperature, const float* positions );
+    // write the index, patch the header and close the file
+    void close( );
+    // close and hand over the dataset written to memory
+    std::vector< char > release( );
+
+    int timeSteps( ) const { return int( entries_.size( ) ); }
+    uint64_t bytes( ) const { return offset_; }
+
+private:
+
+    void encodeSection( const float* values, float step, bool keyframe, std::vector< int32_t >& previous );
+    void append( const void* data, size_t size );
+    void pad( );
+
+    std::FILE* file_ = nullptr;
+    std::vector< char > memory_;
+    bool closed_ = false;
+    uint64_t offset_ = 0;
+
+    uint64_t numberOfTriangles_;
+    bool temperature_;
+    CodecSettings settings_;
+    std::vector< CompressedFrameEntry > entries_;
+
+    // quantized values of the previous timestep, the residuals and the packed frame
+    std::vector< int32_t > previousShadow_;
+    std::vector< int32_t > previousTemperature_;
+    std::vector< uint32_t > residuals_;
+    std::vector< char > frame_;
+
+    std::vector< float > converted_;
+    std::vector< float > positions_;
+
+};
+
+// memory mapped .scrtz file or a compressed dataset held in memory
+class CompressedDataset{
+
+public:
+
+    explicit CompressedDataset( const std::string& path );
+    explicit CompressedDataset( std::vector< char > memory );
+
+    CompressedDataset( CompressedDataset&& ) = default;
+    CompressedDataset& operator=( CompressedDataset&& ) = default;
+
+    static bool isCompressedDataset( const std::string& path );
+
+    int timeSteps( ) const { return int( header_.timeSteps_ ); }
+    int numberOfTriangles( ) const { return int( header_.numberOfTriangles_ ); }
+    bool hasTemperature( ) const { return header_.flags_ & binaryFlagTemperature; }
+    int keyframeInterval( ) const { return int( header_.keyframeInterval_ ); }
+    const CompressedDatasetHeader& header( ) const { return header_; }
+
+    double time( int index ) const { return entries_[ index ].header_[ 0 ]; }
+    // header and positions of a timestep, without attributes
+    TimestepView timestep( int index ) const;
+
+    // shadow and temperature of a timestep, numberOfTriangles values each, either
+    // may be nullptr. Decoding continues from the last timestep the calling thread
+    // decoded when that lies between the keyframe and index, so forward playback
+    // costs one frame per step
+    void decode( int index, float* shadow, float* temperature ) const;
+    // values of one triangle, without decoding the whole frames
+    void decodeTriangle( int index, int triangle, float& shadow, float& temperature ) const;
+
+    // bytes of the encoded dataset and of the same timesteps as .scrt records
+    size_t size( ) const { return size_; }
+    uint64_t uncompressedSize( ) const;
+
+private:
+
+    void open( const std::string& name );
+
+    MappedFile file_;
+    std::vector< char > memory_;
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    CompressedDatasetHeader header_;
+    const CompressedFrameEntry* entries_ = nullptr;
+    uint64_t id_ = 0;   // tells the decode cursors of different datasets apart
+
+};
+
+#endif // CODEC_H
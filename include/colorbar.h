@@ -0,0 +1,53 @@
+#ifndef COLORBAR_H
+#define COLORBAR_H
+
+#include <array>
+
+#include <imgui.h>
+
+#include "utilities.h"
+
+// colorbar overlay drawn into an ImGui draw list, used by the viewer and scrt-batch
+struct Colorbar{
+
+    // position relative to the window, size as a scale factor
+    float x_ = 0.35f;
+    float y_ = 0.1f;
+    int vertical_ = 0;
+    float size_ = 2.0f;
+    float fontSize_ = 15.0f;
+
+    // the bar is one quad textured with the colormap texture, the temperature
+    // range labels the temperature colorbar, shadow is always 0 to 1
+    void draw( ImDrawList* drawList, VisualizationMode mode, float width, float height,
+        const ValueRange& temperatureRange, GLuint colormap ) const;
+
+private:
+
+    static constexpr int numberOfLabels = 6;
+
+    // positions and label texts, recomputed only when one of the inputs changes
+    struct Layout{
+        bool valid_ = false;
+        float x_, y_, size_, fontSize_;
+        int vertical_;
+        VisualizationMode mode_;
+        float width_, height_;
+        ValueRange range_;
+
+        std::array< ImVec2, 4 > corners_;   // clockwise from the top left
+        std::array< ImVec2, 4 > uvs_;
+        std::array< ImVec2, 2 * numberOfLabels > ticks_;
+        std::array< ImVec2, numberOfLabels > labelPositions_;
+        std::array< std::array< char, 32 >, numberOfLabels > labels_;
+        ImVec2 titlePosition_;
+        const char* title_;
+    };
+
+    void updateLayout( VisualizationMode mode, float width, float height, const ValueRange& temperatureRange ) const;
+
+    mutable Layout layout_;
+
+};
+
+#endif // COLORBAR_H
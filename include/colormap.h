@@ -0,0 +1,60 @@
+#ifndef COLORMAP_H
+#define COLORMAP_H
+
+#include <string>
+#include <vector>
+
+#include <glad.h>
+
+#include <glm/glm.hpp>
+
+// colors at evenly spaced positions from 0 to 1, linearly interpolated
+struct Colormap{
+
+    std::string name_;
+    std::vector< glm::vec3 > colors_;
+
+    glm::vec3 sample( float t ) const;
+
+    // text file with one "r g b" line per control point, in [0, 1] or [0, 255].
+    // Lines starting with # are ignored, the name is the file name without extension
+    static Colormap load( const std::string& path );
+
+};
+
+// white-red and blue-red are the original shadow and temperature colors,
+// followed by viridis, inferno and coolwarm
+const std::vector< Colormap >& builtinColormaps( );
+
+// every colormap baked once into a textureSize x 1 RGBA texture. The mesh
+// shader samples it and the colorbar draws it as one textured quad; it is a
+// 2D texture because that is what the ImGui backend binds.
+class ColormapLibrary{
+
+public:
+
+    static constexpr int textureSize = 256;
+
+    // bakes the built-in maps, needs a current context
+    void init( );
+    void release( );
+
+    // bakes the map and returns its index, a map with the same name is replaced
+    int add( const Colormap& colormap );
+    // loads a file with Colormap::load and adds it
+    int load( const std::string& path );
+    // index of the map with this name, -1 if there is none
+    int find( const std::string& name ) const;
+
+    int size( ) const { return int( colormaps_.size( ) ); }
+    const Colormap& colormap( int index ) const { return colormaps_[ index ]; }
+    GLuint texture( int index ) const { return textures_[ index ]; }
+
+private:
+
+    std::vector< Colormap > colormaps_;
+    std::vector< GLuint > textures_;
+
+};
+
+#endif // COLORMAP_H
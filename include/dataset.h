@@ -0,0 +1,157 @@
+#ifndef DATASET_H
+#define DATASET_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Binary dataset container (.scrt)
+//
+// The file is a header followed by one fixed size record per timestep, so the
+// record of timestep i lives at headerSize_ + i * recordSize_. Values are stored
+// in native byte order (little endian on every platform we ship for).
+//
+//   record:
+//     double  header[13]                     time, sun vector (inertial), rotation matrix (row major)
+//     float   shadow[numberOfTriangles]      per-triangle shadow fraction
+//     float   temperature[numberOfTriangles] per-triangle temperature in K, only with binaryFlagTemperature
+//     float   positions[9*numberOfTriangles] 3 vertices x vec3 per triangle, same as MeshGeometry
+//     padding up to a multiple of 8 bytes
+//
+// The first 13 values of a record are exactly the first 13 columns of a mesh.txt
+// line, the rest is the same data in single precision, which is what MeshData
+// keeps anyway. Version 1 files never have temperatures and are still read.
+//
+// Temperatures of a text dataset live in a companion file with one line per
+// timestep, in the same order as mesh.txt: time followed by numberOfTriangles
+// values.
+
+constexpr char binaryDatasetMagic[ 8 ] = { 'S', 'C', 'R', 'T', 'B', 'I', 'N', '\0' };
+constexpr uint32_t binaryDatasetVersion = 2;
+constexpr uint32_t binaryFlagTemperature = 1u << 0;
+constexpr int timestepHeaderSize = 13;
+
+struct BinaryDatasetHeader{
+
+    char magic_[ 8 ];
+    uint32_t version_;
+    uint32_t flags_;
+    uint64_t numberOfTriangles_;
+    uint64_t timeSteps_;
+    uint64_t headerSize_;
+    uint64_t recordSize_;
+
+};
+
+// size in bytes of one timestep record
+uint64_t binaryRecordSize( uint64_t numberOfTriangles, uint32_t flags = 0 );
+
+// read-only view of one timestep, pointing straight into the mapped file
+struct TimestepView{
+
+    const double* header_;
+    const float* shadow_;
+    const float* temperature_;   // nullptr when the dataset has no temperatures
+    const float* positions_;
+    int numberOfTriangles_;
+
+    double time( ) const { return header_[ 0 ]; }
+
+};
+
+// read-only memory mapping of a whole file
+class MappedFile{
+
+public:
+
+    MappedFile( ) = default;
+    explicit MappedFile( const std::string& path );
+    ~MappedFile( );
+
+    MappedFile( const MappedFile& ) = delete;
+    MappedFile& operator=( const MappedFile& ) = delete;
+    MappedFile( MappedFile&& other ) noexcept;
+    MappedFile& operator=( MappedFile&& other ) noexcept;
+
+    const char* data( ) const { return data_; }
+    size_t size( ) const { return size_; }
+
+    // hint to the kernel that the mapping will be read front to back
+    void adviseSequential( ) const;
+
+private:
+
+    void release( );
+
+    char* data_ = nullptr;
+    size_t size_ = 0;
+
+};
+
+// memory mapped .scrt dataset
+class BinaryDataset{
+
+public:
+
+    explicit BinaryDataset( const std::string& path );
+
+    static bool isBinaryDataset( const std::string& path );
+
+    int timeSteps( ) const { return int( header_.timeSteps_ ); }
+    int numberOfTriangles( ) const { return int( header_.numberOfTriangles_ ); }
+    bool hasTemperature( ) const { return header_.flags_ & binaryFlagTemperature; }
+    TimestepView timestep( int index ) const;
+    const MappedFile& file( ) const { return file_; }
+
+private:
+
+    MappedFile file_;
+    BinaryDatasetHeader header_;
+
+};
+
+// streaming writer for .scrt files, used by scrt-convert
+class BinaryDatasetWriter{
+
+public:
+
+    BinaryDatasetWriter( const std::string& path, int numberOfTriangles, bool temperature = false );
+    ~BinaryDatasetWriter( );
+
+    // append one timestep given as a full mesh.txt row, plus the row of the
+    // temperature file when the writer was created with temperatures
+    void write( const std::vector< double >& row, const std::vector< double >* temperature = nullptr );
+    // patch the header with the final timestep count and close the file,
+    // throws when a write failed before or the header cannot be patched
+    void close( );
+
+    int timeSteps( ) const { return int( timeSteps_ ); }
+
+private:
+
+    std::FILE* file_ = nullptr;
+    uint64_t numberOfTriangles_;
+    bool temperature_;
+    uint64_t timeSteps_ = 0;
+    std::vector< char > record_;
+    // a record could not be written, the header is then never patched
+    bool failed_ = false;
+
+};
+
+// parse one whitespace separated line of mesh.txt, returns false for empty lines
+bool parseTextRow( const std::string& line, std::vector< double >& values );
+bool parseTextRow( const char* begin, const char* end, std::vector< double >& values );
+
+// parse a whole mesh.txt held in memory. The text is split into line aligned
+// chunks that are parsed concurrently on numberOfThreads threads (all cores
+// when 0); rows are returned in file order, empty lines are skipped.
+std::vector< std::vector< double > > parseTextMesh( const char* begin, const char* end, int numberOfThreads = 0 );
+
+// throws unless row is the temperature line of the timestep at time: the same
+// time (up to the text precision) followed by numberOfTriangles values
+void checkTemperatureRow( const std::vector< double >& row, double time, int numberOfTriangles, int step );
+
+#endif // DATASET_H
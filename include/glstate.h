@@ -0,0 +1,105 @@
+#ifndef GLSTATE_H
+#define GLSTATE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <glad.h>
+#include <glm/glm.hpp>
+
+// GL work counted by GLStateCache, per frame
+struct GLCounters{
+
+    size_t calls_ = 0;          // GL calls issued, state queries and uploads included
+    size_t stateChanges_ = 0;   // binds, modes and enables that changed state
+    size_t uniforms_ = 0;       // uniform values that changed
+    size_t skipped_ = 0;        // calls left out because the value was already set
+    size_t draws_ = 0;
+    size_t uploadedBytes_ = 0;
+
+    GLCounters& operator+=( const GLCounters& other );
+
+};
+
+// shadow copy of the GL state the renderer sets. Calls that would set what is
+// already set are dropped, the others are forwarded and counted. Code changing
+// this state behind the cache calls invalidate( ), so do deletions of bound
+// objects since GL reuses their names. ImGui restores everything it changes.
+class GLStateCache{
+
+public:
+
+    void useProgram( GLuint program );
+    void bindVertexArray( GLuint vertexArray );
+    // the element buffer binding belongs to the bound vertex array
+    void bindBuffer( GLenum target, GLuint buffer );
+    void bindBufferBase( GLenum target, GLuint index, GLuint buffer );
+    // selects the unit only when the binding changes
+    void bindTexture( int unit, GLenum target, GLuint texture );
+    void activeTexture( int unit );
+    void polygonMode( GLenum mode );
+    void enable( GLenum capability, bool enabled );
+    void polygonOffset( float factor, float units );
+
+    // uniforms of the program in use, negative locations (not active) are ignored
+    void uniform( GLint location, int value );
+    void uniform( GLint location, float value );
+    void uniform( GLint location, const glm::vec2& value );
+    void uniform( GLint location, const glm::vec3& value );
+    void uniform( GLint location, const glm::vec4& value );
+
+    // counted as uploaded, to the buffer bound at target
+    void bufferData( GLenum target, size_t bytes, const void* data, GLenum usage );
+    void bufferSubData( GLenum target, size_t offset, size_t bytes, const void* data );
+    void drawElements( GLenum mode, GLsizei count );
+    // GL calls made directly, and bytes written through mapped buffers
+    void count( size_t calls, size_t uploadedBytes = 0 ){
+        frame_.calls_ += calls;
+        frame_.uploadedBytes_ += uploadedBytes;
+    }
+
+    // forgets all bindings, uniform values are kept as they belong to the programs
+    void invalidate( );
+    // before deleting a program
+    void forgetProgram( GLuint program );
+
+    // the counters of the frame so far become lastFrame_
+    void endFrame( );
+
+    GLCounters frame_;
+    GLCounters lastFrame_;
+
+private:
+
+    static constexpr GLuint unknown = ~GLuint( 0 );
+
+    // false and counted as skipped when value equals the cached one
+    bool changed( GLuint& cached, GLuint value );
+    bool changedUniform( GLint location, const void* value, size_t bytes );
+
+    GLuint program_ = unknown;
+    GLuint vertexArray_ = unknown;
+    GLuint activeUnit_ = unknown;
+    GLuint polygonMode_ = unknown;
+    bool polygonOffsetKnown_ = false;
+    glm::vec2 polygonOffset_ = glm::vec2( 0.0f );
+    // buffers by target, element buffers by vertex array, textures by unit and target
+    std::unordered_map< GLenum, GLuint > buffers_;
+    std::unordered_map< GLuint, GLuint > elementBuffers_;
+    std::unordered_map< uint64_t, GLuint > indexedBuffers_;
+    std::unordered_map< uint64_t, GLuint > textures_;
+    std::unordered_map< GLenum, GLuint > capabilities_;
+
+    // values by location of every program, compared bitwise
+    struct UniformValue{
+        std::array< uint32_t, 4 > bits_{ };
+        bool set_ = false;
+    };
+    std::unordered_map< GLuint, std::vector< UniformValue > > uniforms_;
+
+};
+
+#endif // GLSTATE_H
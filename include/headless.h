@@ -0,0 +1,41 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <string>
+
+#include <glad.h>
+
+// offscreen OpenGL context for machines without a display or GPU. The context
+// comes from EGL (the surfaceless Mesa platform when available, so llvmpipe
+// works) and renders into a framebuffer object of fixed size.
+class HeadlessContext{
+
+public:
+
+    HeadlessContext( int width, int height );
+    ~HeadlessContext( );
+
+    HeadlessContext( const HeadlessContext& ) = delete;
+    HeadlessContext& operator=( const HeadlessContext& ) = delete;
+
+    // makes the offscreen framebuffer the draw and read target
+    void bind( );
+
+    int width( ) const { return width_; }
+    int height( ) const { return height_; }
+    // GL_RENDERER and GL_VERSION of the context
+    std::string description( ) const;
+
+private:
+
+    int width_;
+    int height_;
+    void* display_ = nullptr;
+    void* context_ = nullptr;
+    GLuint framebuffer_ = 0;
+    GLuint colorBuffer_ = 0;
+    GLuint depthBuffer_ = 0;
+
+};
+
+#endif // HEADLESS_H
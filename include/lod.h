@@ -0,0 +1,62 @@
+#ifndef LOD_H
+#define LOD_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "utilities.h"
+
+// one simplified level of a geometry. Half-edge collapses only move corners
+// onto other vertices of the mesh, so a level indexes the positions of the
+// full geometry and every remaining triangle is one of the original triangles
+struct DetailLevel{
+
+    std::vector< uint32_t > indices_;
+    std::vector< uint32_t > triangles_;   // original triangle of every triangle, selects its attributes
+    // largest distance of a vertex of the full mesh to this level in model units.
+    // Points inside the original triangles can deviate a little more
+    float error_ = 0.0f;
+
+    int numberOfTriangles( ) const { return int( triangles_.size( ) ); }
+
+};
+
+struct SimplificationSettings{
+
+    // triangles of every level relative to the full mesh
+    std::vector< float > ratios_ = { 0.25f, 0.0625f, 0.015625f };
+    // no level gets fewer triangles than this
+    int minimumTriangles_ = 1024;
+    // edges between triangles whose shadow, or temperature relative to the range,
+    // differ by more than this in any sampled timestep are kept like borders
+    float featureThreshold_ = 0.1f;
+    // weight of the border and feature planes relative to the surface planes
+    float boundaryWeight_ = 10.0f;
+
+};
+
+// coarser versions of one geometry, one of them is chosen per frame
+struct LevelsOfDetail{
+
+    uint64_t geometryRevision_ = 0;   // geometry the levels were built from
+    glm::vec3 center_ = glm::vec3( 0.0f );
+    float radius_ = 0.0f;
+    std::vector< DetailLevel > levels_;   // coarser with every level, the full mesh is not included
+
+    // coarsest level whose error projects to at most pixelError pixels from the
+    // closest point of the bounding sphere, -1 for the full mesh
+    int select( const glm::mat4& view, const glm::mat4& projection, float viewportHeight, float pixelError ) const;
+
+};
+
+// quadric error simplification by half-edge collapses, in passes of independent
+// collapses. samples are timesteps of the geometry whose attributes mark the
+// feature edges, temperatureRange normalizes their temperatures
+std::shared_ptr< const LevelsOfDetail > buildLevelsOfDetail( const MeshGeometry& geometry,
+    const std::vector< const MeshData* >& samples, const ValueRange& temperatureRange,
+    const SimplificationSettings& settings = SimplificationSettings( ), int numberOfThreads = 0 );
+
+#endif // LOD_H
@@ -0,0 +1,175 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// number of worker threads used by the parallel helpers
+inline int hardwareThreads( ){
+    unsigned int threads = std::thread::hardware_concurrency( );
+    return threads > 0 ? int( threads ) : 1;
+}
+
+// runs body( i ) for every i in [0, count) on up to numberOfThreads threads
+// (all cores when 0) and blocks until all of them are done. Items are handed
+// out dynamically, so uneven items still keep every thread busy. The first
+// exception thrown by body is rethrown on the calling thread.
+template< typename Function >
+void parallelFor( int count, Function&& body, int numberOfThreads = 0 ){
+
+    if ( numberOfThreads <= 0 )
+    {
+        numberOfThreads = hardwareThreads( );
+    }
+    numberOfThreads = std::min( numberOfThreads, count );
+    if ( numberOfThreads <= 1 )
+    {
+        for ( int i = 0; i < count; i++ )
+        {
+            body( i );
+        }
+        return;
+    }
+
+    std::atomic< int > next( 0 );
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    auto worker = [&]( ){
+        int i;
+        while ( ( i = next++ ) < count )
+        {
+            try
+            {
+                body( i );
+            }
+            catch ( ... )
+            {
+                std::lock_guard< std::mutex > lock( errorMutex );
+                if ( !error )
+                {
+                    error = std::current_exception( );
+                }
+                next = count;
+            }
+        }
+    };
+
+    std::vector< std::thread > threads;
+    for ( int t = 1; t < numberOfThreads; t++ )
+    {
+        threads.emplace_back( worker );
+    }
+    worker( );
+    for ( auto& thread : threads )
+    {
+        thread.join( );
+    }
+    if ( error )
+    {
+        std::rethrow_exception( error );
+    }
+}
+
+// fixed set of worker threads running queued tasks in submission order. Tasks
+// must not throw, an exception leaving a worker terminates the program
+class ThreadPool{
+
+public:
+
+    // maxPending > 0 makes submit( ) block while that many tasks are waiting,
+    // which keeps a fast producer from queueing unbounded amounts of memory
+    explicit ThreadPool( int numberOfThreads = 0, size_t maxPending = 0 ) :
+        maxPending_( maxPending ) {
+        if ( numberOfThreads <= 0 )
+        {
+            numberOfThreads = hardwareThreads( );
+        }
+        for ( int t = 0; t < numberOfThreads; t++ )
+        {
+            threads_.emplace_back( [this]( ){ run( ); } );
+        }
+    };
+
+    // runs the tasks still queued, then joins
+    ~ThreadPool( ){
+        {
+            std::lock_guard< std::mutex > lock( mutex_ );
+            stop_ = true;
+        }
+        wake_.notify_all( );
+        for ( auto& thread : threads_ )
+        {
+            thread.join( );
+        }
+    };
+
+    ThreadPool( const ThreadPool& ) = delete;
+    ThreadPool& operator=( const ThreadPool& ) = delete;
+
+    void submit( std::function< void( ) > task ){
+        {
+            std::unique_lock< std::mutex > lock( mutex_ );
+            if ( maxPending_ > 0 )
+            {
+                idle_.wait( lock, [&]( ){ return tasks_.size( ) < maxPending_; } );
+            }
+            tasks_.push_back( std::move( task ) );
+        }
+        wake_.notify_one( );
+    };
+
+    // blocks until every submitted task has finished
+    void wait( ){
+        std::unique_lock< std::mutex > lock( mutex_ );
+        idle_.wait( lock, [&]( ){ return tasks_.empty( ) && running_ == 0; } );
+    };
+
+    size_t pending( ){
+        std::lock_guard< std::mutex > lock( mutex_ );
+        return tasks_.size( ) + running_;
+    };
+
+    int size( ) const { return int( threads_.size( ) ); }
+
+private:
+
+    void run( ){
+        std::unique_lock< std::mutex > lock( mutex_ );
+        while ( true )
+        {
+            wake_.wait( lock, [&]( ){ return stop_ || !tasks_.empty( ); } );
+            if ( tasks_.empty( ) )
+            {
+                return;
+            }
+            std::function< void( ) > task = std::move( tasks_.front( ) );
+            tasks_.pop_front( );
+            running_++;
+            idle_.notify_all( );
+            lock.unlock( );
+            task( );
+            lock.lock( );
+            running_--;
+            idle_.notify_all( );
+        }
+    };
+
+    size_t maxPending_;
+    std::vector< std::thread > threads_;
+    std::deque< std::function< void( ) > > tasks_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    size_t running_ = 0;
+    bool stop_ = false;
+
+};
+
+#endif // PARALLEL_H
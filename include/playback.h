@@ -0,0 +1,98 @@
+#ifndef PLAYBACK_H
+#define PLAYBACK_H
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "utilities.h"
+
+// playback clock, frame pacing and frame statistics
+class Playback{
+
+public:
+
+    bool playing_ = false;
+    bool loop_ = true;
+    // simulation seconds per wall-clock second
+    float speed_ = 10.0f;
+    float targetFps_ = 60.0f;
+
+    // starts the clock at the given simulation time
+    void play( double time );
+    void pause( ) { playing_ = false; }
+    // moves the clock, e.g. when the slider is dragged while playing
+    void seek( double time ) { time_ = time; }
+
+    // advances the clock by the wall time since the previous frame and
+    // returns the simulation time this frame should show
+    double advance( double first, double last );
+    // sleeps until the deadline of the next frame and counts late frames
+    void waitForNextFrame( );
+    // the frame could not show the timestep it was due for
+    void frameDropped( ) { dropped_++; }
+
+    void resetStatistics( );
+    size_t frames_ = 0;
+    size_t late_ = 0;
+    size_t dropped_ = 0;
+    float frameTime_ = 0.0f;   // last frame interval in ms
+
+private:
+
+    using Clock = std::chrono::steady_clock;
+
+    double time_ = 0.0;
+    Clock::time_point previous_;
+    Clock::time_point deadline_;
+
+};
+
+// fills mapped attribute buffers of the renderer on a worker thread, so the
+// next timestep is prepared while the current one is displayed
+class TimestepStager{
+
+public:
+
+    // returns the timestep stored at an index, may load it from disk
+    using Loader = std::function< std::shared_ptr< const MeshData >( int step ) >;
+
+    struct Result{
+        Renderer::StagingSlot slot_;
+        int step_ = -1;
+        uint64_t revision_ = 0;   // 0 if the timestep could not be loaded
+    };
+
+    explicit TimestepStager( Loader loader );
+    ~TimestepStager( );
+
+    TimestepStager( const TimestepStager& ) = delete;
+    TimestepStager& operator=( const TimestepStager& ) = delete;
+
+    // true while a job is queued, running or waiting to be collected
+    bool busy( );
+    int step( );
+    void submit( int step, const Renderer::StagingSlot& slot );
+    // hands back a finished job, the slot then has to be committed on the GL thread
+    bool collect( Result& result );
+
+private:
+
+    void run( );
+
+    Loader loader_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+    bool pending_ = false;
+    bool finished_ = false;
+    Result job_;
+    std::thread worker_;
+
+};
+
+#endif // PLAYBACK_H
@@ -0,0 +1,148 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <string>
+
+#include <glad.h>
+
+// stages of a frame, in the order they run. GPU time is only measured for
+// stages that issue GL commands, timer queries of one frame never overlap.
+enum class ProfileStage : int {
+    UPDATE,     // playback, staging commits, camera, ImGui new frame
+    UPLOAD,     // geometry and attribute uploads in Renderer::renderMesh
+    DRAW,       // filled or wireframe pass
+    OVERLAY,    // wireframe overlay pass
+    COLORBAR,   // building the colorbar draw list
+    GUI,        // control panel, ImGui render and screenshot readback
+    SWAP,       // glfwSwapBuffers
+    COUNT
+};
+
+constexpr int profileStageCount = int( ProfileStage::COUNT );
+
+const char* profileStageName( ProfileStage stage );
+
+// CPU and GPU time per stage of one frame, in milliseconds. GPU times are
+// negative for stages without a query and for results that were dropped.
+struct FrameTiming{
+
+    uint64_t frame_ = 0;
+    double start_ = 0.0;        // seconds since the profiler was created
+    double frameTime_ = 0.0;    // CPU time from beginFrame to endFrame
+    std::array< double, profileStageCount > cpu_{ };
+    std::array< double, profileStageCount > gpu_{ };
+
+};
+
+// per-stage frame profiler. GPU times come from GL_TIME_ELAPSED queries kept
+// in a ring of frames, a frame is read back ringSize - 1 frames later and only
+// when all of its results are available, so the profiler never stalls.
+// Stages running more than once per frame, one upload and draw per viewport,
+// add up on the CPU and, for up to queriesPerStage runs, on the GPU. A stage
+// that ran more often gets no GPU time for that frame.
+class FrameProfiler{
+
+public:
+
+    static constexpr int ringSize = 4;
+    static constexpr int queriesPerStage = 16;
+
+    FrameProfiler( );
+
+    FrameProfiler( const FrameProfiler& ) = delete;
+    FrameProfiler& operator=( const FrameProfiler& ) = delete;
+
+    // creates the queries, call with a current context
+    void init( );
+    void release( );
+
+    void beginFrame( );
+    void endFrame( );
+    void begin( ProfileStage stage );
+    void end( ProfileStage stage );
+    // waits for the frames still in the ring and adds them to the history
+    void flush( );
+
+    // completed frames, newest last
+    const std::deque< FrameTiming >& history( ) const { return history_; }
+    // mean over the last frames of the history, dropped GPU times are skipped
+    FrameTiming average( int frames ) const;
+
+    // every completed frame is appended to the file until stopCsv( ), the
+    // comment is written as a leading "# ..." line to tell runs apart
+    void startCsv( const std::string& path, const std::string& comment = "" );
+    void stopCsv( );
+    bool writingCsv( ) const { return csv_.is_open( ); }
+    const std::string& csvPath( ) const { return csvPath_; }
+
+    bool enabled_ = false;
+    size_t historySize_ = 300;
+
+private:
+
+    struct PendingFrame{
+        FrameTiming timing_;
+        std::array< int, profileStageCount > queried_{ };      // queries issued per stage
+        std::array< bool, profileStageCount > incomplete_{ };  // runs beyond the query pool
+        bool pending_ = false;
+    };
+
+    double now( ) const;
+    void collect( PendingFrame& pending, bool wait );
+    void complete( const FrameTiming& timing );
+
+    std::chrono::steady_clock::time_point created_;
+    std::array< PendingFrame, ringSize > ring_;
+    // queriesPerStage queries of every stage, stage after stage
+    std::array< std::array< GLuint, profileStageCount * queriesPerStage >, ringSize > queries_{ };
+    std::array< double, profileStageCount > stageStart_{ };
+    uint64_t frame_ = 0;
+    double frameStart_ = 0.0;
+    int activeQuery_ = -1;
+    bool inFrame_ = false;
+    bool initialized_ = false;
+
+    std::deque< FrameTiming > history_;
+    std::ofstream csv_;
+    std::string csvPath_;
+
+};
+
+// times the enclosing scope, does nothing without a profiler or when disabled
+class ProfileScope{
+
+public:
+
+    ProfileScope( FrameProfiler* profiler, ProfileStage stage ) :
+        profiler_( profiler && profiler->enabled_ ? profiler : nullptr ),
+        stage_( stage ) {
+        if ( profiler_ )
+        {
+            profiler_->begin( stage_ );
+        }
+    };
+
+    ~ProfileScope( ){
+        if ( profiler_ )
+        {
+            profiler_->end( stage_ );
+        }
+    };
+
+    ProfileScope( const ProfileScope& ) = delete;
+    ProfileScope& operator=( const ProfileScope& ) = delete;
+
+private:
+
+    FrameProfiler* profiler_;
+    ProfileStage stage_;
+
+};
+
+#endif // PROFILER_H
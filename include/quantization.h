@@ -0,0 +1,56 @@
+#ifndef QUANTIZATION_H
+#define QUANTIZATION_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "statistics.h"
+
+// compact vertex format: positions as 16 bit normalized values relative to the
+// bounding box, shadow as a normalized byte and temperature as a normalized
+// 16 bit value over a fixed range. The GPU dequantizes while fetching.
+
+// positions, 4 values per vertex (x, y, z and padding for 8 byte alignment)
+struct QuantizedPositions{
+
+    QuantizedPositions( ) = default;
+    explicit QuantizedPositions( const std::vector< glm::vec3 >& positions );
+
+    // position = offset_ + scale_ * value / 65535
+    glm::vec3 position( size_t vertex ) const;
+
+    glm::vec3 offset_ = glm::vec3( 0.0f );
+    glm::vec3 scale_ = glm::vec3( 1.0f );
+    std::vector< uint16_t > values_;
+
+};
+
+inline uint16_t quantizeUnorm16( float t ){
+    return uint16_t( std::min( std::max( t, 0.0f ), 1.0f ) * 65535.0f + 0.5f );
+}
+
+// shadow fractions in [0, 1] to bytes
+void packShadow( const float* shadow, size_t count, uint8_t* packed );
+// temperatures relative to range, values outside are clamped
+void packTemperature( const float* temperature, size_t count, const ValueRange& range, uint16_t* packed );
+
+// largest differences between the float and the compact format
+struct QuantizationError{
+
+    float position_ = 0.0f;          // model units
+    float positionRelative_ = 0.0f;  // position_ over the bounding box diagonal
+    float shadow_ = 0.0f;
+    float temperature_ = 0.0f;       // kelvin, values inside the range only
+    size_t temperatureClamped_ = 0;  // values outside the range
+
+};
+
+// quantizes and dequantizes exactly like the renderer and compares with the input
+QuantizationError measureQuantizationError( const std::vector< glm::vec3 >& positions,
+    const std::vector< float >& shadow, const std::vector< float >& temperature, const ValueRange& temperatureRange );
+
+#endif // QUANTIZATION_H
@@ -0,0 +1,13 @@
+#ifndef RESOURCES_H
+#define RESOURCES_H
+
+#include <cstddef>
+
+// memory of the process in bytes, 0 where the system does not tell
+
+// resident now, what a freshly built data set actually occupies
+size_t residentBytes( );
+// high-water mark over the lifetime of the process, loading peaks included
+size_t peakResidentBytes( );
+
+#endif // RESOURCES_H
@@ -0,0 +1,57 @@
+#ifndef SHADERS_H
+#define SHADERS_H
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <glad.h>
+
+// GLSL sources compiled into the executable from shaders/ at build time (see
+// cmake/EmbedShaders.cmake), so the tools run from any directory
+const char* embeddedShader( const std::string& name );
+
+// builds the programs of the renderer. Sources come from the executable unless
+// an override directory holds a file of the same name, which is watched for
+// changes while developing. Linked programs are kept on disk as program
+// binaries, keyed by the driver and the sources, and loaded instead of
+// compiling when they match.
+class ShaderLibrary{
+
+public:
+
+    // defaults from SCRT_SHADER_DIR and SCRT_SHADER_CACHE, the cache falls back
+    // to $XDG_CACHE_HOME/scrt or ~/.cache/scrt
+    ShaderLibrary( );
+
+    // directory overriding the embedded sources, empty for none
+    std::string directory_;
+    // directory of the program binaries, empty disables the cache
+    std::string cacheDirectory_;
+
+    // source of a shader by file name, from the override directory if it is there
+    std::string source( const std::string& name ) const;
+    // links the two shaders, needs a current context. Throws on compile and
+    // link errors, with the log of the driver
+    GLuint link( const std::string& vertexName, const std::string& fragmentName );
+    // true when a file of the override directory changed since the last link,
+    // the files are checked at most twice a second
+    bool changed( );
+
+    // how the last program was built
+    bool fromCache_ = false;
+    double linkSeconds_ = 0.0;
+
+private:
+
+    GLuint loadBinary( const std::filesystem::path& path );
+    void storeBinary( GLuint program, const std::filesystem::path& path );
+
+    // override files read by the last link and their modification times
+    std::vector< std::pair< std::filesystem::path, std::filesystem::file_time_type > > watched_;
+    std::chrono::steady_clock::time_point lastCheck_;
+
+};
+
+#endif // SHADERS_H
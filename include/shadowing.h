@@ -0,0 +1,34 @@
+#ifndef SHADOWING_H
+#define SHADOWING_H
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "bvh.h"
+
+// self-shadowing under a directional sun, traced on the CPU: rays from sample
+// points on every triangle towards the sun, the shadow of a triangle is the
+// fraction of its points whose ray hits another part of the mesh
+
+struct ShadowSettings{
+
+    // every triangle is split into subdivisions^2 equal triangles with one sample at each center
+    int subdivisions_ = 2;
+    // rays start this far above the surface, relative to the bounding box
+    // diagonal, so they do not hit the triangle they start from
+    float offset_ = 1e-5f;
+    // triangles facing away from the sun are fully shadowed, otherwise both faces are traced
+    bool backFacesShadowed_ = true;
+
+    int samplesPerTriangle( ) const { return subdivisions_ * subdivisions_; }
+
+};
+
+// shadow fraction of every triangle of the geometry of bvh, sun is the vector
+// towards the sun in the body frame. Packets of rays from triangles adjacent in
+// the leaf order are traced on numberOfThreads threads (all cores when 0)
+void traceShadows( const TriangleBVH& bvh, const glm::vec3& sun, std::vector< float >& shadow,
+    const ShadowSettings& settings = ShadowSettings( ), int numberOfThreads = 0 );
+
+#endif // SHADOWING_H
@@ -0,0 +1,77 @@
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// closed interval of attribute values mapped onto the colormap
+struct ValueRange{
+
+    float min_ = 0.0f;
+    float max_ = 1.0f;
+
+    // blends two ranges, used while interpolating between timesteps
+    static ValueRange mix( const ValueRange& a, const ValueRange& b, float weight ){
+        return { a.min_ + ( b.min_ - a.min_ ) * weight, a.max_ + ( b.max_ - a.max_ ) * weight };
+    };
+
+};
+
+// which range of the statistics scales the colormap
+enum class RangeMode : int {
+    GLOBAL = 0,         // min and max over all timesteps
+    TIMESTEP = 1,       // min and max of the displayed timestep
+    PERCENTILE = 2,     // lower and upper percentile over all timesteps
+    COUNT
+};
+
+const char* rangeModeName( RangeMode mode );
+
+// min, max and percentile ranges of a per-triangle attribute, per timestep and
+// over the whole dataset. Every timestep is scanned exactly once while loading:
+// add( ) reduces min and max and fills a coarse histogram, finish( ) merges the
+// histograms into the global percentiles. Afterwards a range is a lookup.
+class RangeStatistics{
+
+public:
+
+    static constexpr int histogramBins = 256;
+
+    // percentiles of the PERCENTILE mode
+    float lowerPercentile_ = 0.02f;
+    float upperPercentile_ = 0.98f;
+
+    // drops previous results and prepares timeSteps slots
+    void reset( int timeSteps );
+    // scans the values of one timestep; calls for distinct steps may run concurrently
+    void add( int step, const float* values, size_t count );
+    // global ranges, call once after every step was added
+    void finish( );
+
+    bool empty( ) const { return steps_.empty( ); }
+    int timeSteps( ) const { return int( steps_.size( ) ); }
+    ValueRange range( RangeMode mode, int step ) const;
+    const ValueRange& global( ) const { return global_; }
+    const ValueRange& percentile( ) const { return percentile_; }
+
+private:
+
+    struct StepStatistics{
+        ValueRange range_;
+        uint64_t count_ = 0;
+        std::vector< uint32_t > histogram_;   // over range_, released by finish( )
+    };
+
+    std::vector< StepStatistics > steps_;
+    ValueRange global_;
+    ValueRange percentile_;
+
+};
+
+// min and max of count values, NaNs are skipped. Written with independent
+// lanes so the compiler turns the loop into packed min/max instructions.
+ValueRange reduceRange( const float* values, size_t count );
+
+#endif // STATISTICS_H
@@ -0,0 +1,187 @@
+#ifndef STREAMING_H
+#define STREAMING_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_map>
+
+#include "codec.h"
+#include "utilities.h"
+
+// random access to the timesteps of a dataset on disk
+class TimestepSource{
+
+public:
+
+    virtual ~TimestepSource( ) = default;
+
+    virtual int timeSteps( ) const = 0;
+    virtual double time( int index ) const = 0;
+    // loads one timestep; geometry is reused when the step has the same positions.
+    // Must be safe to call from several threads at once.
+    virtual MeshData load( int index, const std::shared_ptr< const MeshGeometry >& geometry ) const = 0;
+    // only the per-triangle temperatures of one timestep, empty without temperatures
+    virtual void loadTemperature( int index, std::vector< float >& temperature ) const = 0;
+    // shadow and temperature (0 without temperatures) of a single triangle of one timestep
+    virtual void loadTriangle( int index, int triangle, float& shadow, float& temperature ) const = 0;
+    virtual bool hasTemperature( ) const = 0;
+
+};
+
+// .scrt files, the record offset follows from the index
+class BinaryTimestepSource : public TimestepSource{
+
+public:
+
+    explicit BinaryTimestepSource( const std::string& path ) : dataset_( path ) { };
+
+    int timeSteps( ) const override { return dataset_.timeSteps( ); }
+    double time( int index ) const override { return dataset_.timestep( index ).time( ); }
+    MeshData load( int index, const std::shared_ptr< const MeshGeometry >& geometry ) const override;
+    void loadTemperature( int index, std::vector< float >& temperature ) const override;
+    void loadTriangle( int index, int triangle, float& shadow, float& temperature ) const override;
+    bool hasTemperature( ) const override { return dataset_.hasTemperature( ); }
+
+private:
+
+    BinaryDataset dataset_;
+
+};
+
+// mesh.txt, indexed by the byte range of every non-empty line when opened.
+// The optional temperature file is indexed the same way.
+class TextTimestepSource : public TimestepSource{
+
+public:
+
+    explicit TextTimestepSource( const std::string& path, const std::string& temperaturePath = "" );
+
+    int timeSteps( ) const override { return int( lines_.size( ) ); }
+    double time( int index ) const override { return times_[ index ]; }
+    MeshData load( int index, const std::shared_ptr< const MeshGeometry >& geometry ) const override;
+    void loadTemperature( int index, std::vector< float >& temperature ) const override;
+    void loadTriangle( int index, int triangle, float& shadow, float& temperature ) const override;
+    bool hasTemperature( ) const override { return !temperatureLines_.empty( ); }
+
+private:
+
+    // temperatures of a step as parsed, time first
+    void parseTemperature( int index, std::vector< double >& row ) const;
+
+    MappedFile file_;
+    std::vector< std::pair< size_t, size_t > > lines_;
+    std::vector< double > times_;
+    MappedFile temperatureFile_;
+    std::vector< std::pair< size_t, size_t > > temperatureLines_;
+
+};
+
+// .scrtz files or a compressed dataset held in memory, decoded on every load
+class CompressedTimestepSource : public TimestepSource{
+
+public:
+
+    explicit CompressedTimestepSource( CompressedDataset dataset ) : dataset_( std::move( dataset ) ) { };
+
+    int timeSteps( ) const override { return dataset_.timeSteps( ); }
+    double time( int index ) const override { return dataset_.time( index ); }
+    MeshData load( int index, const std::shared_ptr< const MeshGeometry >& geometry ) const override;
+    void loadTemperature( int index, std::vector< float >& temperature ) const override;
+    void loadTriangle( int index, int triangle, float& shadow, float& temperature ) const override;
+    bool hasTemperature( ) const override { return dataset_.hasTemperature( ); }
+
+    const CompressedDataset& dataset( ) const { return dataset_; }
+
+private:
+
+    CompressedDataset dataset_;
+
+};
+
+// encodes every timestep of source into a compressed dataset held in memory.
+// Steps are loaded in parallel batches and encoded in order; headers keep the
+// body frame sun with an identity rotation
+CompressedDataset compressTimestepSource( const TimestepSource& source, const CodecSettings& settings = CodecSettings( ),
+    int numberOfThreads = 0 );
+
+// opens a binary, compressed or text dataset depending on its content, temperatures of a
+// text dataset come from the companion file (binary datasets store their own)
+std::unique_ptr< TimestepSource > openTimestepSource( const std::string& path, const std::string& temperaturePath = "" );
+
+// scans the temperatures of every timestep of the source once, in parallel
+// chunks of consecutive steps
+void computeTemperatureStatistics( const TimestepSource& source, RangeStatistics& statistics, int numberOfThreads = 0 );
+
+// bounded LRU cache of timesteps with a background prefetch thread
+class TimestepCache{
+
+public:
+
+    // steps whose positions match geometry share it, so datasets of the same mesh
+    // can share one geometry (and its GPU upload)
+    TimestepCache( std::unique_ptr< TimestepSource > source, int capacity, int prefetchDepth = 4,
+        std::shared_ptr< const MeshGeometry > geometry = nullptr );
+    ~TimestepCache( );
+
+    TimestepCache( const TimestepCache& ) = delete;
+    TimestepCache& operator=( const TimestepCache& ) = delete;
+
+    // returns the timestep, loading it on the calling thread on a miss
+    std::shared_ptr< const MeshData > get( int index );
+    // returns the timestep if it is resident, without loading or touching counters
+    std::shared_ptr< const MeshData > peek( int index );
+    // queue the steps following index in the given direction (+1 forward, -1 backward)
+    void prefetch( int index, int direction );
+
+    void setCapacity( int capacity );
+    int capacity( ) const { return capacity_; }
+    int prefetchDepth( ) const { return prefetchDepth_; }
+
+    const TimestepSource& source( ) const { return *source_; }
+    const std::shared_ptr< const MeshGeometry >& geometry( ) const { return geometry_; }
+
+    // counters
+    size_t hits( ) const { return hits_; }
+    size_t misses( ) const { return misses_; }
+    size_t prefetched( ) const { return prefetched_; }
+    int resident( );
+
+private:
+
+    struct Entry{
+        std::shared_ptr< const MeshData > mesh_;
+        std::list< int >::iterator position_;
+    };
+
+    void insert( int index, std::shared_ptr< const MeshData > mesh );
+    void evict( );
+    void run( );
+
+    std::unique_ptr< TimestepSource > source_;
+    std::shared_ptr< const MeshGeometry > geometry_;
+    int capacity_;
+    int prefetchDepth_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable loaded_;
+    std::list< int > recentlyUsed_;
+    std::unordered_map< int, Entry > entries_;
+    std::set< int > loading_;
+    std::deque< int > queue_;
+    bool stop_ = false;
+    std::thread worker_;
+
+    std::atomic< size_t > hits_{ 0 };
+    std::atomic< size_t > misses_{ 0 };
+    std::atomic< size_t > prefetched_{ 0 };
+
+};
+
+#endif // STREAMING_H
@@ -9,80 +9,225 @@
 #include <map>
 #include <sstream>
 #include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
 
 #include <glad.h>     
-#include <GLFW/glfw3.h>
 
 #include <glm/glm.hpp>         
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "colormap.h"
+#include "dataset.h"
+#include "glstate.h"
+#include "profiler.h"
+#include "quantization.h"
+#include "shaders.h"
+#include "statistics.h"
 
 // base structs and enums
-struct Vertex{
 
-    glm::vec3 position_;
-    float shadow_;
-    float temperature_;
+// identifies data uploaded to the GPU, data that changes draws a new revision
+inline uint64_t nextRevision( ){
+    static std::atomic< uint64_t > revision( 0 );
+    return ++revision;
+}
+
+// indexed triangle mesh; one instance is shared by every timestep whose
+// positions are identical
+struct MeshGeometry{
+
+    MeshGeometry( ) = default;
+
+    // positions of a mesh.txt row
+    explicit MeshGeometry( const std::vector< double >& mesh );
+    // positions of a mapped binary timestep
+    explicit MeshGeometry( const TimestepView& timestep );
+
+    // true if the row stores these positions (up to the welding tolerance)
+    bool matches( const std::vector< double >& mesh ) const;
+    bool matches( const TimestepView& timestep ) const;
+
+    int numberOfTriangles( ) const { return int( indices_.size( ) / 3 ); }
+
+    // unique vertices and 3 indices per triangle, triangles keep their input order
+    std::vector< glm::vec3 > positions_;
+    std::vector< uint32_t > indices_;
+    // vertices closer than this were merged
+    float weldTolerance_ = 0.0f;
+    uint64_t revision_ = nextRevision( );
+
+private:
+
+    // merges vertices that fall into the same cell of a grid quantized to weldTolerance_
+    template< typename T >
+    void weld( const T* positions, int numberOfTriangles );
+
+    template< typename T >
+    bool matches( const T* positions, int numberOfTriangles ) const;
 
 };
 
+// one timestep: per-triangle attributes plus a reference to its geometry
 struct MeshData{
 
     MeshData( ) = default;
 
-    MeshData( std::vector< double >& mesh ){
+    // the geometry is read from the row unless a shared one is passed,
+    // temperature points to the numberOfTriangles values of the step if there are any
+    MeshData( std::vector< double >& mesh, std::shared_ptr< const MeshGeometry > geometry = nullptr,
+        const double* temperature = nullptr ){
 
         // sun position
-        glm::vec3 sunPositionInertial = glm::vec3( float(mesh[ 1 ]), float(mesh[ 2 ]), float(mesh[ 3 ]) );
-        glm::mat3 rotationMatrix = glm::mat3( 
-            glm::vec3( float(mesh[ 4 ]), float(mesh[ 7 ]), float(mesh[ 10 ]) ),
-            glm::vec3( float(mesh[ 5 ]), float(mesh[ 8 ]), float(mesh[ 11 ]) ),
-            glm::vec3( float(mesh[ 6 ]), float(mesh[ 9 ]), float(mesh[ 12 ]) )
-        );
-        sunPosition_ = rotationMatrix * sunPositionInertial;
+        sunPosition_ = bodyFrameSunPosition( mesh.data( ) );
 
         // loading
         int numberOfTriangles = ( mesh.size( ) - 13 ) / 10;
-        int trianlgeStartIndex = 13 + numberOfTriangles;
         int colorStartIndex = 13;
+        geometry_ = geometry ? std::move( geometry ) : std::make_shared< const MeshGeometry >( mesh );
+        shadow_.resize( numberOfTriangles );
+        temperature_.resize( numberOfTriangles );
         for ( int i = 0; i<numberOfTriangles; i++ )
         {
-            float temperature = float(i) / float(numberOfTriangles);
-            for ( int j = 0; j<3; j++ ){
-
-                glm::vec3 position = glm::vec3(
-                    float(mesh[ trianlgeStartIndex + 9*i + 3*j]), 
-                    float(mesh[ trianlgeStartIndex + 1 + 9*i + 3*j]), 
-                    float(mesh[ trianlgeStartIndex + 2 + 9*i + 3*j]) );
-                
-                vertices_.push_back( {position, float(mesh[colorStartIndex + i]), temperature } );
-            }                
- 
+            shadow_[ i ] = float(mesh[colorStartIndex + i]);
+            temperature_[ i ] = temperature ? float(temperature[ i ]) : 0.0f;
+        }
+
+    };
+
+    // build from a mapped binary timestep without parsing. The attributes are
+    // copied out of the mapping since MeshData owns them, the positions are only
+    // welded when no geometry is passed
+    MeshData( const TimestepView& timestep, std::shared_ptr< const MeshGeometry > geometry = nullptr ){
+
+        sunPosition_ = bodyFrameSunPosition( timestep.header_ );
+
+        int numberOfTriangles = timestep.numberOfTriangles_;
+        geometry_ = geometry ? std::move( geometry ) : std::make_shared< const MeshGeometry >( timestep );
+        shadow_.assign( timestep.shadow_, timestep.shadow_ + numberOfTriangles );
+        if ( timestep.temperature_ )
+        {
+            temperature_.assign( timestep.temperature_, timestep.temperature_ + numberOfTriangles );
+        }
+        else
+        {
+            temperature_.assign( numberOfTriangles, 0.0f );
         }
 
     };
 
-    std::vector< Vertex > vertices_;
+    // sun vector rotated from the inertial to the body frame, header = time, sun, rotation (row major)
+    static glm::vec3 bodyFrameSunPosition( const double* header ){
+        glm::vec3 sunPositionInertial = glm::vec3( float(header[ 1 ]), float(header[ 2 ]), float(header[ 3 ]) );
+        glm::mat3 rotationMatrix = glm::mat3( 
+            glm::vec3( float(header[ 4 ]), float(header[ 7 ]), float(header[ 10 ]) ),
+            glm::vec3( float(header[ 5 ]), float(header[ 8 ]), float(header[ 11 ]) ),
+            glm::vec3( float(header[ 6 ]), float(header[ 9 ]), float(header[ 12 ]) )
+        );
+        return rotationMatrix * sunPositionInertial;
+    }
+
+    int numberOfTriangles( ) const { return int( shadow_.size( ) ); }
+
+    std::shared_ptr< const MeshGeometry > geometry_;
+    std::vector< float > shadow_;
+    // kelvin, zero when the dataset has no temperatures
+    std::vector< float > temperature_;
     glm::vec3 sunPosition_;
+    uint64_t revision_ = nextRevision( );
+
+};
 
-    double tempMax_;
-    double tempMin_;
+// sorted, contiguous index of the timestep times, looked up by binary search
+class TimeIndex{
+
+public:
+
+    // position of a time between the two stored timesteps around it
+    struct Sample{
+        int lower_;
+        int upper_;
+        float weight_;   // 0 at lower_, 1 at upper_
+    };
+
+    TimeIndex( ) = default;
+
+    // times in storage order; for duplicated times the last timestep wins
+    explicit TimeIndex( const std::vector< double >& times ){
+        std::vector< int > order( times.size( ) );
+        for ( size_t i = 0; i < order.size( ); i++ ){
+            order[ i ] = int( i );
+        }
+        std::stable_sort( order.begin( ), order.end( ), [&]( int a, int b ){ return times[ a ] < times[ b ]; } );
+        for ( int step : order ){
+            if ( !times_.empty( ) && times_.back( ) == times[ step ] ){
+                steps_.back( ) = step;
+                continue;
+            }
+            times_.push_back( times[ step ] );
+            steps_.push_back( step );
+        }
+    };
+
+    Sample locate( double time ) const {
+        int last = size( ) - 1;
+        if ( last <= 0 || time <= times_.front( ) ){
+            return { 0, 0, 0.0f };
+        }
+        if ( time >= times_.back( ) ){
+            return { last, last, 0.0f };
+        }
+        int upper = int( std::upper_bound( times_.begin( ), times_.end( ), time ) - times_.begin( ) );
+        int lower = upper - 1;
+        float weight = float( ( time - times_[ lower ] ) / ( times_[ upper ] - times_[ lower ] ) );
+        return { lower, upper, weight };
+    };
+
+    int size( ) const { return int( times_.size( ) ); }
+    double time( int position ) const { return times_[ position ]; }
+    double first( ) const { return times_.front( ); }
+    double last( ) const { return times_.back( ); }
+    // storage index (row of the dataset) of a sorted position
+    int step( int position ) const { return steps_[ position ]; }
+
+private:
+
+    std::vector< double > times_;
+    std::vector< int > steps_;
 
 };
 
+// arcball camera: orbits the pan offset at the given distance
+inline glm::mat4 arcballViewMatrix( const glm::quat& rotation, float distance, const glm::vec3& panOffset ){
+    // Camera position in world space
+    glm::vec3 cameraOffset = glm::vec3(0.0f, 0.0f, distance);
+    
+    // Apply rotation to camera position
+    glm::mat4 rotationMatrix = glm::mat4_cast(rotation);
+    glm::vec3 cameraPos = glm::vec3(rotationMatrix * glm::vec4(cameraOffset, 1.0f));
+    
+    // Up vector rotated
+    glm::vec3 up = glm::vec3(rotationMatrix * glm::vec4(0.0f, 1.0f, 0.0f, 0.0f));
+    
+    // Target is the pan offset
+    return glm::lookAt(cameraPos + panOffset, panOffset, up);
+}
+
 enum class VisualizationMode {
     WIREFRAME = 0,
     SHADOW = 1,
     TEMPERATURE = 2
 };
 
-// helper functions for checking shaders
-std::string loadShaderSource(const std::string& filepath);
-
-GLuint compileShaderFromFile(const std::string& filepath, GLenum type);
-
 // renderer
 
+// see lod.h
+struct LevelsOfDetail;
+
 class Renderer {
 
 public:
@@ -90,17 +235,167 @@ public:
     GLuint shaderProgram_ = 0;
     GLuint VAO_ = 0;
     GLuint VBO_ = 0;
-    GLuint visualizationModeLocation_ = 0;
-    GLuint wireframeColorLocation_ = 0;
+    GLuint EBO_ = 0;
+    GLint visualizationModeLocation_ = -1;
+    GLint wireframeColorLocation_ = -1;
+    GLint interpolationWeightLocation_ = -1;
+    GLint wireframeWidthLocation_ = -1;
+    GLint temperatureRangeLocation_ = -1;
+    GLint temperatureEncodingLocation_ = -1;
+    GLint positionOffsetLocation_ = -1;
+    GLint positionScaleLocation_ = -1;
+    GLint positionStrideLocation_ = -1;
+    GLint differenceLocation_ = -1;
+    GLint differenceRangeLocation_ = -1;
+    // uniform buffer of the Camera block, view, projection and viewport
+    GLuint cameraBuffer_ = 0;
+    // buffer texture views of the vertex and index buffers for the single pass overlay
+    GLuint positionTexture_ = 0;
+    GLuint indexTexture_ = 0;
     bool wireFrameOverlay_ = true;
+    // edges shaded in the fill pass, otherwise a second GL_LINE pass with polygon offset
+    bool singlePassOverlay_ = true;
+    // line width in pixels of the single pass overlay
+    float wireframeWidth_ = 1.0f;
+    // temperatures mapped to the ends of the colormap, values outside are clamped
+    ValueRange temperatureRange_;
+    // compact format on the GPU: positions as 16 bit normalized values in the
+    // bounding box, shadow as a normalized byte and temperature as a 16 bit
+    // value over packedTemperatureRange_, 3 instead of 8 bytes per triangle
+    bool compactVertices_ = false;
+    // temperatures covered by the 16 bit values, the global range of the dataset
+    ValueRange packedTemperatureRange_;
+    // colormaps of the shadow and temperature modes, indices into colormaps_
+    ColormapLibrary colormaps_;
+    int shadowColormap_ = 0;
+    int temperatureColormap_ = 0;
+    // index of the colormap used by a mode, settable for the filled modes only
+    int& colormap( VisualizationMode mode ){
+        return mode == VisualizationMode::TEMPERATURE ? temperatureColormap_ : shadowColormap_;
+    };
+    GLuint colormapTexture( VisualizationMode mode ){ return colormaps_.texture( colormap( mode ) ); }
+    // diverging colormap of the difference view, zero in the middle
+    int differenceColormap_ = 0;
+    // number of timesteps whose attributes are kept on the GPU, at least the two being blended
+    int residentTimesteps_ = 8;
+    // simplified versions of the geometry, used for meshes of the same revision only
+    std::shared_ptr< const LevelsOfDetail > levelsOfDetail_;
+    bool levelOfDetail_ = true;
+    // largest projected error of a level in pixels
+    float lodPixelError_ = 1.0f;
+    // level of the last frame, -1 for the full mesh
+    int drawnLevel_ = -1;
 
     void init( );
-    void renderMesh( MeshData& mesh, 
+    void release( );
+    // once per frame before the first renderMesh, slots used since then are
+    // not recycled, so several viewports can draw different timesteps
+    void beginFrame( );
+    // with nextMesh the attributes are blended with weight in the fragment shader
+    void renderMesh( const MeshData& mesh, 
         const glm::mat4& view, 
         const glm::mat4& projection,
-        const VisualizationMode visualizationMode );
-    void checkShaderCompile(GLuint shader);
-    void checkProgramLink(GLuint program);
+        const VisualizationMode visualizationMode,
+        const MeshData* nextMesh = nullptr,
+        float weight = 0.0f );
+    // colors mesh minus reference triangle by triangle, both with the same number
+    // of triangles, -range and +range are the ends of the colormap. Both attribute
+    // streams are fetched in the fragment shader, nothing is computed on the CPU
+    void renderDifference( const MeshData& mesh,
+        const MeshData& reference,
+        const glm::mat4& view,
+        const glm::mat4& projection,
+        const VisualizationMode visualizationMode,
+        float range );
+    // sources of the program, embedded or from an override directory, and the program binary cache
+    ShaderLibrary shaders_;
+    // relinks the program when an override file changed, or always with force.
+    // Errors are printed and keep the last program, true if it was replaced
+    bool reloadShaders( bool force = false );
+
+    // bytes sent to the GPU since the start
+    size_t uploadedBytes_ = 0;
+    // GL state set by the renderer, drops redundant calls and counts the GL
+    // work of every frame, call state_.endFrame( ) once per frame
+    GLStateCache state_;
+    // optional, times the upload, draw and overlay stages
+    FrameProfiler* profiler_ = nullptr;
+
+    // attribute buffers of a slot mapped for writing, so another thread can
+    // fill them while frames keep being drawn
+    struct StagingSlot{
+        int slot_ = -1;
+        void* shadow_ = nullptr;        // float, uint8_t in the compact format
+        void* temperature_ = nullptr;   // float, uint16_t in the compact format
+        size_t numberOfTriangles_ = 0;
+        bool compact_ = false;
+        ValueRange temperatureRange_;
+        // writes the attributes of mesh in the format of the slot, from any thread
+        void write( const MeshData& mesh ) const;
+    };
+    bool isResident( const MeshData& mesh ) const;
+    StagingSlot mapStaging( size_t numberOfTriangles );
+    // unmaps the slot, which then holds the timestep with this revision (0 if filling failed)
+    void commitStaging( const StagingSlot& staging, uint64_t revision );
+
+private:
+
+    // per-triangle attributes of one timestep, read in the fragment shader
+    // through buffer textures indexed by gl_PrimitiveID
+    struct ResidentTimestep{
+        uint64_t revision_ = 0;
+        uint64_t lastUsed_ = 0;
+        GLuint buffers_[ 2 ] = { 0, 0 };   // shadow, temperature
+        GLuint textures_[ 2 ] = { 0, 0 };
+        bool mapped_ = false;
+    };
+
+    void buildProgram( );
+    // drops everything on the GPU when the format or the temperature range changed
+    void checkFormat( );
+    GLenum attributeFormat( int attribute ) const;
+    size_t attributeSize( int attribute ) const;
+    void uploadGeometry( const MeshGeometry& geometry );
+    // level for the view, uploads the levels when they changed
+    int selectLevel( const MeshGeometry& geometry, const glm::mat4& view, const glm::mat4& projection, float viewportHeight );
+    // rewrites the camera block when it differs from the last one
+    void updateCamera( const glm::mat4& view, const glm::mat4& projection, const glm::vec4& viewport );
+    void releaseLevels( );
+    int acquireSlot( );
+    int residentAttributes( const MeshData& mesh );
+
+    uint64_t geometryRevision_ = 0;
+    // element buffer plus buffer textures of the indices and the original
+    // triangles (for the attributes) of every level
+    struct LevelBuffers{
+        GLuint elements_ = 0;
+        GLuint triangles_ = 0;
+        GLuint indexTexture_ = 0;
+        GLuint triangleTexture_ = 0;
+        GLsizei numberOfIndices_ = 0;
+    };
+    std::vector< LevelBuffers > levelBuffers_;
+    std::shared_ptr< const LevelsOfDetail > uploadedLevels_;
+    GLint useTriangleMapLocation_ = -1;
+    // std140 layout of the Camera block in both shaders, at binding cameraBinding
+    struct CameraBlock{
+        glm::mat4 view_;
+        glm::mat4 projection_;
+        glm::vec4 viewport_;
+    };
+    static constexpr GLuint cameraBinding = 0;
+    CameraBlock camera_;
+    bool cameraValid_ = false;
+    // set by renderDifference for the draw of renderMesh
+    bool difference_ = false;
+    float differenceRange_ = 1.0f;
+    bool residentCompact_ = false;
+    ValueRange residentTemperatureRange_;
+    // dequantization of the uploaded positions, identity for floats
+    glm::vec3 positionOffset_ = glm::vec3( 0.0f );
+    glm::vec3 positionScale_ = glm::vec3( 1.0f );
+    std::vector< ResidentTimestep > resident_;
+    uint64_t frame_ = 0;
 
 };
 
@@ -1,36 +1,115 @@
 #version 330 core
 
-in float vShadow;
-in float vTemperature;
-
 out vec4 FragColor;
 
+// per-triangle attributes of the timesteps before and after the current time,
+// indexed by gl_PrimitiveID and blended with interpolationWeight
+uniform samplerBuffer shadowBuffer;
+uniform samplerBuffer temperatureBuffer;
+uniform samplerBuffer nextShadowBuffer;
+uniform samplerBuffer nextTemperatureBuffer;
+uniform float interpolationWeight;
+// triangles of a simplified level are original triangles, whose index is
+// looked up here to fetch their attributes
+uniform usamplerBuffer triangleMap;
+uniform bool useTriangleMap;
+// difference view: the attributes of the reference case are bound as the next
+// timestep, the difference maps -differenceRange..differenceRange onto the colormap
+uniform bool difference;
+uniform float differenceRange;
+// temperatures in K at the cold and hot end of the colormap
+uniform vec2 temperatureRange;
+// kelvin = x + y * stored value, stored values of the compact format are normalized
+uniform vec2 temperatureEncoding;
+
 uniform int visualizationMode; // 0=wireframe, 1=shadow, 2=temperature
 uniform vec4 wireframeColor;   // grey color for wireframe
 
-// Temperature gradient (you can make these uniforms too)
-vec3 coldColor = vec3(0.0, 0.0, 1.0);  // blue
-vec3 hotColor = vec3(1.0, 0.0, 0.0);   // red
+// single pass wireframe overlay: the corners of the triangle are fetched by
+// gl_PrimitiveID from the vertex and index buffers and projected to the screen,
+// pixels close to an edge get the wireframe color
+uniform samplerBuffer positionBuffer;
+uniform usamplerBuffer indexBuffer;
+uniform int positionStride;    // 3 floats, or 4 normalized values in the compact format
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+// the Camera block of the vertex shader, bound to the same uniform buffer
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    vec4 viewport;         // x, y, width, height in pixels
+};
+uniform float wireframeWidth;  // line width in pixels, 0 disables the overlay
+
+// colormap of the current mode baked into a row of texels, shared with the colorbar
+uniform sampler2D colormap;
 
-vec3 fullShadow = vec3(1.0, 0.0, 0.0);
-vec3 fullLight = vec3(1.0, 1.0, 1.0);
-vec3 color;
+// color at t in [0, 1], the ends hit the centers of the first and last texel
+vec4 lookupColor(float t) {
+    float size = float(textureSize(colormap, 0).x);
+    float u = (clamp(t, 0.0, 1.0) * (size - 1.0) + 0.5) / size;
+    return vec4(texture(colormap, vec2(u, 0.5)).rgb, 1.0);
+}
+
+// distance in pixels from this fragment to the closest edge of its triangle
+float edgeDistance() {
+    vec2 corners[3];
+    for (int i = 0; i < 3; i++) {
+        int index = int(texelFetch(indexBuffer, 3 * gl_PrimitiveID + i).r);
+        vec3 position = positionOffset + positionScale * vec3(texelFetch(positionBuffer, positionStride * index).r,
+                                                              texelFetch(positionBuffer, positionStride * index + 1).r,
+                                                              texelFetch(positionBuffer, positionStride * index + 2).r);
+        vec4 clip = projection * (view * vec4(position, 1.0));
+        if (clip.w <= 0.0) {
+            // corner behind the camera, the projected edges would be wrong
+            return 1e6;
+        }
+        corners[i] = viewport.xy + (clip.xy / clip.w * 0.5 + 0.5) * viewport.zw;
+    }
+    float distance = 1e6;
+    for (int i = 0; i < 3; i++) {
+        vec2 edge = corners[(i + 1) % 3] - corners[i];
+        vec2 toFragment = gl_FragCoord.xy - corners[i];
+        float len = length(edge);
+        if (len > 0.0) {
+            distance = min(distance, abs(edge.x * toFragment.y - edge.y * toFragment.x) / len);
+        }
+    }
+    return distance;
+}
 
 void main() {
+    int triangle = useTriangleMap ? int(texelFetch(triangleMap, gl_PrimitiveID).r) : gl_PrimitiveID;
+    float vShadow = mix(texelFetch(shadowBuffer, triangle).r,
+                        texelFetch(nextShadowBuffer, triangle).r, interpolationWeight);
+    float vTemperature = temperatureEncoding.x + temperatureEncoding.y *
+                         mix(texelFetch(temperatureBuffer, triangle).r,
+                             texelFetch(nextTemperatureBuffer, triangle).r, interpolationWeight);
+
     if (visualizationMode == 0) {
         // Wireframe mode - solid grey
         FragColor = wireframeColor;
     }
+    else if (difference) {
+        // the offset of the temperature encoding cancels out
+        float delta = visualizationMode == 1 ?
+            texelFetch(shadowBuffer, triangle).r - texelFetch(nextShadowBuffer, triangle).r :
+            temperatureEncoding.y * (texelFetch(temperatureBuffer, triangle).r - texelFetch(nextTemperatureBuffer, triangle).r);
+        FragColor = lookupColor(0.5 + 0.5 * delta / differenceRange);
+    }
     else if (visualizationMode == 1) {
-        // Shadow mode - red (shadow) or white (lit)
-        //FragColor = vShadow > 0.0 ? vec4(1.0, 0.0, 0.0, 1.0) : vec4(1.0, 1.0, 1.0, 1.0);
-        color = mix(fullLight, fullShadow, vShadow);
-        FragColor = vec4(color, 1.0);
-
+        // Shadow mode - shadow fraction straight onto the colormap
+        FragColor = lookupColor(vShadow);
     }
     else if (visualizationMode == 2) {
-        // Temperature mode - gradient
-        color = mix(coldColor, hotColor, vTemperature);
-        FragColor = vec4(color, 1.0);
+        // Temperature mode - gradient over the range chosen on the CPU
+        FragColor = lookupColor((vTemperature - temperatureRange.x) / max(temperatureRange.y - temperatureRange.x, 1e-6));
+    }
+
+    if (wireframeWidth > 0.0) {
+        // one pixel of antialiasing around the line
+        float halfWidth = 0.5 * wireframeWidth;
+        float line = 1.0 - smoothstep(halfWidth - 0.5, halfWidth + 0.5, edgeDistance());
+        FragColor = mix(FragColor, vec4(wireframeColor.rgb, 1.0), line * wireframeColor.a);
     }
 }
\ No newline at end of file
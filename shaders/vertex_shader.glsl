@@ -1,16 +1,16 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in float aShadow;      // 0.0 or 1.0 (or intensity)
-layout (location = 2) in float aTemperature; // temperature value
 
-out float vShadow;
-out float vTemperature;
-
-uniform mat4 view;
-uniform mat4 projection;
+// camera of the view being drawn, one uniform buffer shared by both stages
+layout (std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    vec4 viewport;         // x, y, width, height in pixels
+};
+// compact positions are normalized to the bounding box, identity for floats
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
 
 void main() {
-    gl_Position = projection * view * vec4(aPos, 1.0);
-    vShadow = aShadow;
-    vTemperature = aTemperature;
-}
\ No newline at end of file
+    gl_Position = projection * view * vec4(positionOffset + aPos * positionScale, 1.0);
+}
@@ -15,22 +15,45 @@ void SpacecraftRenderingTools::init( ){
     glfwSetFramebufferSizeCallback(window_, [](GLFWwindow* w, int width, int height) {
         auto* app = static_cast<SpacecraftRenderingTools*>(glfwGetWindowUserPointer(w));
         app->onResize(width, height);
+        app->requestRedraw( );
     });
 
     // Mouse move callback
     glfwSetCursorPosCallback(window_, [](GLFWwindow* w, double x, double y) {
         auto* app = static_cast<SpacecraftRenderingTools*>(glfwGetWindowUserPointer(w));
         app->onMouseMove(x, y);
+        app->requestRedraw( );
     });
 
     glfwSetMouseButtonCallback(window_, [](GLFWwindow* w, int button, int action, int mods) {
-        static_cast<SpacecraftRenderingTools*>(glfwGetWindowUserPointer(w))->onMouseButton(button, action, mods);
+        auto* app = static_cast<SpacecraftRenderingTools*>(glfwGetWindowUserPointer(w));
+        app->onMouseButton(button, action, mods);
+        app->requestRedraw( );
     });
 
     // Scroll callback (zoom)
     glfwSetScrollCallback(window_, [](GLFWwindow* w, double x, double y) {
         auto* app = static_cast<SpacecraftRenderingTools*>(glfwGetWindowUserPointer(w));
         app->onScroll(x, y);
+        app->requestRedraw( );
+    });
+
+    // input only ImGui reacts to, and exposed or refocused windows, also need a new frame.
+    // ImGui installs its callbacks on top of these and chains to them
+    glfwSetKeyCallback(window_, [](GLFWwindow* w, int, int, int, int) {
+        static_cast<SpacecraftRenderingTools*>(glfwGetWindowUserPointer(w))->requestRedraw( );
+    });
+    glfwSetCharCallback(window_, [](GLFWwindow* w, unsigned int) {
+        static_cast<SpacecraftRenderingTools*>(glfwGetWindowUserPointer(w))->requestRedraw( );
+    });
+    glfwSetWindowFocusCallback(window_, [](GLFWwindow* w, int) {
+        static_cast<SpacecraftRenderingTools*>(glfwGetWindowUserPointer(w))->requestRedraw( );
+    });
+    glfwSetCursorEnterCallback(window_, [](GLFWwindow* w, int) {
+        static_cast<SpacecraftRenderingTools*>(glfwGetWindowUserPointer(w))->requestRedraw( );
+    });
+    glfwSetWindowRefreshCallback(window_, [](GLFWwindow* w) {
+        static_cast<SpacecraftRenderingTools*>(glfwGetWindowUserPointer(w))->requestRedraw( );
     });
 
     if (!window_)
@@ -40,6 +63,8 @@ void SpacecraftRenderingTools::init( ){
     }
 
     glfwMakeContextCurrent(window_);
+    // present at the display rate, playback paces its frames against it
+    glfwSwapInterval(1);
 
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
         throw std::runtime_error("Error, failed to initialize GLAD");
@@ -53,39 +78,506 @@ void SpacecraftRenderingTools::init( ){
     ImGui_ImplOpenGL3_Init("#version 330");
 
     renderer_.init( );
+    profiler_.init( );
+    renderer_.profiler_ = &profiler_;
 
 }
 
-void SpacecraftRenderingTools::loadMesh( std::string pathToMesh ){
+void SpacecraftRenderingTools::loadMesh( std::string pathToMesh, std::string pathToTemperature ){
+
+    datasetPath_ = pathToMesh;
+
+    if ( BinaryDataset::isBinaryDataset( pathToMesh ) )
+    {
+        if ( !pathToTemperature.empty( ) )
+        {
+            throw std::runtime_error( "Error, temperatures of a binary dataset are added by scrt-convert --temperature" );
+        }
+        loadBinaryMesh( pathToMesh );
+        return;
+    }
+    // compressed datasets stay compressed, timesteps are decoded when they are shown
+    if ( CompressedDataset::isCompressedDataset( pathToMesh ) )
+    {
+        openMeshStreaming( pathToMesh, cacheCapacity_, pathToTemperature );
+        return;
+    }
     
-    std::ifstream file( pathToMesh );
-    if ( !file )
+    if ( !std::filesystem::exists( pathToMesh ) )
     {
         throw std::runtime_error( "Error, path to mesh does not exist!" );
     }
-    std::string line;
-    std::vector< std::vector< double > > allData;
+    MappedFile file( pathToMesh );
+    file.adviseSequential( );
 
-    while ( std::getline( file, line ) )
+    auto start = std::chrono::steady_clock::now( );
+    std::vector< std::vector< double > > allData = parseTextMesh( file.data( ), file.data( ) + file.size( ) );
+    double seconds = std::chrono::duration< double >( std::chrono::steady_clock::now( ) - start ).count( );
+    double megabytes = double( file.size( ) ) / ( 1024.0 * 1024.0 );
+    std::cout << "parsed " << megabytes << " MB in " << seconds << " s ("
+              << megabytes / seconds << " MB/s, " << hardwareThreads( ) << " threads)" << std::endl;
+
+    if ( allData.empty( ) )
     {
-        std::istringstream iss(line);
-        double val;
-        std::vector<double> values;
-        while (iss >> val) { 
-            values.push_back(val);
-        }
-        if (!values.empty()) {
-            allData.push_back(values);
-        }
+        throw std::runtime_error( "Error, mesh does not contain any timestep!" );
     }
     timeSteps_ = allData.size( );
     numberOfTriangles_ = ( allData[ 0 ].size( ) - 13 ) / 10;
-    for ( auto timestep: allData )
+
+    std::vector< std::vector< double > > temperatures;
+    if ( !pathToTemperature.empty( ) )
     {
-        spacecraftData_[ float(timestep[ 0 ]) ] = MeshData( timestep );
-        times_.push_back( float(timestep[ 0 ]) );
+        MappedFile temperatureFile( pathToTemperature );
+        temperatureFile.adviseSequential( );
+        temperatures = parseTextMesh( temperatureFile.data( ), temperatureFile.data( ) + temperatureFile.size( ) );
+        if ( temperatures.size( ) != allData.size( ) )
+        {
+            throw std::runtime_error( "Error, " + pathToTemperature + " has " + std::to_string( temperatures.size( ) ) +
+                " timesteps but the mesh has " + std::to_string( allData.size( ) ) );
+        }
     }
-    time_ = float(times_[ 0 ]);
+    hasTemperature_ = !temperatures.empty( );
+
+    // positions are stored once if they are the same in every timestep
+    auto geometry = std::make_shared< const MeshGeometry >( allData[ 0 ] );
+    std::atomic< bool > constantGeometry( true );
+    parallelFor( timeSteps_, [&]( int i ){
+        if ( constantGeometry && !geometry->matches( allData[ i ] ) ){
+            constantGeometry = false;
+        }
+    } );
+    sharedGeometry_ = constantGeometry;
+
+    std::vector< double > times( timeSteps_ );
+    for ( int i = 0; i < timeSteps_; i++ )
+    {
+        times[ i ] = allData[ i ][ 0 ];
+        if ( hasTemperature_ )
+        {
+            checkTemperatureRow( temperatures[ i ], times[ i ], numberOfTriangles_, i );
+        }
+    }
+
+    // every step is built in its own slot straight from the parsed row, which
+    // is freed right after, so the rows and the steps never exist in full together
+    start = std::chrono::steady_clock::now( );
+    spacecraftData_.resize( timeSteps_ );
+    parallelFor( timeSteps_, [&]( int i ){
+        const double* temperature = hasTemperature_ ? temperatures[ i ].data( ) + 1 : nullptr;
+        spacecraftData_[ i ] = MeshData( allData[ i ], sharedGeometry_ ? geometry : nullptr, temperature );
+        std::vector< double >( ).swap( allData[ i ] );
+        if ( hasTemperature_ )
+        {
+            std::vector< double >( ).swap( temperatures[ i ] );
+        }
+    } );
+    seconds = std::chrono::duration< double >( std::chrono::steady_clock::now( ) - start ).count( );
+    std::cout << "built " << timeSteps_ << " timesteps in " << seconds << " s, resident memory "
+              << residentBytes( ) / ( 1024.0 * 1024.0 ) << " MB (peak "
+              << peakResidentBytes( ) / ( 1024.0 * 1024.0 ) << " MB)" << std::endl;
+    timeIndex_ = TimeIndex( times );
+    time_ = float(timeIndex_.first( ));
+    printMemoryFootprint( );
+    scanTemperatures( );
+    updateBVH( spacecraftData_[ timeIndex_.step( 0 ) ] );
+    startLodBuild( );
+}
+
+void SpacecraftRenderingTools::loadBinaryMesh( std::string pathToMesh ){
+
+    BinaryDataset dataset( pathToMesh );
+    if ( dataset.timeSteps( ) == 0 )
+    {
+        throw std::runtime_error( "Error, binary dataset does not contain any timestep!" );
+    }
+    dataset.file( ).adviseSequential( );
+
+    timeSteps_ = dataset.timeSteps( );
+    numberOfTriangles_ = dataset.numberOfTriangles( );
+    hasTemperature_ = dataset.hasTemperature( );
+
+    // positions are stored once if they are the same in every timestep
+    auto geometry = std::make_shared< const MeshGeometry >( dataset.timestep( 0 ) );
+    std::atomic< bool > constantGeometry( true );
+    parallelFor( timeSteps_, [&]( int i ){
+        if ( constantGeometry && !geometry->matches( dataset.timestep( i ) ) ){
+            constantGeometry = false;
+        }
+    } );
+    sharedGeometry_ = constantGeometry;
+
+    std::vector< double > times( timeSteps_ );
+    spacecraftData_.resize( timeSteps_ );
+    parallelFor( timeSteps_, [&]( int i ){
+        TimestepView timestep = dataset.timestep( i );
+        spacecraftData_[ i ] = MeshData( timestep, sharedGeometry_ ? geometry : nullptr );
+        times[ i ] = timestep.time( );
+    } );
+    timeIndex_ = TimeIndex( times );
+    time_ = float(timeIndex_.first( ));
+    printMemoryFootprint( );
+    scanTemperatures( );
+    updateBVH( spacecraftData_[ timeIndex_.step( 0 ) ] );
+    startLodBuild( );
+}
+
+void SpacecraftRenderingTools::openMeshStreaming( std::string pathToMesh, int cacheCapacity, std::string pathToTemperature, bool compress ){
+
+    datasetPath_ = pathToMesh;
+
+    if ( !std::filesystem::exists( pathToMesh ) )
+    {
+        throw std::runtime_error( "Error, path to mesh does not exist!" );
+    }
+    cacheCapacity_ = cacheCapacity;
+    std::unique_ptr< TimestepSource > timestepSource = openTimestepSource( pathToMesh, pathToTemperature );
+    if ( compress && !dynamic_cast< const CompressedTimestepSource* >( timestepSource.get( ) ) )
+    {
+        auto start = std::chrono::steady_clock::now( );
+        auto compressed = std::make_unique< CompressedTimestepSource >( compressTimestepSource( *timestepSource ) );
+        double seconds = std::chrono::duration< double >( std::chrono::steady_clock::now( ) - start ).count( );
+        const CompressedDataset& dataset = compressed->dataset( );
+        std::cout << "compressed " << dataset.timeSteps( ) << " timesteps in memory to " << dataset.size( ) / ( 1024.0 * 1024.0 )
+                  << " MB (" << double( dataset.uncompressedSize( ) ) / double( dataset.size( ) ) << "x smaller) in "
+                  << seconds << " s" << std::endl;
+        timestepSource = std::move( compressed );
+    }
+    timestepCache_ = std::make_unique< TimestepCache >( std::move( timestepSource ), cacheCapacity_ );
+
+    const TimestepSource& source = timestepCache_->source( );
+    timeSteps_ = source.timeSteps( );
+    std::vector< double > times;
+    for ( int i = 0; i < timeSteps_; i++ )
+    {
+        times.push_back( source.time( i ) );
+    }
+    timeIndex_ = TimeIndex( times );
+    currentIndex_ = 0;
+    currentStep_ = timestepCache_->get( timeIndex_.step( 0 ) );
+    nextStep_ = currentStep_;
+    numberOfTriangles_ = currentStep_->numberOfTriangles( );
+    time_ = float(timeIndex_.first( ));
+    hasTemperature_ = source.hasTemperature( );
+    scanTemperatures( );
+    updateBVH( *currentStep_ );
+    startLodBuild( );
+}
+
+void SpacecraftRenderingTools::addCase( std::string pathToMesh, std::string pathToTemperature ){
+
+    if ( !std::filesystem::exists( pathToMesh ) )
+    {
+        throw std::runtime_error( "Error, path to case does not exist!" );
+    }
+    // steps of the case whose positions match reuse the geometry of the first
+    // step of the loaded dataset, which is then uploaded to the GPU only once
+    std::shared_ptr< const MeshGeometry > geometry = timestepCache_ ? timestepCache_->geometry( ) : spacecraftData_.front( ).geometry_;
+    ComparisonCase comparison;
+    comparison.name_ = std::filesystem::path( pathToMesh ).filename( ).string( );
+    comparison.cache_ = std::make_unique< TimestepCache >( openTimestepSource( pathToMesh, pathToTemperature ),
+        caseCacheCapacity_, 4, geometry );
+    if ( comparison.cache_->geometry( ) != geometry )
+    {
+        throw std::runtime_error( "Error, " + pathToMesh + " does not have the mesh of the loaded dataset!" );
+    }
+
+    const TimestepSource& source = comparison.cache_->source( );
+    std::vector< double > times;
+    for ( int i = 0; i < source.timeSteps( ); i++ )
+    {
+        times.push_back( source.time( i ) );
+    }
+    comparison.timeIndex_ = TimeIndex( times );
+    if ( source.hasTemperature( ) )
+    {
+        computeTemperatureStatistics( source, comparison.temperatureStatistics_ );
+        // the compact format has to hold the temperatures of every case
+        const ValueRange& global = comparison.temperatureStatistics_.global( );
+        ValueRange& packed = renderer_.packedTemperatureRange_;
+        packed = hasTemperature_ || !cases_.empty( ) ? ValueRange{ std::min( packed.min_, global.min_ ), std::max( packed.max_, global.max_ ) } : global;
+    }
+    std::cout << "case " << comparison.name_ << ": " << source.timeSteps( ) << " timesteps" << std::endl;
+    cases_.push_back( std::move( comparison ) );
+    // the blended steps of every viewport stay on the GPU together
+    renderer_.residentTimesteps_ = std::max( renderer_.residentTimesteps_, 4 * int( cases_.size( ) + 1 ) );
+}
+
+void SpacecraftRenderingTools::useShaderDirectory( std::string directory ){
+    if ( !std::filesystem::is_directory( directory ) )
+    {
+        throw std::runtime_error( "Error, shader directory does not exist!" );
+    }
+    renderer_.shaders_.directory_ = directory;
+    renderer_.reloadShaders( true );
+}
+
+// the simplification runs while the full mesh is already on display
+void SpacecraftRenderingTools::startLodBuild( ){
+
+    renderer_.levelsOfDetail_.reset( );
+    if ( numberOfTriangles_ < lodMinimumTriangles_ )
+    {
+        return;
+    }
+    // up to 8 timesteps spread over the dataset mark the feature edges
+    std::vector< std::shared_ptr< const MeshData > > samples;
+    int count = std::min( timeIndex_.size( ), 8 );
+    for ( int i = 0; i < count; i++ )
+    {
+        int step = timeIndex_.step( count > 1 ? i * ( timeIndex_.size( ) - 1 ) / ( count - 1 ) : 0 );
+        samples.push_back( timestepCache_ ? timestepCache_->get( step )
+            : std::shared_ptr< const MeshData >( std::shared_ptr< const MeshData >( ), &spacecraftData_[ step ] ) );
+    }
+    // levels only apply to the geometry of the first step
+    std::shared_ptr< const MeshGeometry > geometry = samples.front( )->geometry_;
+    samples.erase( std::remove_if( samples.begin( ), samples.end( ),
+        [&]( const std::shared_ptr< const MeshData >& sample ){ return sample->geometry_ != geometry; } ), samples.end( ) );
+    ValueRange temperatureRange = hasTemperature_ ? temperatureStatistics_.global( ) : ValueRange( );
+
+    lodBuild_ = std::async( std::launch::async, [geometry, samples, temperatureRange]( ){
+        auto start = std::chrono::steady_clock::now( );
+        std::vector< const MeshData* > attributes;
+        for ( const auto& sample : samples )
+        {
+            attributes.push_back( sample.get( ) );
+        }
+        std::shared_ptr< const LevelsOfDetail > levels = buildLevelsOfDetail( *geometry, attributes, temperatureRange );
+        double seconds = std::chrono::duration< double >( std::chrono::steady_clock::now( ) - start ).count( );
+        std::ostringstream message;
+        message << "levels of detail in " << seconds << " s:";
+        for ( const DetailLevel& level : levels->levels_ )
+        {
+            message << " " << level.numberOfTriangles( ) << " (" << level.error_ << ")";
+        }
+        std::cout << message.str( ) << std::endl;
+        return levels;
+    } );
+}
+
+// one parallel pass over the temperatures of every timestep, afterwards every
+// range mode is a lookup
+void SpacecraftRenderingTools::scanTemperatures( ){
+
+    if ( !hasTemperature_ )
+    {
+        temperatureStatistics_.reset( 0 );
+        renderer_.packedTemperatureRange_ = ValueRange( );
+        std::cout << "no temperatures in the dataset" << std::endl;
+        return;
+    }
+    auto start = std::chrono::steady_clock::now( );
+    if ( timestepCache_ )
+    {
+        // only the temperature columns are read, nothing enters the cache
+        computeTemperatureStatistics( timestepCache_->source( ), temperatureStatistics_ );
+    }
+    else
+    {
+        temperatureStatistics_.reset( timeSteps_ );
+        parallelFor( timeSteps_, [&]( int i ){
+            const std::vector< float >& temperature = spacecraftData_[ i ].temperature_;
+            temperatureStatistics_.add( i, temperature.data( ), temperature.size( ) );
+        } );
+        temperatureStatistics_.finish( );
+    }
+    double seconds = std::chrono::duration< double >( std::chrono::steady_clock::now( ) - start ).count( );
+    const ValueRange& global = temperatureStatistics_.global( );
+    const ValueRange& percentile = temperatureStatistics_.percentile( );
+    std::cout << "temperature statistics in " << seconds << " s: " << global.min_ << " K to " << global.max_
+              << " K, " << percentile.min_ << " K to " << percentile.max_ << " K between the "
+              << 100.0f * temperatureStatistics_.lowerPercentile_ << " and "
+              << 100.0f * temperatureStatistics_.upperPercentile_ << " % percentiles" << std::endl;
+    // the compact format stores every temperature of the dataset without clamping
+    renderer_.packedTemperatureRange_ = global;
+}
+
+void SpacecraftRenderingTools::measureQuantization( ){
+    std::shared_ptr< const MeshData > mesh = residentStep( timeIndex_.locate( time_ ).lower_ );
+    if ( mesh )
+    {
+        quantizationError_ = measureQuantizationError( mesh->geometry_->positions_, mesh->shadow_,
+            mesh->temperature_, renderer_.packedTemperatureRange_ );
+    }
+}
+
+// range of the displayed time, blended like the attributes while interpolating
+ValueRange SpacecraftRenderingTools::temperatureRange( ) const {
+    TimeIndex::Sample sample = timeIndex_.locate( time_ );
+    ValueRange lower = temperatureStatistics_.range( temperatureRangeMode_, timeIndex_.step( sample.lower_ ) );
+    if ( !interpolate_ )
+    {
+        return lower;
+    }
+    ValueRange upper = temperatureStatistics_.range( temperatureRangeMode_, timeIndex_.step( sample.upper_ ) );
+    return ValueRange::mix( lower, upper, sample.weight_ );
+}
+
+SpacecraftRenderingTools::Frame SpacecraftRenderingTools::currentFrame( ){
+
+    TimeIndex::Sample sample = timeIndex_.locate( time_ );
+
+    if ( !timestepCache_ )
+    {
+        return { &spacecraftData_[ timeIndex_.step( sample.lower_ ) ],
+                 &spacecraftData_[ timeIndex_.step( sample.upper_ ) ], sample.weight_ };
+    }
+
+    if ( sample.lower_ != currentIndex_ )
+    {
+        // prefetch in the direction the slider is moving
+        scrubDirection_ = sample.lower_ > currentIndex_ ? 1 : -1;
+        currentStep_ = timestepCache_->get( timeIndex_.step( sample.lower_ ) );
+        currentIndex_ = sample.lower_;
+        timestepCache_->prefetch( timeIndex_.step( sample.lower_ ), scrubDirection_ );
+    }
+    // the step after is only needed while blending
+    nextStep_ = interpolate_ ? timestepCache_->get( timeIndex_.step( sample.upper_ ) ) : currentStep_;
+    return { currentStep_.get( ), nextStep_.get( ), sample.weight_ };
+}
+
+std::shared_ptr< const MeshData > SpacecraftRenderingTools::residentStep( int position ){
+    int step = timeIndex_.step( position );
+    if ( timestepCache_ )
+    {
+        return timestepCache_->peek( step );
+    }
+    // non-owning, spacecraftData_ outlives every user
+    return std::shared_ptr< const MeshData >( std::shared_ptr< const MeshData >( ), &spacecraftData_[ step ] );
+}
+
+bool SpacecraftRenderingTools::isReady( int position ){
+    std::shared_ptr< const MeshData > mesh = residentStep( position );
+    return mesh && renderer_.isResident( *mesh );
+}
+
+void SpacecraftRenderingTools::stageTimestep( int position ){
+    if ( stager_->busy( ) || isReady( position ) )
+    {
+        return;
+    }
+    stager_->submit( timeIndex_.step( position ), renderer_.mapStaging( size_t( numberOfTriangles_ ) ) );
+}
+
+void SpacecraftRenderingTools::updatePlayback( ){
+
+    if ( !stager_ )
+    {
+        stager_ = std::make_unique< TimestepStager >( [this]( int step ){
+            if ( timestepCache_ )
+            {
+                return timestepCache_->get( step );
+            }
+            return std::shared_ptr< const MeshData >( std::shared_ptr< const MeshData >( ), &spacecraftData_[ step ] );
+        } );
+    }
+
+    // attributes prepared by the worker during the previous frame become resident
+    TimestepStager::Result result;
+    if ( stager_->collect( result ) )
+    {
+        renderer_.commitStaging( result.slot_, result.revision_ );
+    }
+
+    if ( !playback_.playing_ )
+    {
+        return;
+    }
+
+    double time = playback_.advance( timeIndex_.first( ), timeIndex_.last( ) );
+    TimeIndex::Sample sample = timeIndex_.locate( time );
+    bool lowerReady = isReady( sample.lower_ );
+    if ( !lowerReady || ( interpolate_ && !isReady( sample.upper_ ) ) )
+    {
+        // keep showing the previous frame rather than stalling on the upload
+        playback_.frameDropped( );
+        stageTimestep( lowerReady ? sample.upper_ : sample.lower_ );
+        return;
+    }
+    time_ = float(time);
+
+    // prepare what the next frame will need while this one is displayed
+    double duration = timeIndex_.last( ) - timeIndex_.first( );
+    double nextTime = time + playback_.speed_ / std::max( playback_.targetFps_, 1.0f );
+    if ( nextTime > timeIndex_.last( ) && playback_.loop_ && duration > 0.0 )
+    {
+        nextTime = timeIndex_.first( ) + std::fmod( nextTime - timeIndex_.first( ), duration );
+    }
+    TimeIndex::Sample next = timeIndex_.locate( nextTime );
+    stageTimestep( isReady( next.lower_ ) && interpolate_ ? next.upper_ : next.lower_ );
+}
+
+void SpacecraftRenderingTools::stepTime( int direction ){
+    playback_.pause( );
+    TimeIndex::Sample sample = timeIndex_.locate( time_ );
+    int position = sample.lower_;
+    if ( direction > 0 )
+    {
+        position = std::min( position + 1, timeIndex_.size( ) - 1 );
+    }
+    else if ( sample.weight_ == 0.0f )
+    {
+        position = std::max( position - 1, 0 );
+    }
+    time_ = float(timeIndex_.time( position ));
+}
+
+void SpacecraftRenderingTools::drawPlaybackControls( ){
+
+    if (ImGui::Button(playback_.playing_ ? "Pause" : "Play")){
+        if ( playback_.playing_ ){
+            playback_.pause( );
+        }
+        else {
+            if ( time_ >= float(timeIndex_.last( )) ){
+                time_ = float(timeIndex_.first( ));
+            }
+            playback_.play( time_ );
+        }
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("<")){
+        stepTime( -1 );
+    }
+    ImGui::SameLine();
+    if (ImGui::Button(">")){
+        stepTime( 1 );
+    }
+    ImGui::SameLine();
+    ImGui::Checkbox("loop", &playback_.loop_);
+    ImGui::SetNextItemWidth(200.0f);
+    ImGui::SliderFloat("speed [s/s]", &playback_.speed_, 0.1f, 10000.0f, "%.1f", ImGuiSliderFlags_Logarithmic);
+    ImGui::SetNextItemWidth(200.0f);
+    ImGui::SliderFloat("target fps", &playback_.targetFps_, 10.0f, 144.0f, "%.0f");
+    ImGui::Text("frames: %zu  late: %zu  dropped: %zu  (%.1f ms)",
+        playback_.frames_, playback_.late_, playback_.dropped_, playback_.frameTime_);
+    ImGui::SameLine();
+    if (ImGui::Button("reset")){
+        playback_.resetStatistics( );
+    }
+}
+
+void SpacecraftRenderingTools::printMemoryFootprint( ){
+
+    size_t geometryBytes = 0;
+    size_t attributeBytes = 0;
+    const MeshGeometry* previous = nullptr;
+    for ( const auto& mesh : spacecraftData_ )
+    {
+        if ( mesh.geometry_.get( ) != previous )
+        {
+            geometryBytes += mesh.geometry_->positions_.size( ) * sizeof( glm::vec3 ) +
+                mesh.geometry_->indices_.size( ) * sizeof( uint32_t );
+            previous = mesh.geometry_.get( );
+        }
+        attributeBytes += ( mesh.shadow_.size( ) + mesh.temperature_.size( ) ) * sizeof( float );
+    }
+    double megabyte = 1024.0 * 1024.0;
+    const MeshGeometry& geometry = *spacecraftData_.front( ).geometry_;
+    std::cout << "geometry " << ( sharedGeometry_ ? "shared by all timesteps" : "stored per timestep" )
+              << ": " << 3 * geometry.numberOfTriangles( ) << " corners welded to "
+              << geometry.positions_.size( ) << " vertices, "
+              << geometryBytes / megabyte << " MB positions and indices, "
+              << attributeBytes / megabyte << " MB attributes" << std::endl;
 }
 
 void SpacecraftRenderingTools::drawGUI( ){
@@ -99,30 +591,133 @@ void SpacecraftRenderingTools::drawGUI( ){
     ImGui::InputTextWithHint("save to ", pathToFolder_.data(), pathToFolder_.data(), pathToFolder_.size());
     if (ImGui::Button("Screenshot")){
         takeScreenshot_ = 1;
+    }
+    ImGui::SameLine();
+    ImGui::Checkbox("record every frame", &recording_);
+    if (screenshotCount_ > 0){
         ImGui::SameLine();
-        ImGui::Text("Screenshot saved!");
+        ImGui::Text("%zu saved", imageWriter_.written( ));
     }
     ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x*0.75f);
-    ImGui::SliderFloat("Time [s]", &time_, float(times_[ 0 ]), float(times_[ times_.size()-1 ]));
+    if (ImGui::SliderFloat("Time [s]", &time_, float(timeIndex_.first( )), float(timeIndex_.last( )))){
+        playback_.seek( time_ );
+    }
+    drawPlaybackControls( );
+    ImGui::Checkbox("interpolate between timesteps", &interpolate_);
+    ImGui::SameLine();
+    ImGui::Text("step %d / %d", timeIndex_.locate( time_ ).lower_ + 1, timeIndex_.size( ));
     if (ImGui::CollapsingHeader("Generic options"))
     {
         ImGui::ColorEdit4("background color", backgroundColor_);
         ImGui::Checkbox("wireframe overlay", &renderer_.wireFrameOverlay_);
+        ImGui::SameLine();
+        ImGui::Checkbox("single pass", &renderer_.singlePassOverlay_);
+        if ( renderer_.singlePassOverlay_ ){
+            ImGui::SetNextItemWidth(200.0f);
+            ImGui::SliderFloat("line width [px]", &renderer_.wireframeWidth_, 0.5f, 5.0f);
+        }
+        ImGui::SliderInt("GPU resident timesteps", &renderer_.residentTimesteps_, 1, 64);
+        if ( renderer_.levelsOfDetail_ ){
+            ImGui::Checkbox("level of detail", &renderer_.levelOfDetail_);
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(150.0f);
+            ImGui::SliderFloat("max error [px]", &renderer_.lodPixelError_, 0.25f, 8.0f);
+            int level = renderer_.drawnLevel_;
+            if ( level >= 0 ){
+                ImGui::Text("drawing level %d of %zu: %d of %d triangles", level + 1, renderer_.levelsOfDetail_->levels_.size( ),
+                    renderer_.levelsOfDetail_->levels_[ level ].numberOfTriangles( ), numberOfTriangles_);
+            }
+            else {
+                ImGui::Text("drawing the full mesh: %d triangles", numberOfTriangles_);
+            }
+        }
+        else if ( lodBuild_.valid( ) ){
+            ImGui::TextDisabled("building levels of detail ...");
+        }
+        ImGui::Text("uploaded: %.1f MB", renderer_.uploadedBytes_ / ( 1024.0 * 1024.0 ));
+        const GLCounters& gl = renderer_.state_.lastFrame_;
+        ImGui::Text("last frame: %zu GL calls, %zu state changes, %zu uniforms, %zu skipped, %.1f KB uploaded",
+            gl.calls_, gl.stateChanges_, gl.uniforms_, gl.skipped_, gl.uploadedBytes_ / 1024.0);
+        ImGui::Text("shaders: %s, %s in %.1f ms", renderer_.shaders_.directory_.empty( ) ? "embedded" : renderer_.shaders_.directory_.c_str( ),
+            renderer_.shaders_.fromCache_ ? "program cache" : "compiled", 1000.0 * renderer_.shaders_.linkSeconds_);
+        if ( ImGui::Checkbox("compact vertex format", &renderer_.compactVertices_) && renderer_.compactVertices_ ){
+            measureQuantization( );
+        }
+        if ( renderer_.compactVertices_ ){
+            ImGui::Text("max error: position %.2e (%.1e of the diagonal)", quantizationError_.position_,
+                quantizationError_.positionRelative_);
+            ImGui::Text("           shadow %.4f, temperature %.4f K", quantizationError_.shadow_,
+                quantizationError_.temperature_);
+        }
+        ImGui::Checkbox("render only on changes", &onDemand_);
+        ImGui::SameLine();
+        ImGui::Text("%zu frames drawn", framesDrawn_);
+    }
+    if (timestepCache_ && ImGui::CollapsingHeader("Streaming"))
+    {
+        ImGui::SetNextItemWidth(200.0f);
+        if (ImGui::SliderInt("cached timesteps", &cacheCapacity_, 2, std::max(timeSteps_, 2))){
+            timestepCache_->setCapacity( cacheCapacity_ );
+        }
+        size_t hits = timestepCache_->hits( );
+        size_t misses = timestepCache_->misses( );
+        double stepMegabytes = double( numberOfTriangles_ ) * 2 * sizeof( float ) / ( 1024.0 * 1024.0 );
+        ImGui::Text("resident: %d / %d (%.1f MB attributes)", timestepCache_->resident( ), timestepCache_->capacity( ),
+            timestepCache_->resident( ) * stepMegabytes);
+        ImGui::Text("hits: %zu  misses: %zu  hit rate: %.1f %%", hits, misses,
+            hits + misses > 0 ? 100.0 * double( hits ) / double( hits + misses ) : 0.0);
+        ImGui::Text("prefetched: %zu (depth %d, %s)", timestepCache_->prefetched( ), timestepCache_->prefetchDepth( ),
+            scrubDirection_ > 0 ? "forward" : "backward");
+        if ( auto compressed = dynamic_cast< const CompressedTimestepSource* >( &timestepCache_->source( ) ) ){
+            const CompressedDataset& dataset = compressed->dataset( );
+            ImGui::Text("compressed: %.1f MB, %.1fx smaller, keyframe every %d steps", dataset.size( ) / ( 1024.0 * 1024.0 ),
+                double( dataset.uncompressedSize( ) ) / double( dataset.size( ) ), dataset.keyframeInterval( ));
+        }
+    }
+    if (!cases_.empty( ) && ImGui::CollapsingHeader("Comparison"))
+    {
+        drawComparisonControls( );
+    }
+    if (ImGui::CollapsingHeader("Profiler"))
+    {
+        drawProfiler( );
+    }
+    if (ImGui::CollapsingHeader("Picking"))
+    {
+        drawPicking( );
+    }
+    if (ImGui::CollapsingHeader("Ray-traced shadows"))
+    {
+        drawShadowControls( );
     }
     if (ImGui::CollapsingHeader("Properties"))
     {
         const char* items[] = { "Wireframe only", "Self-shadowing", "Temperature" };
         ImGui::Combo("View mode", &setMode_, items, IM_ARRAYSIZE(items), IM_ARRAYSIZE(items));
         setMode( setMode_ );
+        if ( setMode_ == 2 ){
+            if ( hasTemperature_ ){
+                int rangeMode = int( temperatureRangeMode_ );
+                const char* rangeModes[] = { "global min / max", "timestep min / max", "global percentiles" };
+                ImGui::Combo("temperature range", &rangeMode, rangeModes, IM_ARRAYSIZE(rangeModes));
+                temperatureRangeMode_ = RangeMode( rangeMode );
+                ValueRange range = temperatureRange( );
+                ImGui::Text("%.1f K to %.1f K", range.min_, range.max_);
+            }
+            else {
+                ImGui::TextDisabled("no temperatures in the dataset, see --temperature");
+            }
+        }
         if ( setMode_ == 1 || setMode_ == 2 ){
+            drawColormapControls( );
             ImGui::SeparatorText("Colorbar properties");
             
-            ImGui::SliderFloat("x position", &xColorbar_, 0.1f, 0.8f);
-            ImGui::SliderFloat("y position", &yColorbar_, 0.1f, 0.8f);
-            ImGui::SliderFloat("size", &sizeColorbar_, 1.0f, 3.0f);
-            ImGui::SliderFloat("fontsize", &fontSize_, 10.0f, 20.0f);
-            ImGui::RadioButton("vertical", &verticalColorbar_, 1); ImGui::SameLine();
-            ImGui::RadioButton("horizontal", &verticalColorbar_, 0); ImGui::SameLine();
+            ImGui::SliderFloat("x position", &colorbar_.x_, 0.1f, 0.8f);
+            ImGui::SliderFloat("y position", &colorbar_.y_, 0.1f, 0.8f);
+            ImGui::SliderFloat("size", &colorbar_.size_, 1.0f, 3.0f);
+            ImGui::SliderFloat("fontsize", &colorbar_.fontSize_, 10.0f, 20.0f);
+            ImGui::RadioButton("vertical", &colorbar_.vertical_, 1); ImGui::SameLine();
+            ImGui::RadioButton("horizontal", &colorbar_.vertical_, 0); ImGui::SameLine();
             
         }
         
@@ -132,6 +727,12 @@ void SpacecraftRenderingTools::drawGUI( ){
 
 void SpacecraftRenderingTools::updateRender( ) {
 
+    std::optional< ProfileScope > stage( std::in_place, &profiler_, ProfileStage::UPDATE );
+    updatePlayback( );
+    if ( lodBuild_.valid( ) && lodBuild_.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready ){
+        renderer_.levelsOfDetail_ = lodBuild_.get( );
+    }
+
     // rotation matrices
     view_ = getViewMatrix();
     projection_ = glm::perspective(
@@ -141,56 +742,609 @@ void SpacecraftRenderingTools::updateRender( ) {
         1000.0f
     );
 
-    if (takeScreenshot_){
-        glClearColor(backgroundColor_[0], backgroundColor_[1], backgroundColor_[2], backgroundColor_[3]);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        ImGui_ImplOpenGL3_NewFrame();
-        ImGui_ImplGlfw_NewFrame();
-        ImGui::NewFrame();
-
-        renderer_.renderMesh( spacecraftData_.at( time_ ), view_, projection_, visualizationMode_ );
-        if ( setMode_ == 1 || setMode_ == 2 ){
-        drawColorbar( );
-        }
-        ImGui::Render();
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-        screenshot( );
-        takeScreenshot_ = 0;
-    }
-    
     glClearColor(backgroundColor_[0], backgroundColor_[1], backgroundColor_[2], backgroundColor_[3]);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
+    stage.reset( );
 
-    renderer_.renderMesh( spacecraftData_.at( time_ ), view_, projection_, visualizationMode_ );
+    renderMesh( );
     if ( setMode_ == 1 || setMode_ == 2 ){
+        ProfileScope colorbarStage( &profiler_, ProfileStage::COLORBAR );
         drawColorbar( );
     }
+    stage.emplace( &profiler_, ProfileStage::GUI );
     drawGUI( );
     ImGui::Render();
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
+    if ( takeScreenshot_ || recording_ ){
+        // screenshots show the colorbar but not the control panel, so the
+        // foreground list is drawn and read back before the panel windows
+        ImDrawData* drawData = ImGui::GetDrawData();
+        ImDrawData overlay = *drawData;
+        ImDrawData panel = *drawData;
+        for ( ImDrawData* part : { &overlay, &panel } ){
+            part->CmdLists.clear();
+            part->CmdListsCount = part->TotalVtxCount = part->TotalIdxCount = 0;
+        }
+        for ( int i = 0; i < drawData->CmdListsCount; i++ ){
+            ImDrawList* list = drawData->CmdLists[i];
+            ( list == ImGui::GetForegroundDrawList() ? overlay : panel ).AddDrawList( list );
+        }
+        ImGui_ImplOpenGL3_RenderDrawData(&overlay);
+        screenshot( );
+        ImGui_ImplOpenGL3_RenderDrawData(&panel);
+        takeScreenshot_ = 0;
+    }
+    else{
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    }
+    collectScreenshots( );
+
+}
+
+void SpacecraftRenderingTools::drawProfiler( ){
+
+    ImGui::Checkbox("enable profiler", &profiler_.enabled_);
+    if ( profiler_.enabled_ && onDemand_ ){
+        ImGui::SameLine();
+        ImGui::TextDisabled("(frames are only drawn on changes)");
+    }
+
+    const std::deque< FrameTiming >& history = profiler_.history( );
+    if ( !history.empty( ) ){
+        std::vector< float > frameTimes;
+        frameTimes.reserve( history.size( ) );
+        for ( const FrameTiming& timing : history ){
+            frameTimes.push_back( float( timing.frameTime_ ) );
+        }
+        FrameTiming mean = profiler_.average( 60 );
+        char label[ 64 ];
+        std::snprintf( label, sizeof( label ), "%.2f ms (%.0f fps)", mean.frameTime_,
+            mean.frameTime_ > 0.0 ? 1000.0 / mean.frameTime_ : 0.0 );
+        ImGui::PlotLines("frame time", frameTimes.data(), int(frameTimes.size()), 0, label,
+            0.0f, 3.4e38f, ImVec2(0, 60.0f));
+
+        // mean of the last 60 frames, GPU time only for stages issuing GL commands
+        if (ImGui::BeginTable("stages", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)){
+            ImGui::TableSetupColumn("stage");
+            ImGui::TableSetupColumn("CPU [ms]");
+            ImGui::TableSetupColumn("GPU [ms]");
+            ImGui::TableHeadersRow();
+            for ( int i = 0; i < profileStageCount; i++ ){
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::Text("%s", profileStageName( ProfileStage( i ) ));
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", mean.cpu_[i]);
+                ImGui::TableNextColumn();
+                if ( mean.gpu_[i] >= 0.0 ){
+                    ImGui::Text("%.3f", mean.gpu_[i]);
+                }
+                else {
+                    ImGui::TextDisabled("-");
+                }
+            }
+            ImGui::EndTable();
+        }
+    }
+
+    ImGui::SetNextItemWidth(300.0f);
+    ImGui::InputText("csv file", profilePath_.data(), profilePath_.size());
+    if ( profiler_.writingCsv( ) ){
+        if (ImGui::Button("Stop CSV")){
+            profiler_.stopCsv( );
+        }
+        ImGui::SameLine();
+        ImGui::Text("writing %s", profiler_.csvPath( ).c_str());
+    }
+    else if (ImGui::Button("Write CSV")){
+        // the comment line identifies the run when comparing datasets
+        std::ostringstream comment;
+        comment << datasetPath_ << ", " << numberOfTriangles_ << " triangles, "
+                << timeIndex_.size( ) << " timesteps, "
+                << reinterpret_cast< const char* >( glGetString(GL_RENDERER) );
+        try {
+            profiler_.startCsv( profilePath_.data(), comment.str( ) );
+            profiler_.enabled_ = true;
+        }
+        catch ( const std::runtime_error& error ){
+            std::cerr << error.what( ) << std::endl;
+        }
+    }
+}
+
+SpacecraftRenderingTools::ViewState SpacecraftRenderingTools::viewState( ) const {
+    ViewState state;
+    state.rotation_ = rotation_;
+    state.panOffset_ = panOffset_;
+    state.cameraDistance_ = cameraDistance_;
+    state.time_ = time_;
+    state.interpolate_ = interpolate_;
+    state.visualizationMode_ = visualizationMode_;
+    state.temperatureRangeMode_ = temperatureRangeMode_;
+    state.shadowColormap_ = renderer_.shadowColormap_;
+    state.temperatureColormap_ = renderer_.temperatureColormap_;
+    state.wireFrameOverlay_ = renderer_.wireFrameOverlay_;
+    state.singlePassOverlay_ = renderer_.singlePassOverlay_;
+    state.wireframeWidth_ = renderer_.wireframeWidth_;
+    state.levelOfDetail_ = renderer_.levelOfDetail_;
+    state.lodPixelError_ = renderer_.lodPixelError_;
+    state.differenceView_ = differenceView_;
+    state.differenceCase_ = differenceCase_;
+    state.shadowDifferenceRange_ = shadowDifferenceRange_;
+    state.temperatureDifferenceRange_ = temperatureDifferenceRange_;
+    state.traceShadows_ = traceShadows_;
+    state.customSun_ = customSun_;
+    state.sunAzimuth_ = sunAzimuth_;
+    state.sunElevation_ = sunElevation_;
+    state.tracedDifference_ = tracedDifference_;
+    state.shadowSubdivisions_ = shadowSettings_.subdivisions_;
+    state.backFacesShadowed_ = shadowSettings_.backFacesShadowed_;
+    std::copy( backgroundColor_, backgroundColor_ + 4, state.backgroundColor_ );
+    state.colorbar_ = colorbar_;
+    state.windowWidth_ = windowWidth_;
+    state.windowHeight_ = windowHeight_;
+    return state;
+}
+
+bool SpacecraftRenderingTools::ViewState::operator==( const ViewState& other ) const {
+    return rotation_ == other.rotation_ && panOffset_ == other.panOffset_ &&
+           cameraDistance_ == other.cameraDistance_ && time_ == other.time_ &&
+           interpolate_ == other.interpolate_ && visualizationMode_ == other.visualizationMode_ &&
+           temperatureRangeMode_ == other.temperatureRangeMode_ &&
+           shadowColormap_ == other.shadowColormap_ && temperatureColormap_ == other.temperatureColormap_ &&
+           wireFrameOverlay_ == other.wireFrameOverlay_ &&
+           singlePassOverlay_ == other.singlePassOverlay_ && wireframeWidth_ == other.wireframeWidth_ &&
+           levelOfDetail_ == other.levelOfDetail_ && lodPixelError_ == other.lodPixelError_ &&
+           differenceView_ == other.differenceView_ && differenceCase_ == other.differenceCase_ &&
+           shadowDifferenceRange_ == other.shadowDifferenceRange_ &&
+           temperatureDifferenceRange_ == other.temperatureDifferenceRange_ &&
+           traceShadows_ == other.traceShadows_ && customSun_ == other.customSun_ &&
+           sunAzimuth_ == other.sunAzimuth_ && sunElevation_ == other.sunElevation_ &&
+           tracedDifference_ == other.tracedDifference_ && shadowSubdivisions_ == other.shadowSubdivisions_ &&
+           backFacesShadowed_ == other.backFacesShadowed_ &&
+           std::equal( backgroundColor_, backgroundColor_ + 4, other.backgroundColor_ ) &&
+           colorbar_.x_ == other.colorbar_.x_ && colorbar_.y_ == other.colorbar_.y_ &&
+           colorbar_.vertical_ == other.colorbar_.vertical_ && colorbar_.size_ == other.colorbar_.size_ &&
+           colorbar_.fontSize_ == other.colorbar_.fontSize_ &&
+           windowWidth_ == other.windowWidth_ && windowHeight_ == other.windowHeight_;
+}
+
+// true while the last frame is out of date or something needs a stream of frames
+bool SpacecraftRenderingTools::needsRedraw( ){
+
+    // shader files edited while developing
+    if ( renderer_.reloadShaders( ) ){
+        return true;
+    }
+
+    if ( !onDemand_ || playback_.playing_ || recording_ || takeScreenshot_ || redrawFrames_ > 0 ){
+        return true;
+    }
+    // attributes staged on the worker still have to be committed
+    if ( stager_ && stager_->busy( ) ){
+        return true;
+    }
+    // levels of detail or traced shadows finished in the background
+    if ( lodBuild_.valid( ) && lodBuild_.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready ){
+        return true;
+    }
+    if ( traceShadows_ && shadowTrace_.valid( ) && shadowTrace_.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready ){
+        return true;
+    }
+    ViewState state = viewState( );
+    if ( state == lastState_ ){
+        return false;
+    }
+    lastState_ = state;
+    return true;
+}
+
+void SpacecraftRenderingTools::renderMesh( ) {
+    Frame frame = currentFrame( );
+    // cases share the temperature scale of the loaded dataset
+    renderer_.temperatureRange_ = temperatureRange( );
+    // traced shadows replace those of the dataset, without blending
+    const MeshData* traced = traceShadows_ ? updateShadowTrace( *frame.lower_ ) : nullptr;
+    const MeshData* dataset = frame.lower_;
+    if ( traced )
+    {
+        frame = { traced, traced, 0.0f };
+    }
+    if ( !cases_.empty( ) )
+    {
+        renderCases( frame );
+        return;
+    }
+    if ( traced && tracedDifference_ )
+    {
+        renderer_.renderDifference( *traced, *dataset, view_, projection_, VisualizationMode::SHADOW, shadowDifferenceRange_ );
+    }
+    else
+    {
+        renderer_.renderMesh( *frame.lower_, view_, projection_, visualizationMode_,
+            interpolate_ ? frame.upper_ : nullptr, frame.weight_ );
+    }
+    int width, height;
+    glfwGetWindowSize( window_, &width, &height );
+    updatePicking( frame, projection_, glm::vec4( 0.0f, 0.0f, float( width ), float( height ) ) );
+}
+
+SpacecraftRenderingTools::Frame SpacecraftRenderingTools::caseFrame( ComparisonCase& comparison ){
+
+    TimeIndex::Sample sample = comparison.timeIndex_.locate( time_ );
+    if ( sample.lower_ != comparison.currentIndex_ )
+    {
+        int direction = sample.lower_ > comparison.currentIndex_ ? 1 : -1;
+        comparison.currentStep_ = comparison.cache_->get( comparison.timeIndex_.step( sample.lower_ ) );
+        comparison.currentIndex_ = sample.lower_;
+        comparison.cache_->prefetch( comparison.timeIndex_.step( sample.lower_ ), direction );
+    }
+    comparison.nextStep_ = interpolate_ ? comparison.cache_->get( comparison.timeIndex_.step( sample.upper_ ) ) : comparison.currentStep_;
+    return { comparison.currentStep_.get( ), comparison.nextStep_.get( ), sample.weight_ };
+}
+
+// the loaded dataset, every case and the difference view in a grid of
+// viewports, all with the camera of the main view
+void SpacecraftRenderingTools::renderCases( const Frame& frame ){
+
+    std::vector< Frame > frames = { frame };
+    std::vector< std::string > labels = { std::filesystem::path( datasetPath_ ).filename( ).string( ) };
+    for ( ComparisonCase& comparison : cases_ )
+    {
+        frames.push_back( caseFrame( comparison ) );
+        labels.push_back( comparison.name_ );
+    }
+    differenceCase_ = std::clamp( differenceCase_, 0, int( cases_.size( ) ) - 1 );
+    bool difference = differenceView_ && visualizationMode_ != VisualizationMode::WIREFRAME;
+    float differenceRange = visualizationMode_ == VisualizationMode::TEMPERATURE ? temperatureDifferenceRange_ : shadowDifferenceRange_;
+    if ( difference )
+    {
+        std::ostringstream label;
+        label << labels.front( ) << " - " << labels[ differenceCase_ + 1 ] << ", +-" << differenceRange
+              << ( visualizationMode_ == VisualizationMode::TEMPERATURE ? " K" : "" );
+        labels.push_back( label.str( ) );
+    }
+    int views = int( labels.size( ) );
+    int columns = int( std::ceil( std::sqrt( double( views ) ) ) );
+    int rows = ( views + columns - 1 ) / columns;
+
+    // viewports are in framebuffer pixels, the cursor and ImGui in window coordinates
+    int width, height;
+    glfwGetWindowSize( window_, &width, &height );
+    float scale = float( width ) / float( std::max( windowWidth_, 1 ) );
+    double cursorX, cursorY;
+    glfwGetCursorPos( window_, &cursorX, &cursorY );
+    int hovered = 0;
+    glm::mat4 hoveredProjection = projection_;
+    glm::vec4 hoveredViewport( 0.0f, 0.0f, float( width ), float( height ) );
+    bool brightBackground = backgroundColor_[0] + backgroundColor_[1] + backgroundColor_[2] > 1.5f;
+
+    glEnable(GL_SCISSOR_TEST);
+    for ( int v = 0; v < views; v++ )
+    {
+        // the first row at the top, GL counts rows from the bottom
+        int x0 = windowWidth_ * ( v % columns ) / columns;
+        int x1 = windowWidth_ * ( v % columns + 1 ) / columns;
+        int y0 = windowHeight_ * ( v / columns ) / rows;
+        int y1 = windowHeight_ * ( v / columns + 1 ) / rows;
+        glViewport(x0, windowHeight_ - y1, x1 - x0, y1 - y0);
+        glScissor(x0, windowHeight_ - y1, x1 - x0, y1 - y0);
+        glm::mat4 projection = glm::perspective( glm::radians( 10.0f ), float( x1 - x0 ) / float( std::max( y1 - y0, 1 ) ), 0.1f, 1000.0f );
+        if ( v < int( frames.size( ) ) )
+        {
+            const Frame& drawn = frames[ v ];
+            renderer_.renderMesh( *drawn.lower_, view_, projection, visualizationMode_,
+                interpolate_ ? drawn.upper_ : nullptr, drawn.weight_ );
+        }
+        else
+        {
+            // steps at or before the cursor, without blending
+            renderer_.renderDifference( *frames.front( ).lower_, *frames[ differenceCase_ + 1 ].lower_,
+                view_, projection, visualizationMode_, differenceRange );
+        }
+        glm::vec4 viewport( x0 * scale, y0 * scale, ( x1 - x0 ) * scale, ( y1 - y0 ) * scale );
+        if ( cursorX >= viewport.x && cursorX < viewport.x + viewport.z && cursorY >= viewport.y && cursorY < viewport.y + viewport.w )
+        {
+            hovered = v;
+            hoveredProjection = projection;
+            hoveredViewport = viewport;
+        }
+        ImGui::GetForegroundDrawList()->AddText( ImVec2( viewport.x + 8.0f, viewport.y + 8.0f ),
+            brightBackground ? IM_COL32( 0, 0, 0, 255 ) : IM_COL32( 255, 255, 255, 255 ), labels[ v ].c_str( ) );
+    }
+    glDisable(GL_SCISSOR_TEST);
+    glViewport(0, 0, windowWidth_, windowHeight_);
+
+    // values under the cursor come from the case it points at, the difference
+    // view reports the loaded dataset
+    updatePicking( frames[ hovered < int( frames.size( ) ) ? hovered : 0 ], hoveredProjection, hoveredViewport );
+}
+
+bool SpacecraftRenderingTools::TraceRequest::operator==( const TraceRequest& other ) const {
+    return revision_ == other.revision_ && sun_ == other.sun_ && subdivisions_ == other.subdivisions_ &&
+           backFacesShadowed_ == other.backFacesShadowed_;
+}
+
+glm::vec3 SpacecraftRenderingTools::traceSun( const MeshData& mesh ) const {
+    if ( !customSun_ )
+    {
+        return mesh.sunPosition_;
+    }
+    float azimuth = glm::radians( sunAzimuth_ );
+    float elevation = glm::radians( sunElevation_ );
+    return glm::vec3( std::cos( elevation ) * std::cos( azimuth ), std::cos( elevation ) * std::sin( azimuth ), std::sin( elevation ) );
+}
+
+// starts a trace when the timestep, the sun or the settings changed and none
+// is running, returns the last finished trace of the same geometry
+const MeshData* SpacecraftRenderingTools::updateShadowTrace( const MeshData& mesh ){
+
+    if ( shadowTrace_.valid( ) && shadowTrace_.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready )
+    {
+        TraceResult result = shadowTrace_.get( );
+        tracedStep_ = result.mesh_;
+        traceSeconds_ = result.seconds_;
+    }
+    TraceRequest request;
+    request.revision_ = mesh.revision_;
+    request.sun_ = traceSun( mesh );
+    request.subdivisions_ = shadowSettings_.subdivisions_;
+    request.backFacesShadowed_ = shadowSettings_.backFacesShadowed_;
+    if ( !shadowTrace_.valid( ) && !( request == traceRequest_ ) && glm::dot( request.sun_, request.sun_ ) > 0.0f )
+    {
+        traceRequest_ = request;
+        updateBVH( mesh );
+        // the trace owns its copy of the step and keeps the BVH alive
+        auto traced = std::make_shared< MeshData >( mesh );
+        std::shared_ptr< const TriangleBVH > bvh = bvh_;
+        ShadowSettings settings = shadowSettings_;
+        shadowTrace_ = std::async( std::launch::async, [traced, bvh, settings, sun = request.sun_]( ){
+            auto start = std::chrono::steady_clock::now( );
+            traceShadows( *bvh, sun, traced->shadow_, settings );
+            traced->revision_ = nextRevision( );
+            double seconds = std::chrono::duration< double >( std::chrono::steady_clock::now( ) - start ).count( );
+            return TraceResult{ traced, seconds };
+        } );
+    }
+    return tracedStep_ && tracedStep_->geometry_ == mesh.geometry_ ? tracedStep_.get( ) : nullptr;
+}
+
+void SpacecraftRenderingTools::drawShadowControls( ){
+
+    ImGui::Checkbox("trace shadows of the displayed timestep", &traceShadows_);
+    if ( !traceShadows_ ){
+        return;
+    }
+    ImGui::Checkbox("sun from the panel", &customSun_);
+    if ( customSun_ ){
+        ImGui::SetNextItemWidth(200.0f);
+        ImGui::SliderFloat("azimuth [deg]", &sunAzimuth_, -180.0f, 180.0f);
+        ImGui::SetNextItemWidth(200.0f);
+        ImGui::SliderFloat("elevation [deg]", &sunElevation_, -90.0f, 90.0f);
+    }
+    else {
+        glm::vec3 sun = traceRequest_.sun_;
+        ImGui::Text("sun of the timestep: %.3f %.3f %.3f", sun.x, sun.y, sun.z);
+    }
+    ImGui::SetNextItemWidth(200.0f);
+    ImGui::SliderInt("subdivisions", &shadowSettings_.subdivisions_, 1, 4);
+    ImGui::SameLine();
+    ImGui::Text("%d rays per triangle", shadowSettings_.samplesPerTriangle( ));
+    ImGui::Checkbox("back faces in shadow", &shadowSettings_.backFacesShadowed_);
+    ImGui::Checkbox("difference to the dataset", &tracedDifference_);
+    if ( tracedDifference_ ){
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(150.0f);
+        ImGui::SliderFloat("range", &shadowDifferenceRange_, 0.01f, 1.0f);
+    }
+    if ( shadowTrace_.valid( ) ){
+        ImGui::TextDisabled("tracing ...");
+    }
+    else if ( tracedStep_ ){
+        ImGui::Text("%d triangles traced in %.0f ms on %d threads", tracedStep_->numberOfTriangles( ), 1000.0 * traceSeconds_,
+            hardwareThreads( ));
+    }
+}
+
+// rebuilt only when the displayed timestep brings a different geometry
+void SpacecraftRenderingTools::updateBVH( const MeshData& mesh ){
+    if ( bvh_ && bvh_->geometry( ) == mesh.geometry_.get( ) )
+    {
+        return;
+    }
+    bool first = !bvh_;
+    auto start = std::chrono::steady_clock::now( );
+    bvh_ = std::make_shared< const TriangleBVH >( mesh.geometry_ );
+    bvhSeconds_ = std::chrono::duration< double >( std::chrono::steady_clock::now( ) - start ).count( );
+    if ( first )
+    {
+        std::cout << "picking BVH with " << bvh_->nodes( ) << " nodes, depth " << bvh_->depth( )
+                  << ", built in " << bvhSeconds_ << " s" << std::endl;
+    }
+}
+
+// one ray per drawn frame from the cursor, a click selects the triangle under it
+void SpacecraftRenderingTools::updatePicking( const Frame& frame, const glm::mat4& projection, const glm::vec4& viewport ){
+
+    bool click = pickRequested_;
+    pickRequested_ = false;
+    if ( !hoverPicking_ && !click )
+    {
+        hover_ = RayHit( );
+        return;
+    }
+    // the same rule as Renderer::renderMesh: attributes are only blended between
+    // steps of the same geometry, otherwise the nearer step is shown
+    const MeshData* upper = interpolate_ ? frame.upper_ : nullptr;
+    const MeshData* shown = frame.lower_;
+    float weight = 0.0f;
+    if ( upper && upper->geometry_ == frame.lower_->geometry_ )
+    {
+        weight = frame.weight_;
+    }
+    else if ( upper && frame.weight_ >= 0.5f )
+    {
+        shown = upper;
+    }
+    if ( weight == 0.0f )
+    {
+        upper = shown;
+    }
+
+    // the last triangle stays on display while the cursor is over the panel
+    if ( !ImGui::GetIO().WantCaptureMouse && !isDragging_ && !isPanning_ )
+    {
+        updateBVH( *shown );
+        // cursor positions are in window coordinates, which differ from the framebuffer on HiDPI screens
+        double x, y;
+        glfwGetCursorPos( window_, &x, &y );
+        auto start = std::chrono::steady_clock::now( );
+        hover_ = bvh_->intersect( cameraRay( view_, projection, float( x ) - viewport.x, float( y ) - viewport.y, viewport.z, viewport.w ) );
+        pickMilliseconds_ = std::chrono::duration< double, std::milli >( std::chrono::steady_clock::now( ) - start ).count( );
+    }
+
+    if ( hover_.valid( ) )
+    {
+        // the values as displayed, blended while interpolating. A triangle picked
+        // before the geometry changed may not exist in the shown step
+        int t = hover_.triangle_;
+        auto value = [t]( const std::vector< float >& values ){
+            return t < int( values.size( ) ) ? values[ t ] : 0.0f;
+        };
+        hoverShadow_ = glm::mix( value( shown->shadow_ ), value( upper->shadow_ ), weight );
+        hoverTemperature_ = glm::mix( value( shown->temperature_ ), value( upper->temperature_ ), weight );
+    }
+    if ( click )
+    {
+        loadHistory( hover_.triangle_ );
+    }
+}
+
+// values of one triangle over all timesteps, read from disk in parallel when streaming
+void SpacecraftRenderingTools::loadHistory( int triangle ){
+
+    selectedTriangle_ = triangle;
+    if ( triangle < 0 )
+    {
+        historyShadow_.clear( );
+        historyTemperature_.clear( );
+        return;
+    }
+    auto start = std::chrono::steady_clock::now( );
+    historyShadow_.assign( timeIndex_.size( ), 0.0f );
+    historyTemperature_.assign( timeIndex_.size( ), 0.0f );
+    parallelFor( timeIndex_.size( ), [&]( int position ){
+        int step = timeIndex_.step( position );
+        if ( timestepCache_ )
+        {
+            timestepCache_->source( ).loadTriangle( step, triangle, historyShadow_[ position ], historyTemperature_[ position ] );
+        }
+        else
+        {
+            // steps with another geometry may have fewer triangles
+            const MeshData& mesh = spacecraftData_[ step ];
+            if ( triangle < mesh.numberOfTriangles( ) )
+            {
+                historyShadow_[ position ] = mesh.shadow_[ triangle ];
+                historyTemperature_[ position ] = mesh.temperature_.empty( ) ? 0.0f : mesh.temperature_[ triangle ];
+            }
+        }
+    } );
+    historySeconds_ = std::chrono::duration< double >( std::chrono::steady_clock::now( ) - start ).count( );
+}
+
+void SpacecraftRenderingTools::drawPicking( ){
+
+    ImGui::Checkbox("pick on hover", &hoverPicking_);
+    ImGui::SameLine();
+    ImGui::TextDisabled("click a triangle for its history");
+    if ( bvh_ ){
+        ImGui::Text("BVH: %zu nodes, depth %d, built in %.1f ms, pick %.3f ms", bvh_->nodes( ), bvh_->depth( ),
+            1000.0 * bvhSeconds_, pickMilliseconds_);
+    }
+    if ( hover_.valid( ) ){
+        ImGui::Text("triangle %d: shadow %.3f", hover_.triangle_, hoverShadow_);
+        if ( hasTemperature_ ){
+            ImGui::SameLine();
+            ImGui::Text("temperature %.2f K", hoverTemperature_);
+        }
+    }
+    else {
+        ImGui::TextDisabled("no triangle under the cursor");
+    }
+
+    if ( selectedTriangle_ < 0 || historyShadow_.empty( ) ){
+        return;
+    }
+    ImGui::SeparatorText("Selected triangle");
+    ImGui::Text("triangle %d, %d timesteps from %.1f s to %.1f s, read in %.1f ms", selectedTriangle_,
+        timeIndex_.size( ), timeIndex_.first( ), timeIndex_.last( ), 1000.0 * historySeconds_);
+    // the overlay shows the value at the slider position
+    int position = timeIndex_.locate( time_ ).lower_;
+    char overlay[ 32 ];
+    snprintf( overlay, sizeof( overlay ), "%.3f", historyShadow_[ position ] );
+    float plotWidth = ImGui::GetContentRegionAvail().x * 0.75f;
+    ImGui::PlotLines("shadow", historyShadow_.data(), int(historyShadow_.size()), 0, overlay, 0.0f, 1.0f, ImVec2(plotWidth, 80.0f));
+    if ( hasTemperature_ ){
+        snprintf( overlay, sizeof( overlay ), "%.2f K", historyTemperature_[ position ] );
+        ImGui::PlotLines("temperature", historyTemperature_.data(), int(historyTemperature_.size()), 0, overlay,
+            std::numeric_limits< float >::max( ), std::numeric_limits< float >::max( ), ImVec2(plotWidth, 80.0f));
+    }
+    if ( ImGui::Button("clear selection") ){
+        loadHistory( -1 );
+    }
 }
 
 void SpacecraftRenderingTools::mainLoop() {
 
     while (!glfwWindowShouldClose(window_)) {
-       
+
+        if ( !needsRedraw( ) ){
+            // nothing to show, sleep until input arrives. The timeout keeps
+            // pending screenshots and a blinking text cursor going
+            double timeout = !readback_.empty( ) ? 0.05 : ImGui::GetIO().WantTextInput ? 0.5 : 1.0;
+            glfwWaitEventsTimeout( timeout );
+            collectScreenshots( );
+            if ( ImGui::GetIO().WantTextInput ){
+                requestRedraw( 1 );
+            }
+            continue;
+        }
+
+        profiler_.beginFrame( );
+        renderer_.beginFrame( );
         updateRender( );
+        framesDrawn_++;
+        redrawFrames_ = std::max( redrawFrames_ - 1, 0 );
 
-        glfwSwapBuffers(window_);
+        {
+            ProfileScope stage( &profiler_, ProfileStage::SWAP );
+            glfwSwapBuffers(window_);
+        }
+        profiler_.endFrame( );
+        renderer_.state_.endFrame( );
         glfwPollEvents();
+        if ( playback_.playing_ ){
+            playback_.waitForNextFrame( );
+        }
     }
 
-    // cleanup
+    // cleanup, the stager may still write into mapped buffers
+    stager_.reset( );
+    while ( !readback_.empty( ) ){
+        collectScreenshots( true );
+    }
+    readback_.release( );
+    imageWriter_.wait( );
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
 
-    glDeleteVertexArrays(1, &renderer_.VAO_);
-    glDeleteBuffers(1, &renderer_.VBO_);
+    profiler_.release( );
+    renderer_.release( );
     glfwTerminate();
 }
 
@@ -203,8 +1357,14 @@ void SpacecraftRenderingTools::onMouseButton(int button, int action, int mods) {
             isDragging_ = true;
             startRotation_ = rotation_;
             startDragPoint_ = mapToSphere(xpos, ypos);
+            pressX_ = xpos;
+            pressY_ = ypos;
         } else if (action == GLFW_RELEASE) {
             isDragging_ = false;
+            // a press and release without moving is a click, which picks
+            if ( std::hypot( xpos - pressX_, ypos - pressY_ ) < 3.0 && !ImGui::GetIO().WantCaptureMouse ){
+                pickRequested_ = true;
+            }
         }
     }
     
@@ -268,20 +1428,7 @@ void SpacecraftRenderingTools::onMouseMove(double xpos, double ypos) {
 }
 
 glm::mat4 SpacecraftRenderingTools::getViewMatrix() {
-    // Camera position in world space
-    glm::vec3 cameraOffset = glm::vec3(0.0f, 0.0f, cameraDistance_);
-    
-    // Apply rotation to camera position
-    glm::mat4 rotationMatrix = glm::mat4_cast(rotation_);
-    glm::vec3 cameraPos = glm::vec3(rotationMatrix * glm::vec4(cameraOffset, 1.0f));
-    
-    // Target is the pan offset
-    glm::vec3 target = panOffset_;
-    
-    // Up vector rotated
-    glm::vec3 up = glm::vec3(rotationMatrix * glm::vec4(0.0f, 1.0f, 0.0f, 0.0f));
-    
-    return glm::lookAt(cameraPos + panOffset_, target, up);
+    return arcballViewMatrix( rotation_, cameraDistance_, panOffset_ );
 }
 
 void SpacecraftRenderingTools::onScroll(double xoffset, double yoffset) {
@@ -301,13 +1448,118 @@ void SpacecraftRenderingTools::onResize(int width, int height) {
 }
 
 
-int main(void)
+// text (mesh.txt) or binary (.scrt, see scrt-convert) dataset, streamed
+// from disk through a bounded cache with --stream
+// per-triangle temperatures of a text dataset are read from --temperature
+// --compress keeps the dataset compressed in memory (see codec.h) and streams from there
+// --shaders reads the GLSL files from a directory and reloads them on changes
+// every --compare adds a result set on the same mesh, drawn side by side,
+// --compare-temperature gives the temperatures of the last one
+void printUsage( const char* program ){
+    std::cerr << "usage: " << program << " [mesh] [--stream <cached timesteps>] [--temperature <file>] [--compress]\n"
+        "       [--compare <mesh> [--compare-temperature <file>]]... [--shaders <directory>]\n";
+}
+
+int main(int argc, char** argv)
 {
     std::string pathToMesh = "mesh.txt";
+    std::string pathToTemperature;
+    std::vector< std::pair< std::string, std::string > > cases;
+    std::string shaderDirectory;
+    int cacheCapacity = 0;
+    bool compress = false;
+    try
+    {
+        int i = 1;
+        auto next = [&]( ) -> std::string {
+            if ( i + 1 >= argc )
+            {
+                throw std::runtime_error( std::string( "Error, missing value for " ) + argv[ i ] );
+            }
+            return argv[ ++i ];
+        };
+        for ( ; i < argc; i++ )
+        {
+            std::string argument = argv[ i ];
+            if ( argument == "--stream" )
+            {
+                std::string value = next( );
+                try
+                {
+                    cacheCapacity = std::stoi( value );
+                }
+                catch ( const std::logic_error& )
+                {
+                    throw std::runtime_error( "Error, --stream expects a number of timesteps, not " + value );
+                }
+            }
+            else if ( argument == "--temperature" )
+            {
+                pathToTemperature = next( );
+            }
+            else if ( argument == "--compress" )
+            {
+                compress = true;
+            }
+            else if ( argument == "--shaders" )
+            {
+                shaderDirectory = next( );
+            }
+            else if ( argument == "--compare" )
+            {
+                cases.emplace_back( next( ), "" );
+            }
+            else if ( argument == "--compare-temperature" )
+            {
+                if ( cases.empty( ) )
+                {
+                    throw std::runtime_error( "Error, --compare-temperature needs a --compare before it" );
+                }
+                cases.back( ).second = next( );
+            }
+            else if ( argument.rfind( "--", 0 ) == 0 )
+            {
+                throw std::runtime_error( "Error, unknown option " + argument );
+            }
+            else
+            {
+                pathToMesh = argument;
+            }
+        }
+    }
+    catch ( const std::exception& error )
+    {
+        std::cerr << error.what( ) << std::endl;
+        printUsage( argv[ 0 ] );
+        return 1;
+    }
 
-    SpacecraftRenderingTools application( 1280, 960 );
-    application.loadMesh( pathToMesh );
-    application.mainLoop( );
+    try
+    {
+        SpacecraftRenderingTools application( 1280, 960 );
+        if ( !shaderDirectory.empty( ) )
+        {
+            application.useShaderDirectory( shaderDirectory );
+        }
+        if ( cacheCapacity > 0 || compress )
+        {
+            application.openMeshStreaming( pathToMesh, cacheCapacity > 0 ? cacheCapacity : 64, pathToTemperature, compress );
+        }
+        else
+        {
+            application.loadMesh( pathToMesh, pathToTemperature );
+        }
+        for ( const auto& [ pathToCase, pathToCaseTemperature ] : cases )
+        {
+            application.addCase( pathToCase, pathToCaseTemperature );
+        }
+        application.mainLoop( );
+    }
+    catch ( const std::exception& error )
+    {
+        std::cerr << error.what( ) << std::endl;
+        return 1;
+    }
 
     return 0;
 
@@ -359,207 +1611,104 @@ void SpacecraftRenderingTools::setMode( int mode ){
     visualizationMode_ = VisualizationMode( mode );
 }
 
-ImU32 floatToColor(float t, VisualizationMode mode) {
-    
-    //basic colors
-    std::vector<int> red = {255, 0, 0};
-    std::vector<int> white = {255, 255, 255};
-    std::vector<int> blue = {0, 0, 255};
-
-    int r, g, b;
+// colormap of the current mode, user maps are loaded from "r g b" text files
+void SpacecraftRenderingTools::drawColormapControls( ){
 
-    switch(mode){
-        case VisualizationMode::SHADOW :{
-            r = 255;
-            g = int(255 * ( 1.0f - t) );
-            b = g;
-            break;
-        }
-        case VisualizationMode::TEMPERATURE :{
-            r = int(255 * t);
-            g = 0;
-            b = int(255 * ( 1.0f - t) );
-            break;
+    int& colormap = renderer_.colormap( visualizationMode_ );
+    const ColormapLibrary& colormaps = renderer_.colormaps_;
+    if (ImGui::BeginCombo("colormap", colormaps.colormap( colormap ).name_.c_str())){
+        for ( int i = 0; i < colormaps.size( ); i++ ){
+            if (ImGui::Selectable(colormaps.colormap( i ).name_.c_str(), i == colormap)){
+                colormap = i;
+            }
         }
+        ImGui::EndCombo();
     }
-    
-    return IM_COL32(r, g, b, 255);
-}
-
-void SpacecraftRenderingTools::drawColorbar( ) {
-    if (verticalColorbar_){
-        drawColorbarVertical( );
-    }
-    else{
-        drawColorbarHorizontal( );
+    ImGui::SetNextItemWidth(300.0f);
+    ImGui::InputTextWithHint("##colormap file", "colormap file", colormapPath_.data(), colormapPath_.size());
+    ImGui::SameLine();
+    if (ImGui::Button("Load")){
+        try {
+            colormap = renderer_.colormaps_.load( colormapPath_.data() );
+        }
+        catch ( const std::runtime_error& error ){
+            std::cerr << error.what( ) << std::endl;
+        }
     }
 }
 
-void SpacecraftRenderingTools::drawColorbarVertical( ) {
-    
-    float maxValue, minValue;
-    const char* title;
-    switch(visualizationMode_){
-        case VisualizationMode::SHADOW :{
-            maxValue = 1.0f;
-            minValue = 0.0f;
-            title = "f [-]";
-            break;
-        }
-        case VisualizationMode::TEMPERATURE :{
-            maxValue = 300.0f;
-            minValue = 250.0f;
-            title = "T [K]";
-            break;
-        }
-    }
-    ImDrawList* drawList = ImGui::GetForegroundDrawList();
-    
-    float barWidth = 25.0f * sizeColorbar_;
-    float barHeight = 200.0f * sizeColorbar_;
-    float labelWidth = 60.0f;
+void SpacecraftRenderingTools::drawComparisonControls( ){
 
-    float x = xColorbar_ * windowWidth_;
-    float y = yColorbar_ * windowHeight_ ;  
-    
-    int numSegments = 100;
-    float segmentHeight = barHeight / numSegments;
-    
-    // Draw gradient colorbar
-    for (int i = 0; i < numSegments; i++) {
-        float t1 = (float)i / numSegments;
-        float t2 = (float)(i + 1) / numSegments;
-        
-        ImU32 color1 = floatToColor(1.0f - t1, visualizationMode_);
-        ImU32 color2 = floatToColor(1.0f - t2, visualizationMode_);
-        
-        ImVec2 p1(x, y + i * segmentHeight);
-        ImVec2 p2(x + barWidth, y + (i + 1) * segmentHeight);
-        
-        drawList->AddRectFilledMultiColor(p1, p2, color1, color1, color2, color2);
+    ImGui::Text("%zu cases of %d triangles, geometry on the GPU once", cases_.size( ) + 1, numberOfTriangles_);
+    for ( ComparisonCase& comparison : cases_ ){
+        ImGui::BulletText("%s: %d timesteps, %d cached", comparison.name_.c_str( ), comparison.timeIndex_.size( ),
+            comparison.cache_->resident( ));
+        if ( comparison.cache_->source( ).hasTemperature( ) ){
+            const ValueRange& global = comparison.temperatureStatistics_.global( );
+            ImGui::SameLine();
+            ImGui::TextDisabled("%.1f K to %.1f K", global.min_, global.max_);
+        }
     }
-    
-    // Border
-    drawList->AddRect(ImVec2(x, y), 
-                      ImVec2(x + barWidth, y + barHeight), 
-                      IM_COL32(0, 0, 0, 255), 0.0f, 0, 1.5f);
-    
-    // Labels
-    int numLabels = 5;
-    for (int i = 0; i <= numLabels; i++) {
-        float t = (float)i / numLabels;
-        float value = maxValue - t * (maxValue - minValue);
-        float yPos = y + t * barHeight;
-        
-        // Tick mark
-        drawList->AddLine(ImVec2(x + barWidth, yPos),
-                          ImVec2(x + barWidth + 5, yPos),
-                          IM_COL32(0, 0, 0, 255), 1.5f);
-        
-        // Label
-        char label[32];
-        snprintf(label, sizeof(label), "%.1f", value);
-        drawList->AddText(ImGui::GetFont(), fontSize_,
-                           ImVec2(x + barWidth + 8, yPos - 7), 
-                          IM_COL32(0, 0, 0, 255), label);
+    ImGui::Checkbox("difference view", &differenceView_);
+    if ( differenceView_ ){
+        std::vector< const char* > names;
+        for ( const ComparisonCase& comparison : cases_ ){
+            names.push_back( comparison.name_.c_str( ) );
+        }
+        ImGui::SetNextItemWidth(200.0f);
+        ImGui::Combo("subtracted case", &differenceCase_, names.data( ), int( names.size( ) ));
+        ImGui::SetNextItemWidth(200.0f);
+        ImGui::SliderFloat("shadow difference range", &shadowDifferenceRange_, 0.01f, 1.0f);
+        ImGui::SetNextItemWidth(200.0f);
+        ImGui::SliderFloat("temperature difference range [K]", &temperatureDifferenceRange_, 0.1f, 200.0f, "%.1f", ImGuiSliderFlags_Logarithmic);
+        if ( visualizationMode_ == VisualizationMode::WIREFRAME ){
+            ImGui::TextDisabled("shown in the shadow and temperature modes");
+        }
     }
-    
-    // Title above colorbar
-    ImVec2 textSize = ImGui::CalcTextSize(title);
-    drawList->AddText(ImGui::GetFont(), fontSize_,
-                      ImVec2(x + (barWidth - textSize.x) / 2.0f, y - 20), 
-                      IM_COL32(0, 0, 0, 255), title);
 }
-void SpacecraftRenderingTools::drawColorbarHorizontal( ) {
-    
-    float maxValue, minValue;
-    const char* title;
-    switch(visualizationMode_){
-        case VisualizationMode::SHADOW :{
-            maxValue = 1.0f;
-            minValue = 0.0f;
-            title = "f [-]";
-            break;
-        }
-        case VisualizationMode::TEMPERATURE :{
-            maxValue = 300.0f;
-            minValue = 250.0f;
-            title = "T [K]";
-            break;
-        }
-    }
-    ImDrawList* drawList = ImGui::GetForegroundDrawList();
-    
-    float barWidth = 200.0f * sizeColorbar_;
-    float barHeight = 25.0f * sizeColorbar_;
-    float labelWidth = 60.0f;
 
-    float x = xColorbar_ * windowWidth_;
-    float y = yColorbar_ * windowHeight_ ;  
-    
-    int numSegments = 100;
-    float segmentWidth= barWidth / numSegments;
-    
-    // Draw gradient colorbar
-    for (int i = 0; i < numSegments; i++) {
-        float t1 = (float)i / numSegments;
-        float t2 = (float)(i + 1) / numSegments;
-        
-        ImU32 color1 = floatToColor(t1, visualizationMode_);
-        ImU32 color2 = floatToColor(t2, visualizationMode_);
-        
-        ImVec2 p1(x + i * segmentWidth, y );
-        ImVec2 p2(x + (i + 1) * segmentWidth, y +  barHeight);
-        
-        drawList->AddRectFilledMultiColor(p1, p2, color1, color1, color2, color2);
-    }
-    
-    // Border
-    drawList->AddRect(ImVec2(x, y), 
-                      ImVec2(x + barWidth, y + barHeight), 
-                      IM_COL32(0, 0, 0, 255), 0.0f, 0, 1.5f);
-    
-    // Labels
-    int numLabels = 5;
-    for (int i = 0; i <= numLabels; i++) {
-        float t = (float)i / numLabels;
-        float value = minValue + t * (maxValue - minValue);
-        float xPos = x + t * barWidth;
-        
-        // Tick mark
-        drawList->AddLine(ImVec2(xPos, y + barHeight),
-                          ImVec2(xPos, y + barHeight + 5),
-                          IM_COL32(0, 0, 0, 255), 1.5f);
-        
-        // Label
-        char label[32];
-        snprintf(label, sizeof(label), "%.1f", value);
-        drawList->AddText(ImGui::GetFont(), fontSize_,
-                           ImVec2(xPos - 7, y + barHeight + 8), 
-                          IM_COL32(0, 0, 0, 255), label);
-    }
-    
-    // Title above colorbar
-    ImVec2 textSize = ImGui::CalcTextSize(title);
-    drawList->AddText(ImGui::GetFont(), fontSize_,
-                      ImVec2(x + (barWidth - textSize.x) / 2.0f, y - 25.0f), 
-                      IM_COL32(0, 0, 0, 255), title);
+void SpacecraftRenderingTools::drawColorbar( ) {
+    colorbar_.draw( ImGui::GetForegroundDrawList(), visualizationMode_, float(windowWidth_), float(windowHeight_),
+        temperatureRange( ), renderer_.colormapTexture( visualizationMode_ ) );
 }
 
-
 // screenshot
 void SpacecraftRenderingTools::screenshot( ){
 
+    // the framebuffer is larger than the window on HiDPI screens
     int fbWidth, fbHeight;
     glfwGetFramebufferSize(window_, &fbWidth, &fbHeight);
-    GLsizei nrChannels = 3;
-    GLsizei stride = nrChannels * fbWidth;
-    stride += (stride % 4) ? (4 - stride % 4) : 0;
-    GLsizei bufferSize = stride * fbHeight;
-    std::vector<char> buffer(bufferSize);
-    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    if ( readback_.full( ) ){
+        collectScreenshots( true );
+    }
     glReadBuffer(GL_BACK);
-    glReadPixels(0, 0, fbWidth, fbHeight, GL_RGB, GL_UNSIGNED_BYTE, buffer.data());
-    stbi_flip_vertically_on_write(true);
-    stbi_write_png(pathToFolder_.data(), windowWidth_, fbHeight, nrChannels, buffer.data(), stride);
-}
\ No newline at end of file
+    readback_.request( fbWidth, fbHeight, screenshotPath( ) );
+}
+
+// hands finished readbacks to the encoder, wait blocks for the oldest one
+void SpacecraftRenderingTools::collectScreenshots( bool wait ){
+
+    Image image;
+    if ( wait && readback_.collect( image, true ) ){
+        imageWriter_.write( std::move( image ) );
+    }
+    while ( readback_.collect( image ) ){
+        imageWriter_.write( std::move( image ) );
+    }
+}
+
+// a folder gets numbered files, a file name is numbered only while recording
+std::string SpacecraftRenderingTools::screenshotPath( ){
+
+    std::filesystem::path path( pathToFolder_.data() );
+    char number[ 16 ];
+    std::snprintf( number, sizeof( number ), "_%05d", screenshotCount_++ );
+    if ( path.empty( ) || std::filesystem::is_directory( path ) ){
+        return ( path / ( std::string( "screenshot" ) + number + ".png" ) ).string( );
+    }
+    if ( recording_ ){
+        std::filesystem::path extension = path.has_extension( ) ? path.extension( ) : ".png";
+        return ( path.parent_path( ) / ( path.stem( ).string( ) + number + extension.string( ) ) ).string( );
+    }
+    return path.string( );
+}
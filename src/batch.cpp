@@ -0,0 +1,383 @@
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <imgui.h>
+#include <imgui_impl_opengl3.h>
+
+#include "capture.h"
+#include "colorbar.h"
+#include "headless.h"
+#include "streaming.h"
+
+// scrt-batch: renders a range of timesteps to numbered PNGs without a window
+//
+//   scrt-batch <mesh> [options]
+//
+// Options can also be read from a file with --config, one option per line
+// without the leading dashes, e.g. "mode temperature". Lines starting with
+// # are ignored. Options given later override earlier ones.
+
+namespace {
+
+struct BatchOptions{
+
+    std::string pathToMesh_;
+    std::string pathToTemperature_;
+    std::string outputDirectory_ = "frames";
+    std::string prefix_ = "frame_";
+    int width_ = 1280;
+    int height_ = 960;
+
+    // sorted timestep positions, last < 0 means up to the end
+    int first_ = 0;
+    int last_ = -1;
+    int stride_ = 1;
+
+    VisualizationMode mode_ = VisualizationMode::SHADOW;
+    RangeMode rangeMode_ = RangeMode::GLOBAL;
+    // name of a built-in colormap or path of a colormap file, empty keeps the default
+    std::string colormap_;
+    bool overlay_ = true;
+    bool singlePassOverlay_ = true;
+    float lineWidth_ = 1.0f;
+    bool compact_ = false;
+    float background_[ 4 ] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+    // camera, same defaults as the viewer
+    float distance_ = 100.0f;
+    float fov_ = 10.0f;
+    glm::quat rotation_ = glm::quat( 1.0f, 0.0f, 0.0f, 0.0f );
+    glm::vec3 pan_ = glm::vec3( 0.0f );
+
+    bool colorbar_ = true;
+    Colorbar colorbarSettings_;
+
+    int threads_ = 0;
+    int cachedTimesteps_ = 16;
+
+};
+
+void printUsage( const char* program ){
+    std::cerr << "usage: " << program << " <mesh> [options]\n"
+        "  --config <file>                 read options from a file\n"
+        "  --output <directory>            default frames\n"
+        "  --prefix <name>                 default frame_\n"
+        "  --size <width> <height>         default 1280 960\n"
+        "  --first <i> --last <i> --stride <n>  sorted timestep range\n"
+        "  --mode wireframe|shadow|temperature\n"
+        "  --temperature <file>            per-triangle temperatures of a text mesh\n"
+        "  --range global|timestep|percentile  temperature range of the colormap, default global\n"
+        "  --colormap <name|file>          white-red, blue-red, viridis, inferno, coolwarm or an r g b file\n"
+        "  --overlay on|off|two-pass       wireframe overlay, two-pass is the legacy GL_LINE pass\n"
+        "  --line-width <pixels>           width of the single pass overlay, default 1\n"
+        "  --compact                       16 bit positions and temperatures, 8 bit shadow on the GPU\n"
+        "  --background <r> <g> <b> <a>\n"
+        "  --distance <d> --fov <degrees>\n"
+        "  --rotation <w> <x> <y> <z>      arcball quaternion\n"
+        "  --orbit <azimuth> <elevation>   rotation in degrees, alternative to --rotation\n"
+        "  --pan <x> <y> <z>\n"
+        "  --colorbar none|vertical|horizontal\n"
+        "  --colorbar-position <x> <y> --colorbar-size <s> --font-size <f>\n"
+        "  --threads <n>                   PNG encoder threads, default all cores\n"
+        "  --cache <n>                     timesteps kept in memory, default 16\n";
+}
+
+std::vector< std::string > readConfigFile( const std::string& path ){
+    std::ifstream file( path );
+    if ( !file )
+    {
+        throw std::runtime_error( "Error, config file " + path + " does not exist!" );
+    }
+    std::vector< std::string > tokens;
+    std::string line;
+    while ( std::getline( file, line ) )
+    {
+        std::istringstream words( line );
+        std::string word;
+        bool first = true;
+        while ( words >> word )
+        {
+            if ( first && word[ 0 ] == '#' )
+            {
+                break;
+            }
+            tokens.push_back( first ? "--" + word : word );
+            first = false;
+        }
+    }
+    return tokens;
+}
+
+void parseOptions( std::vector< std::string > tokens, BatchOptions& options ){
+
+    size_t i = 0;
+    auto next = [&]( ) -> const std::string& {
+        if ( i + 1 >= tokens.size( ) )
+        {
+            throw std::runtime_error( "Error, missing value for " + tokens[ i ] );
+        }
+        return tokens[ ++i ];
+    };
+    auto number = [&]( ){ return std::stof( next( ) ); };
+
+    for ( ; i < tokens.size( ); i++ )
+    {
+        const std::string option = tokens[ i ];
+        if ( option == "--config" )
+        {
+            std::vector< std::string > included = readConfigFile( next( ) );
+            tokens.insert( tokens.begin( ) + i + 1, included.begin( ), included.end( ) );
+        }
+        else if ( option == "--output" ) options.outputDirectory_ = next( );
+        else if ( option == "--prefix" ) options.prefix_ = next( );
+        else if ( option == "--size" )
+        {
+            options.width_ = std::stoi( next( ) );
+            options.height_ = std::stoi( next( ) );
+        }
+        else if ( option == "--first" ) options.first_ = std::stoi( next( ) );
+        else if ( option == "--last" ) options.last_ = std::stoi( next( ) );
+        else if ( option == "--stride" ) options.stride_ = std::max( std::stoi( next( ) ), 1 );
+        else if ( option == "--mode" )
+        {
+            const std::string& mode = next( );
+            if ( mode == "wireframe" ) options.mode_ = VisualizationMode::WIREFRAME;
+            else if ( mode == "shadow" ) options.mode_ = VisualizationMode::SHADOW;
+            else if ( mode == "temperature" ) options.mode_ = VisualizationMode::TEMPERATURE;
+            else throw std::runtime_error( "Error, unknown mode " + mode );
+        }
+        else if ( option == "--temperature" ) options.pathToTemperature_ = next( );
+        else if ( option == "--range" )
+        {
+            const std::string& range = next( );
+            if ( range == "global" ) options.rangeMode_ = RangeMode::GLOBAL;
+            else if ( range == "timestep" ) options.rangeMode_ = RangeMode::TIMESTEP;
+            else if ( range == "percentile" ) options.rangeMode_ = RangeMode::PERCENTILE;
+            else throw std::runtime_error( "Error, unknown range " + range );
+        }
+        else if ( option == "--colormap" ) options.colormap_ = next( );
+        else if ( option == "--overlay" )
+        {
+            const std::string& overlay = next( );
+            options.overlay_ = overlay != "off";
+            options.singlePassOverlay_ = overlay != "two-pass";
+        }
+        else if ( option == "--line-width" ) options.lineWidth_ = number( );
+        else if ( option == "--compact" ) options.compact_ = true;
+        else if ( option == "--background" )
+        {
+            for ( float& channel : options.background_ )
+            {
+                channel = number( );
+            }
+        }
+        else if ( option == "--distance" ) options.distance_ = number( );
+        else if ( option == "--fov" ) options.fov_ = number( );
+        else if ( option == "--rotation" )
+        {
+            float w = number( ), x = number( ), y = number( ), z = number( );
+            options.rotation_ = glm::normalize( glm::quat( w, x, y, z ) );
+        }
+        else if ( option == "--orbit" )
+        {
+            float azimuth = glm::radians( number( ) );
+            float elevation = glm::radians( number( ) );
+            options.rotation_ = glm::angleAxis( azimuth, glm::vec3( 0.0f, 1.0f, 0.0f ) ) *
+                                glm::angleAxis( -elevation, glm::vec3( 1.0f, 0.0f, 0.0f ) );
+        }
+        else if ( option == "--pan" )
+        {
+            float x = number( ), y = number( ), z = number( );
+            options.pan_ = glm::vec3( x, y, z );
+        }
+        else if ( option == "--colorbar" )
+        {
+            const std::string& colorbar = next( );
+            options.colorbar_ = colorbar != "none";
+            options.colorbarSettings_.vertical_ = colorbar == "vertical" ? 1 : 0;
+        }
+        else if ( option == "--colorbar-position" )
+        {
+            options.colorbarSettings_.x_ = number( );
+            options.colorbarSettings_.y_ = number( );
+        }
+        else if ( option == "--colorbar-size" ) options.colorbarSettings_.size_ = number( );
+        else if ( option == "--font-size" ) options.colorbarSettings_.fontSize_ = number( );
+        else if ( option == "--threads" ) options.threads_ = std::stoi( next( ) );
+        else if ( option == "--cache" ) options.cachedTimesteps_ = std::max( std::stoi( next( ) ), 2 );
+        else if ( option.rfind( "--", 0 ) == 0 )
+        {
+            throw std::runtime_error( "Error, unknown option " + option );
+        }
+        else
+        {
+            options.pathToMesh_ = option;
+        }
+    }
+}
+
+} // namespace
+
+int main( int argc, char** argv )
+{
+    BatchOptions options;
+    try
+    {
+        parseOptions( std::vector< std::string >( argv + 1, argv + argc ), options );
+    }
+    catch ( const std::exception& error )
+    {
+        std::cerr << error.what( ) << std::endl;
+        printUsage( argv[ 0 ] );
+        return 1;
+    }
+    if ( options.pathToMesh_.empty( ) )
+    {
+        printUsage( argv[ 0 ] );
+        return 1;
+    }
+
+    try
+    {
+        auto start = std::chrono::steady_clock::now( );
+
+        HeadlessContext context( options.width_, options.height_ );
+        std::cout << "rendering with " << context.description( ) << std::endl;
+
+        Renderer renderer;
+        renderer.init( );
+        renderer.wireFrameOverlay_ = options.overlay_;
+        renderer.singlePassOverlay_ = options.singlePassOverlay_;
+        renderer.wireframeWidth_ = options.lineWidth_;
+        renderer.compactVertices_ = options.compact_;
+        if ( !options.colormap_.empty( ) && options.mode_ != VisualizationMode::WIREFRAME )
+        {
+            int colormap = renderer.colormaps_.find( options.colormap_ );
+            renderer.colormap( options.mode_ ) = colormap >= 0 ? colormap : renderer.colormaps_.load( options.colormap_ );
+        }
+        glEnable(GL_DEPTH_TEST);
+
+        // the colorbar is drawn by the same ImGui code as in the viewer, without a platform backend
+        IMGUI_CHECKVERSION();
+        ImGui::CreateContext();
+        ImGuiIO& io = ImGui::GetIO();
+        io.IniFilename = nullptr;
+        io.DisplaySize = ImVec2( float( options.width_ ), float( options.height_ ) );
+        io.DeltaTime = 1.0f / 60.0f;
+        ImGui_ImplOpenGL3_Init("#version 330");
+
+        // timesteps are streamed, the next ones load while the current one renders
+        TimestepCache cache( openTimestepSource( options.pathToMesh_, options.pathToTemperature_ ), options.cachedTimesteps_ );
+        std::vector< double > times;
+        for ( int i = 0; i < cache.source( ).timeSteps( ); i++ )
+        {
+            times.push_back( cache.source( ).time( i ) );
+        }
+        TimeIndex timeIndex( times );
+
+        // every range mode needs the temperatures of all steps, scanned once up front
+        RangeStatistics temperatureStatistics;
+        if ( options.mode_ == VisualizationMode::TEMPERATURE )
+        {
+            if ( !cache.source( ).hasTemperature( ) )
+            {
+                std::cerr << "warning, " << options.pathToMesh_ << " has no temperatures" << std::endl;
+            }
+            computeTemperatureStatistics( cache.source( ), temperatureStatistics );
+            renderer.packedTemperatureRange_ = temperatureStatistics.global( );
+        }
+        int last = options.last_ < 0 ? timeIndex.size( ) - 1 : std::min( options.last_, timeIndex.size( ) - 1 );
+        int first = std::max( options.first_, 0 );
+
+        std::filesystem::create_directories( options.outputDirectory_ );
+
+        glm::mat4 view = arcballViewMatrix( options.rotation_, options.distance_, options.pan_ );
+        glm::mat4 projection = glm::perspective(
+            glm::radians( options.fov_ ),
+            float( options.width_ ) / float( options.height_ ),
+            0.1f,
+            1000.0f
+        );
+
+        // frames are read back through a PBO ring and encoded on a thread pool,
+        // so the GPU keeps rendering while earlier frames are compressed
+        PixelReadback readback( 3 );
+        ImageWriter writer( options.threads_ );
+        int frames = 0;
+        for ( int position = first; position <= last; position += options.stride_ )
+        {
+            int step = timeIndex.step( position );
+            std::shared_ptr< const MeshData > mesh = cache.get( step );
+            cache.prefetch( step, options.stride_ );
+
+            ValueRange temperatureRange = temperatureStatistics.range( options.rangeMode_, step );
+            renderer.temperatureRange_ = temperatureRange;
+
+            context.bind( );
+            glClearColor(options.background_[0], options.background_[1], options.background_[2], options.background_[3]);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            renderer.beginFrame( );
+            renderer.renderMesh( *mesh, view, projection, options.mode_ );
+
+            if ( options.colorbar_ && options.mode_ != VisualizationMode::WIREFRAME )
+            {
+                ImGui_ImplOpenGL3_NewFrame();
+                ImGui::NewFrame();
+                options.colorbarSettings_.draw( ImGui::GetForegroundDrawList(), options.mode_,
+                    float( options.width_ ), float( options.height_ ), temperatureRange, renderer.colormapTexture( options.mode_ ) );
+                ImGui::Render();
+                ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            }
+
+            Image image;
+            while ( readback.full( ) )
+            {
+                if ( readback.collect( image, true ) )
+                {
+                    writer.write( std::move( image ) );
+                }
+            }
+            char name[ 32 ];
+            std::snprintf( name, sizeof( name ), "%05d.png", position );
+            readback.request( options.width_, options.height_,
+                ( std::filesystem::path( options.outputDirectory_ ) / ( options.prefix_ + name ) ).string( ) );
+            while ( readback.collect( image ) )
+            {
+                writer.write( std::move( image ) );
+            }
+            frames++;
+        }
+        while ( !readback.empty( ) )
+        {
+            Image image;
+            if ( readback.collect( image, true ) )
+            {
+                writer.write( std::move( image ) );
+            }
+        }
+        writer.wait( );
+
+        double seconds = std::chrono::duration< double >( std::chrono::steady_clock::now( ) - start ).count( );
+        std::cout << "rendered " << frames << " frames to " << options.outputDirectory_ << " in " << seconds
+                  << " s (" << frames / seconds << " frames/s)";
+        if ( writer.failed( ) > 0 )
+        {
+            std::cout << ", " << writer.failed( ) << " failed to write";
+        }
+        std::cout << std::endl;
+
+        readback.release( );
+        ImGui_ImplOpenGL3_Shutdown();
+        ImGui::DestroyContext();
+        renderer.release( );
+        return writer.failed( ) > 0 ? 1 : 0;
+    }
+    catch ( const std::exception& error )
+    {
+        std::cerr << error.what( ) << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,762 @@
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <imgui.h>
+#include <imgui_impl_opengl3.h>
+
+#include <glm/gtc/constants.hpp>
+
+#include "bvh.h"
+#include "colorbar.h"
+#include "headless.h"
+#include "lod.h"
+#include "parallel.h"
+#include "profiler.h"
+#include "resources.h"
+#include "shadowing.h"
+#include "streaming.h"
+
+// scrt-bench: generates synthetic spacecraft datasets in the mesh.txt layout
+// and times every stage between the text file and a rendered frame for each
+// requested mesh size. Results are written as JSON.
+//
+//   scrt-bench [--triangles 10000,100000,1000000] [--timesteps 8] [--frames 30]
+//              [--size 1280 960] [--work-dir bench-data] [--keep] [--output bench.json]
+//   scrt-bench --generate mesh.txt --triangles 100000 [--timesteps 8]
+//
+// The shaders are compiled into the executable, SCRT_SHADER_DIR overrides them.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince( Clock::time_point start ){
+    return std::chrono::duration< double >( Clock::now( ) - start ).count( );
+}
+
+//
+// SYNTHETIC DATASET
+//
+
+// body frame triangles of a box shaped bus with two solar panel wings and a
+// boom, subdivided until the requested triangle count is reached exactly
+class SyntheticSpacecraft{
+
+public:
+
+    explicit SyntheticSpacecraft( int numberOfTriangles ){
+
+        // 40 % of the triangles on the six bus faces, 60 % on the two wings
+        int bus = std::max( int( std::sqrt( 0.4 * numberOfTriangles / 12.0 ) ), 1 );
+        int wing = std::max( int( std::sqrt( 0.6 * numberOfTriangles / 16.0 ) ), 1 );
+        if ( 12 * bus * bus + 16 * wing * wing > numberOfTriangles )
+        {
+            bus = wing = 0;
+        }
+
+        const float h = 1.0f;
+        glm::vec3 x( 1, 0, 0 ), y( 0, 1, 0 ), z( 0, 0, 1 );
+        if ( bus > 0 )
+        {
+            addGrid( glm::vec3( -h, -h, h ), 2 * h * x, 2 * h * y, bus, bus );
+            addGrid( glm::vec3( -h, h, -h ), 2 * h * x, -2 * h * y, bus, bus );
+            addGrid( glm::vec3( -h, -h, -h ), 2 * h * x, 2 * h * z, bus, bus );
+            addGrid( glm::vec3( h, h, -h ), -2 * h * x, 2 * h * z, bus, bus );
+            addGrid( glm::vec3( h, -h, -h ), 2 * h * y, 2 * h * z, bus, bus );
+            addGrid( glm::vec3( -h, h, -h ), -2 * h * y, 2 * h * z, bus, bus );
+            // wings along y, four times longer than wide
+            addGrid( glm::vec3( -0.75f, h + 0.2f, 0.0f ), 1.5f * x, 6.0f * y, wing, 4 * wing );
+            addGrid( glm::vec3( 0.75f, -h - 0.2f, 0.0f ), -1.5f * x, -6.0f * y, wing, 4 * wing );
+        }
+        // the rest goes into a boom strip along z
+        int remaining = numberOfTriangles - int( positions_.size( ) / 9 );
+        if ( remaining >= 2 )
+        {
+            addGrid( glm::vec3( -0.1f, 0.0f, h ), 0.2f * x, 3.0f * z, 1, remaining / 2 );
+        }
+        if ( remaining % 2 == 1 )
+        {
+            addTriangle( glm::vec3( 0, 0, h + 3.0f ), glm::vec3( 0.1f, 0, h + 3.2f ), glm::vec3( -0.1f, 0, h + 3.2f ) );
+        }
+    };
+
+    int numberOfTriangles( ) const { return int( normals_.size( ) ); }
+
+    // one mesh.txt row: time, sun vector, rotation matrix, shadow, positions
+    void writeRow( std::string& line, int step, int timeSteps ) const {
+
+        double time = 60.0 * step;
+        double angle = glm::two_pi< double >( ) * step / std::max( timeSteps, 1 );
+        double c = std::cos( angle ), s = std::sin( angle );
+        // inertial sun along x, spacecraft spinning about z
+        double header[ 13 ] = { time, 1.0, 0.0, 0.0, c, -s, 0.0, s, c, 0.0, 0.0, 0.0, 1.0 };
+        glm::vec3 sun = glm::vec3( float( c ), float( -s ), 0.0f );
+
+        line.clear( );
+        for ( double value : header )
+        {
+            append( line, value );
+        }
+        for ( const glm::vec3& normal : normals_ )
+        {
+            // 1 - lit fraction, 1 (fully shadowed) when facing away from the sun
+            append( line, 1.0f - std::max( 0.0f, glm::dot( normal, sun ) ) );
+        }
+        for ( float value : positions_ )
+        {
+            append( line, value );
+        }
+        line.back( ) = '\n';
+    };
+
+private:
+
+    static void append( std::string& line, double value ){
+        char buffer[ 32 ];
+        auto result = std::to_chars( buffer, buffer + sizeof( buffer ), value, std::chars_format::general, 8 );
+        line.append( buffer, result.ptr );
+        line.push_back( ' ' );
+    };
+
+    void addTriangle( const glm::vec3& a, const glm::vec3& b, const glm::vec3& c ){
+        for ( const glm::vec3& corner : { a, b, c } )
+        {
+            positions_.insert( positions_.end( ), { corner.x, corner.y, corner.z } );
+        }
+        glm::vec3 normal = glm::cross( b - a, c - a );
+        normals_.push_back( glm::length( normal ) > 0.0f ? glm::normalize( normal ) : glm::vec3( 0, 0, 1 ) );
+    };
+
+    void addGrid( const glm::vec3& origin, const glm::vec3& u, const glm::vec3& v, int nu, int nv ){
+        for ( int j = 0; j < nv; j++ )
+        {
+            for ( int i = 0; i < nu; i++ )
+            {
+                glm::vec3 p00 = origin + u * ( float( i ) / nu ) + v * ( float( j ) / nv );
+                glm::vec3 p10 = origin + u * ( float( i + 1 ) / nu ) + v * ( float( j ) / nv );
+                glm::vec3 p01 = origin + u * ( float( i ) / nu ) + v * ( float( j + 1 ) / nv );
+                glm::vec3 p11 = origin + u * ( float( i + 1 ) / nu ) + v * ( float( j + 1 ) / nv );
+                addTriangle( p00, p10, p11 );
+                addTriangle( p00, p11, p01 );
+            }
+        }
+    };
+
+    std::vector< float > positions_;
+    std::vector< glm::vec3 > normals_;
+
+};
+
+// writes a mesh.txt with the given size, returns the number of bytes written
+size_t generateDataset( const std::string& path, int numberOfTriangles, int timeSteps ){
+
+    SyntheticSpacecraft spacecraft( numberOfTriangles );
+    std::ofstream file( path, std::ios::binary );
+    if ( !file )
+    {
+        throw std::runtime_error( "Error, cannot write " + path );
+    }
+    std::string line;
+    size_t bytes = 0;
+    for ( int step = 0; step < timeSteps; step++ )
+    {
+        spacecraft.writeRow( line, step, timeSteps );
+        file.write( line.data( ), std::streamsize( line.size( ) ) );
+        bytes += line.size( );
+    }
+    return bytes;
+}
+
+//
+// JSON OUTPUT
+//
+
+// minimal writer for the flat objects and arrays the benchmark produces
+class JsonWriter{
+
+public:
+
+    explicit JsonWriter( std::ostream& out ) : out_( out ) { out_.precision( 9 ); };
+
+    void beginObject( const char* key = nullptr ){ open( key, '{' ); }
+    void endObject( ){ close( '}' ); }
+    void beginArray( const char* key = nullptr ){ open( key, '[' ); }
+    void endArray( ){ close( ']' ); }
+
+    template< typename T >
+    void value( const char* key, const T& value ){
+        separator( key );
+        out_ << value;
+    };
+    void value( const char* key, const std::string& value ){
+        separator( key );
+        out_ << '"';
+        for ( char c : value )
+        {
+            if ( c == '"' || c == '\\' )
+            {
+                out_ << '\\';
+            }
+            out_ << ( static_cast< unsigned char >( c ) < 0x20 ? ' ' : c );
+        }
+        out_ << '"';
+    };
+    void value( const char* key, const char* value ){ this->value( key, std::string( value ) ); }
+    void value( const char* key, bool value ){
+        separator( key );
+        out_ << ( value ? "true" : "false" );
+    };
+    void value( const char* key, double value ){
+        separator( key );
+        if ( std::isfinite( value ) )
+        {
+            out_ << value;
+        }
+        else
+        {
+            out_ << "null";
+        }
+    };
+
+private:
+
+    void separator( const char* key ){
+        if ( !first_ )
+        {
+            out_ << ',';
+        }
+        out_ << '\n' << std::string( 2 * depth_, ' ' );
+        if ( key )
+        {
+            out_ << '"' << key << "\": ";
+        }
+        first_ = false;
+    };
+    void open( const char* key, char bracket ){
+        separator( key );
+        out_ << bracket;
+        depth_++;
+        first_ = true;
+    };
+    void close( char bracket ){
+        depth_--;
+        out_ << '\n' << std::string( 2 * depth_, ' ' ) << bracket;
+        first_ = false;
+    };
+
+    std::ostream& out_;
+    int depth_ = 0;
+    bool first_ = true;
+
+};
+
+// loaded timesteps as a source, for the in-memory compression
+class MemoryTimestepSource : public TimestepSource{
+
+public:
+
+    explicit MemoryTimestepSource( const std::vector< MeshData >& steps ) : steps_( steps ) { };
+
+    int timeSteps( ) const override { return int( steps_.size( ) ); }
+    double time( int index ) const override { return 60.0 * index; }
+    MeshData load( int index, const std::shared_ptr< const MeshGeometry >& ) const override { return steps_[ index ]; }
+    void loadTemperature( int, std::vector< float >& temperature ) const override { temperature.clear( ); }
+    void loadTriangle( int index, int triangle, float& shadow, float& temperature ) const override {
+        shadow = steps_[ index ].shadow_[ triangle ];
+        temperature = 0.0f;
+    }
+    bool hasTemperature( ) const override { return false; }
+
+private:
+
+    const std::vector< MeshData >& steps_;
+
+};
+
+//
+// BENCHMARKS
+//
+
+struct BenchOptions{
+
+    std::vector< int > triangles_ = { 10000, 100000, 1000000 };
+    int timeSteps_ = 8;
+    int frames_ = 30;
+    int width_ = 1280;
+    int height_ = 960;
+    std::string workDirectory_ = "bench-data";
+    std::string output_;
+    std::string generate_;
+    bool keep_ = false;
+
+};
+
+// GPU times of a stage over a profiled phase, -1 when not measured
+void writeStage( JsonWriter& json, const char* key, const FrameTiming& mean, ProfileStage stage ){
+    json.beginObject( key );
+    json.value( "cpu_ms", mean.cpu_[ int( stage ) ] );
+    json.value( "gpu_ms", mean.gpu_[ int( stage ) ] );
+    json.endObject( );
+}
+
+// GL work of the renderer per frame, summed over frames by the caller
+void writeGLCounters( JsonWriter& json, const char* key, const GLCounters& sum, int frames ){
+    json.beginObject( key );
+    json.value( "calls", double( sum.calls_ ) / frames );
+    json.value( "state_changes", double( sum.stateChanges_ ) / frames );
+    json.value( "uniforms", double( sum.uniforms_ ) / frames );
+    json.value( "skipped", double( sum.skipped_ ) / frames );
+    json.value( "draws", double( sum.draws_ ) / frames );
+    json.value( "uploaded_bytes", double( sum.uploadedBytes_ ) / frames );
+    json.endObject( );
+}
+
+void benchmarkSize( JsonWriter& json, const BenchOptions& options, int requestedTriangles ){
+
+    std::filesystem::path path = std::filesystem::path( options.workDirectory_ ) /
+        ( "mesh_" + std::to_string( requestedTriangles ) + ".txt" );
+    std::cerr << "benchmarking " << requestedTriangles << " triangles, " << options.timeSteps_ << " timesteps" << std::endl;
+
+    json.beginObject( );
+
+    // generate
+    auto start = Clock::now( );
+    size_t bytes = generateDataset( path.string( ), requestedTriangles, options.timeSteps_ );
+    json.beginObject( "generate" );
+    json.value( "seconds", secondsSince( start ) );
+    json.value( "bytes", bytes );
+    json.endObject( );
+
+    // parse, the same path as loadMesh
+    start = Clock::now( );
+    std::vector< std::vector< double > > rows;
+    {
+        MappedFile file( path.string( ) );
+        file.adviseSequential( );
+        rows = parseTextMesh( file.data( ), file.data( ) + file.size( ) );
+    }
+    double seconds = secondsSince( start );
+    int numberOfTriangles = int( ( rows[ 0 ].size( ) - timestepHeaderSize ) / 10 );
+    json.value( "triangles", numberOfTriangles );
+    json.value( "timesteps", int( rows.size( ) ) );
+    json.beginObject( "parse" );
+    json.value( "seconds", seconds );
+    json.value( "mb_per_s", double( bytes ) / ( 1024.0 * 1024.0 ) / seconds );
+    json.endObject( );
+
+    // MeshData construction: welding, geometry check and per-step attributes
+    start = Clock::now( );
+    auto geometry = std::make_shared< const MeshGeometry >( rows[ 0 ] );
+    double weldSeconds = secondsSince( start );
+    std::atomic< bool > constantGeometry( true );
+    parallelFor( int( rows.size( ) ), [&]( int i ){
+        if ( constantGeometry && !geometry->matches( rows[ i ] ) ){
+            constantGeometry = false;
+        }
+    } );
+    std::vector< MeshData > steps( rows.size( ) );
+    parallelFor( int( rows.size( ) ), [&]( int i ){
+        steps[ i ] = MeshData( rows[ i ], constantGeometry ? geometry : nullptr );
+        std::vector< double >( ).swap( rows[ i ] );
+    } );
+    seconds = secondsSince( start );
+    rows.clear( );
+    rows.shrink_to_fit( );
+    json.beginObject( "meshdata" );
+    json.value( "seconds", seconds );
+    // resident with the rows freed, and the high-water mark of the process
+    // so far which includes the parse
+    json.value( "resident_mb", residentBytes( ) / ( 1024.0 * 1024.0 ) );
+    json.value( "peak_resident_mb", peakResidentBytes( ) / ( 1024.0 * 1024.0 ) );
+    json.value( "weld_seconds", weldSeconds );
+    json.value( "vertices", geometry->positions_.size( ) );
+    json.value( "shared_geometry", bool( constantGeometry ) );
+    json.endObject( );
+
+    // range statistics as done for temperatures at load, run on the shadow
+    // arrays which have the same size, the synthetic rows carry no temperatures
+    start = Clock::now( );
+    RangeStatistics statistics;
+    statistics.reset( int( steps.size( ) ) );
+    parallelFor( int( steps.size( ) ), [&]( int i ){
+        statistics.add( i, steps[ i ].shadow_.data( ), steps[ i ].shadow_.size( ) );
+    } );
+    statistics.finish( );
+    seconds = secondsSince( start );
+    json.beginObject( "statistics" );
+    json.value( "seconds", seconds );
+    json.value( "mvalues_per_s", double( numberOfTriangles ) * steps.size( ) / 1e6 / seconds );
+    json.endObject( );
+
+    // attribute codec: compression of the loaded steps, decoding in order (as in
+    // playback) and in random order (as when scrubbing across keyframe chains)
+    start = Clock::now( );
+    CompressedTimestepSource compressed( compressTimestepSource( MemoryTimestepSource( steps ) ) );
+    seconds = secondsSince( start );
+    const CompressedDataset& dataset = compressed.dataset( );
+    std::vector< float > decoded( numberOfTriangles );
+    start = Clock::now( );
+    for ( int i = 0; i < dataset.timeSteps( ); i++ )
+    {
+        dataset.decode( i, decoded.data( ), nullptr );
+    }
+    double sequentialSeconds = secondsSince( start );
+    float codecError = 0.0f;
+    for ( int i = 0; i < dataset.timeSteps( ); i++ )
+    {
+        dataset.decode( i, decoded.data( ), nullptr );
+        for ( int k = 0; k < numberOfTriangles; k++ )
+        {
+            codecError = std::max( codecError, std::abs( decoded[ k ] - steps[ i ].shadow_[ k ] ) );
+        }
+    }
+    start = Clock::now( );
+    for ( int i = 0; i < dataset.timeSteps( ); i++ )
+    {
+        // strides through the steps so that no decode continues from the previous one
+        dataset.decode( int( ( size_t( i ) * 7919 ) % steps.size( ) ), decoded.data( ), nullptr );
+    }
+    double randomSeconds = secondsSince( start );
+    json.beginObject( "codec" );
+    json.value( "seconds", seconds );
+    json.value( "bytes", dataset.size( ) );
+    json.value( "ratio", double( dataset.uncompressedSize( ) ) / double( dataset.size( ) ) );
+    json.value( "shadow_error", codecError );
+    json.value( "decode_ms", 1000.0 * sequentialSeconds / dataset.timeSteps( ) );
+    json.value( "decode_random_ms", 1000.0 * randomSeconds / dataset.timeSteps( ) );
+    json.value( "decode_mvalues_per_s", double( numberOfTriangles ) * dataset.timeSteps( ) / 1e6 / sequentialSeconds );
+    json.endObject( );
+
+    // error of the compact vertex format, temperatures are all zero here
+    QuantizationError error = measureQuantizationError( geometry->positions_, steps[ 0 ].shadow_,
+        steps[ 0 ].temperature_, ValueRange( ) );
+    json.beginObject( "quantization" );
+    json.value( "position_error", error.position_ );
+    json.value( "position_error_relative", error.positionRelative_ );
+    json.value( "shadow_error", error.shadow_ );
+    json.endObject( );
+
+    // attribute upload: a budget of two resident steps makes every frame upload
+    Renderer renderer;
+    renderer.init( );
+    glEnable(GL_DEPTH_TEST);
+    glm::mat4 view = arcballViewMatrix( glm::quat( 1.0f, 0.0f, 0.0f, 0.0f ), 100.0f, glm::vec3( 0.0f ) );
+    glm::mat4 projection = glm::perspective( glm::radians( 10.0f ),
+        float( options.width_ ) / float( options.height_ ), 0.1f, 1000.0f );
+
+    // picking: BVH build and rays through a grid of pixels of the benchmark view
+    start = Clock::now( );
+    TriangleBVH bvh( geometry );
+    double buildSeconds = secondsSince( start );
+    const int grid = 100;
+    int hits = 0;
+    start = Clock::now( );
+    for ( int i = 0; i < grid * grid; i++ )
+    {
+        float x = ( float( i % grid ) + 0.5f ) * float( options.width_ ) / grid;
+        float y = ( float( i / grid ) + 0.5f ) * float( options.height_ ) / grid;
+        hits += bvh.intersect( cameraRay( view, projection, x, y, float( options.width_ ), float( options.height_ ) ) ).valid( );
+    }
+    seconds = secondsSince( start );
+    json.beginObject( "picking" );
+    json.value( "build_seconds", buildSeconds );
+    json.value( "nodes", bvh.nodes( ) );
+    json.value( "depth", bvh.depth( ) );
+    json.value( "pick_ms", 1000.0 * seconds / ( grid * grid ) );
+    json.value( "hit_fraction", double( hits ) / ( grid * grid ) );
+    json.endObject( );
+
+    // ray-traced self-shadowing with the picking BVH. The sun of the dataset lies
+    // in the plane of the wings, an oblique one lets bus, boom and wings shadow each other
+    ShadowSettings shadowSettings;
+    std::vector< float > tracedShadow;
+    start = Clock::now( );
+    traceShadows( bvh, glm::vec3( 0.6f, 0.3f, 0.75f ), tracedShadow, shadowSettings );
+    seconds = secondsSince( start );
+    double shadowed = 0.0;
+    for ( float value : tracedShadow )
+    {
+        shadowed += value;
+    }
+    json.beginObject( "shadowing" );
+    json.value( "seconds", seconds );
+    json.value( "threads", hardwareThreads( ) );
+    json.value( "samples_per_triangle", shadowSettings.samplesPerTriangle( ) );
+    json.value( "mrays_per_second", double( tracedShadow.size( ) ) * shadowSettings.samplesPerTriangle( ) / seconds / 1e6 );
+    json.value( "mean_shadow", tracedShadow.empty( ) ? 0.0 : shadowed / double( tracedShadow.size( ) ) );
+    json.endObject( );
+
+    // levels of detail from the first, middle and last step
+    start = Clock::now( );
+    std::vector< const MeshData* > samples = { &steps.front( ), &steps[ steps.size( ) / 2 ], &steps.back( ) };
+    std::shared_ptr< const LevelsOfDetail > levels = buildLevelsOfDetail( *geometry, samples, ValueRange( ) );
+    seconds = secondsSince( start );
+    json.beginObject( "lod" );
+    json.value( "build_seconds", seconds );
+    json.beginArray( "levels" );
+    for ( const DetailLevel& level : levels->levels_ )
+    {
+        json.beginObject( );
+        json.value( "triangles", level.numberOfTriangles( ) );
+        json.value( "error", level.error_ );
+        json.endObject( );
+    }
+    json.endArray( );
+    json.endObject( );
+
+    // renders steps first, first + 1, ... or only step first
+    GLCounters glWork;
+    auto renderFrames = [&]( FrameProfiler& profiler, int frames, int first, bool cycle ){
+        renderer.profiler_ = &profiler;
+        glWork = GLCounters( );
+        for ( int f = 0; f < frames; f++ )
+        {
+            profiler.beginFrame( );
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            size_t step = size_t( cycle ? first + f : first ) % steps.size( );
+            renderer.beginFrame( );
+            renderer.renderMesh( steps[ step ], view, projection, VisualizationMode::SHADOW );
+            profiler.endFrame( );
+            renderer.state_.endFrame( );
+            glWork += renderer.state_.lastFrame_;
+        }
+        glFinish( );
+        profiler.flush( );
+        renderer.profiler_ = nullptr;
+    };
+
+    for ( bool compact : { false, true } )
+    {
+        FrameProfiler profiler;
+        profiler.init( );
+        profiler.enabled_ = true;
+        renderer.compactVertices_ = compact;
+        renderer.residentTimesteps_ = 2;
+        size_t uploaded = renderer.uploadedBytes_;
+        start = Clock::now( );
+        // the first frame also uploads positions and indices
+        renderFrames( profiler, 1, 0, false );
+        double geometrySeconds = secondsSince( start );
+        size_t geometryBytes = renderer.uploadedBytes_ - uploaded;
+        uploaded = renderer.uploadedBytes_;
+        start = Clock::now( );
+        renderFrames( profiler, options.frames_, 1, true );
+        seconds = secondsSince( start );
+        profiler.release( );
+        FrameTiming mean = profiler.average( options.frames_ );
+        json.beginObject( compact ? "upload_compact" : "upload" );
+        json.value( "geometry_seconds", geometrySeconds );
+        json.value( "geometry_bytes", geometryBytes );
+        // rate over the CPU time of the upload stage, frame rate includes drawing
+        double bytesPerFrame = double( renderer.uploadedBytes_ - uploaded ) / options.frames_;
+        double uploadSeconds = mean.cpu_[ int( ProfileStage::UPLOAD ) ] / 1000.0;
+        json.value( "attribute_bytes_per_frame", size_t( bytesPerFrame ) );
+        json.value( "attribute_mb_per_s", uploadSeconds > 0.0 ? bytesPerFrame / ( 1024.0 * 1024.0 ) / uploadSeconds : 0.0 );
+        json.value( "fps", options.frames_ / seconds );
+        writeStage( json, "stage", mean, ProfileStage::UPLOAD );
+        writeGLCounters( json, "gl", glWork, options.frames_ );
+        json.endObject( );
+    }
+
+    // render throughput with resident attributes, without overlay, with the
+    // single pass overlay, with the legacy GL_LINE pass, in the compact format
+    // and with the level of detail chosen for the benchmark view
+    renderer.residentTimesteps_ = 8;
+    json.beginObject( "render" );
+    const char* variants[] = { "fill", "overlay", "overlay_two_pass", "fill_compact", "fill_lod" };
+    for ( int variant = 0; variant < 5; variant++ )
+    {
+        FrameProfiler profiler;
+        profiler.init( );
+        profiler.enabled_ = true;
+        renderer.wireFrameOverlay_ = variant == 1 || variant == 2;
+        renderer.singlePassOverlay_ = variant == 1;
+        renderer.compactVertices_ = variant == 3;
+        renderer.levelsOfDetail_ = variant == 4 ? levels : nullptr;
+        renderFrames( profiler, 1, 0, false );
+        start = Clock::now( );
+        renderFrames( profiler, options.frames_, 0, false );
+        seconds = secondsSince( start );
+        profiler.release( );
+        FrameTiming mean = profiler.average( options.frames_ );
+        json.beginObject( variants[ variant ] );
+        json.value( "frames", options.frames_ );
+        json.value( "fps", options.frames_ / seconds );
+        json.value( "triangles_per_s", double( numberOfTriangles ) * options.frames_ / seconds );
+        writeStage( json, "draw", mean, ProfileStage::DRAW );
+        writeGLCounters( json, "gl", glWork, options.frames_ );
+        if ( variant == 2 )
+        {
+            writeStage( json, "overlay", mean, ProfileStage::OVERLAY );
+        }
+        if ( variant == 4 )
+        {
+            int level = renderer.drawnLevel_;
+            json.value( "level", level );
+            json.value( "drawn_triangles", level < 0 ? numberOfTriangles : levels->levels_[ level ].numberOfTriangles( ) );
+        }
+        json.endObject( );
+    }
+    json.endObject( );
+    renderer.release( );
+
+    json.endObject( );
+
+    if ( !options.keep_ )
+    {
+        std::filesystem::remove( path );
+    }
+}
+
+// colorbar draw lists are built every frame, independent of the mesh size
+void benchmarkColorbar( JsonWriter& json, const BenchOptions& options ){
+
+    const int frames = 100;
+    const int colorbarsPerFrame = 10;
+    ImGuiIO& io = ImGui::GetIO();
+    ColormapLibrary colormaps;
+    colormaps.init( );
+    json.beginObject( "colorbar" );
+    for ( int vertical : { 1, 0 } )
+    {
+        Colorbar colorbar;
+        colorbar.vertical_ = vertical;
+        double seconds = 0.0;
+        int vertices = 0;
+        for ( int f = 0; f < frames; f++ )
+        {
+            io.DeltaTime = 1.0f / 60.0f;
+            ImGui_ImplOpenGL3_NewFrame();
+            ImGui::NewFrame();
+            ImDrawList* drawList = ImGui::GetForegroundDrawList();
+            auto start = Clock::now( );
+            for ( int c = 0; c < colorbarsPerFrame; c++ )
+            {
+                colorbar.draw( drawList, VisualizationMode::TEMPERATURE, float( options.width_ ), float( options.height_ ),
+                    ValueRange{ 250.0f, 300.0f }, colormaps.texture( 0 ) );
+            }
+            seconds += secondsSince( start );
+            vertices = drawList->VtxBuffer.Size / colorbarsPerFrame;
+            ImGui::Render();
+        }
+        json.beginObject( vertical ? "vertical" : "horizontal" );
+        json.value( "ms", 1000.0 * seconds / ( frames * colorbarsPerFrame ) );
+        json.value( "vertices", vertices );
+        json.endObject( );
+    }
+    json.endObject( );
+    colormaps.release( );
+}
+
+std::vector< int > parseList( const std::string& text ){
+    std::vector< int > values;
+    std::stringstream stream( text );
+    std::string item;
+    while ( std::getline( stream, item, ',' ) )
+    {
+        values.push_back( std::stoi( item ) );
+    }
+    return values;
+}
+
+} // namespace
+
+int main( int argc, char** argv )
+{
+    BenchOptions options;
+    try
+    {
+        for ( int i = 1; i < argc; i++ )
+        {
+            std::string option = argv[ i ];
+            auto next = [&]( ) -> std::string {
+                if ( i + 1 >= argc )
+                {
+                    throw std::runtime_error( "Error, missing value for " + option );
+                }
+                return argv[ ++i ];
+            };
+            if ( option == "--triangles" ) options.triangles_ = parseList( next( ) );
+            else if ( option == "--timesteps" ) options.timeSteps_ = std::max( std::stoi( next( ) ), 1 );
+            else if ( option == "--frames" ) options.frames_ = std::max( std::stoi( next( ) ), 1 );
+            else if ( option == "--size" )
+            {
+                options.width_ = std::stoi( next( ) );
+                options.height_ = std::stoi( next( ) );
+            }
+            else if ( option == "--work-dir" ) options.workDirectory_ = next( );
+            else if ( option == "--output" ) options.output_ = next( );
+            else if ( option == "--generate" ) options.generate_ = next( );
+            else if ( option == "--keep" ) options.keep_ = true;
+            else throw std::runtime_error( "Error, unknown option " + option );
+        }
+    }
+    catch ( const std::exception& error )
+    {
+        std::cerr << error.what( ) << "\nusage: " << argv[ 0 ] << " [--triangles n,n,...] [--timesteps n] [--frames n]"
+                  << " [--size w h] [--work-dir dir] [--keep] [--output file.json] [--generate mesh.txt]" << std::endl;
+        return 1;
+    }
+
+    try
+    {
+        if ( !options.generate_.empty( ) )
+        {
+            size_t bytes = generateDataset( options.generate_, options.triangles_.front( ), options.timeSteps_ );
+            std::cout << "wrote " << options.generate_ << " (" << bytes / ( 1024.0 * 1024.0 ) << " MB)" << std::endl;
+            return 0;
+        }
+
+        std::filesystem::create_directories( options.workDirectory_ );
+        HeadlessContext context( options.width_, options.height_ );
+
+        IMGUI_CHECKVERSION();
+        ImGui::CreateContext();
+        ImGuiIO& io = ImGui::GetIO();
+        io.IniFilename = nullptr;
+        io.DisplaySize = ImVec2( float( options.width_ ), float( options.height_ ) );
+        ImGui_ImplOpenGL3_Init("#version 330");
+
+        std::ostringstream text;
+        JsonWriter json( text );
+        json.beginObject( );
+        json.value( "renderer", context.description( ) );
+        json.value( "threads", hardwareThreads( ) );
+        json.value( "width", options.width_ );
+        json.value( "height", options.height_ );
+        json.value( "frames", options.frames_ );
+        benchmarkColorbar( json, options );
+        json.beginArray( "sizes" );
+        for ( int triangles : options.triangles_ )
+        {
+            benchmarkSize( json, options, triangles );
+        }
+        json.endArray( );
+        json.endObject( );
+        text << '\n';
+
+        ImGui_ImplOpenGL3_Shutdown();
+        ImGui::DestroyContext();
+
+        if ( options.output_.empty( ) )
+        {
+            std::cout << text.str( );
+        }
+        else
+        {
+            std::ofstream( options.output_ ) << text.str( );
+            std::cerr << "results written to " << options.output_ << std::endl;
+        }
+        return 0;
+    }
+    catch ( const std::exception& error )
+    {
+        std::cerr << error.what( ) << std::endl;
+        return 1;
+    }
+}
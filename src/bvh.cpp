@@ -0,0 +1,430 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "parallel.h"
+
+namespace {
+
+constexpr float infinity = std::numeric_limits< float >::max( );
+
+// half the surface area of a box, the heuristic only compares ratios
+float halfArea( const glm::vec3& lower, const glm::vec3& upper ){
+    glm::vec3 extent = upper - lower;
+    return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+}
+
+// distance at which the ray enters the box, infinity if it misses
+float boxEntry( const glm::vec3& lower, const glm::vec3& upper, const Ray& ray, const glm::vec3& inverseDirection ){
+    glm::vec3 t0 = ( lower - ray.origin_ ) * inverseDirection;
+    glm::vec3 t1 = ( upper - ray.origin_ ) * inverseDirection;
+    glm::vec3 near = glm::min( t0, t1 );
+    glm::vec3 far = glm::max( t0, t1 );
+    float entry = std::max( { near.x, near.y, near.z, 0.0f } );
+    float exit = std::min( { far.x, far.y, far.z } );
+    return entry <= exit ? entry : infinity;
+}
+
+// Moeller-Trumbore, both faces
+bool intersectTriangle( const Ray& ray, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, float& distance ){
+    glm::vec3 edge1 = b - a;
+    glm::vec3 edge2 = c - a;
+    glm::vec3 p = glm::cross( ray.direction_, edge2 );
+    float determinant = glm::dot( edge1, p );
+    if ( determinant == 0.0f )
+    {
+        return false;
+    }
+    float inverse = 1.0f / determinant;
+    glm::vec3 s = ray.origin_ - a;
+    float u = glm::dot( s, p ) * inverse;
+    if ( u < 0.0f || u > 1.0f )
+    {
+        return false;
+    }
+    glm::vec3 q = glm::cross( s, edge1 );
+    float v = glm::dot( ray.direction_, q ) * inverse;
+    if ( v < 0.0f || u + v > 1.0f )
+    {
+        return false;
+    }
+    distance = glm::dot( edge2, q ) * inverse;
+    return distance > 0.0f;
+}
+
+} // namespace
+
+Ray cameraRay( const glm::mat4& view, const glm::mat4& projection, float x, float y, float width, float height ){
+    glm::mat4 inverse = glm::inverse( projection * view );
+    float nx = 2.0f * x / width - 1.0f;
+    float ny = 1.0f - 2.0f * y / height;
+    glm::vec4 near = inverse * glm::vec4( nx, ny, -1.0f, 1.0f );
+    glm::vec4 far = inverse * glm::vec4( nx, ny, 1.0f, 1.0f );
+    Ray ray;
+    ray.origin_ = glm::vec3( near ) / near.w;
+    ray.direction_ = glm::normalize( glm::vec3( far ) / far.w - ray.origin_ );
+    return ray;
+}
+
+TriangleBVH::TriangleBVH( std::shared_ptr< const MeshGeometry > geometry, int numberOfThreads ) : geometry_( std::move( geometry ) ) {
+
+    const MeshGeometry& mesh = *geometry_;
+    uint32_t numberOfTriangles = uint32_t( mesh.numberOfTriangles( ) );
+    if ( numberOfTriangles == 0 )
+    {
+        return;
+    }
+
+    lower_.resize( numberOfTriangles );
+    upper_.resize( numberOfTriangles );
+    centroids_.resize( numberOfTriangles );
+    triangles_.resize( numberOfTriangles );
+    const uint32_t chunkSize = 65536;
+    parallelFor( int( ( numberOfTriangles + chunkSize - 1 ) / chunkSize ), [&]( int chunk ){
+        uint32_t end = std::min( ( uint32_t( chunk ) + 1 ) * chunkSize, numberOfTriangles );
+        for ( uint32_t t = uint32_t( chunk ) * chunkSize; t < end; t++ )
+        {
+            const glm::vec3& a = mesh.positions_[ mesh.indices_[ 3*t ] ];
+            const glm::vec3& b = mesh.positions_[ mesh.indices_[ 3*t + 1 ] ];
+            const glm::vec3& c = mesh.positions_[ mesh.indices_[ 3*t + 2 ] ];
+            lower_[ t ] = glm::min( glm::min( a, b ), c );
+            upper_[ t ] = glm::max( glm::max( a, b ), c );
+            centroids_[ t ] = ( a + b + c ) / 3.0f;
+            triangles_[ t ] = t;
+        }
+    }, numberOfThreads );
+
+    // split the upper levels here until there are enough subtrees for every thread
+    int threads = numberOfThreads > 0 ? numberOfThreads : hardwareThreads( );
+    uint32_t subtreeSize = std::max( numberOfTriangles / uint32_t( 8 * threads ), uint32_t( 4096 ) );
+    nodes_.resize( 1 );
+    std::vector< Task > pending = { { 0, 0, numberOfTriangles, 0 } };
+    std::vector< Task > subtrees;
+    while ( !pending.empty( ) )
+    {
+        Task task = pending.back( );
+        pending.pop_back( );
+        if ( task.end_ - task.begin_ <= subtreeSize )
+        {
+            subtrees.push_back( task );
+            continue;
+        }
+        depth_ = std::max( depth_, task.depth_ + 1 );
+        Task children[ 2 ];
+        if ( split( task, nodes_, children ) )
+        {
+            pending.push_back( children[ 0 ] );
+            pending.push_back( children[ 1 ] );
+        }
+    }
+
+    std::vector< std::vector< Node > > built( subtrees.size( ) );
+    std::vector< int > depths( subtrees.size( ), 0 );
+    parallelFor( int( subtrees.size( ) ), [&]( int i ){
+        built[ i ] = buildSubtree( subtrees[ i ], depths[ i ] );
+    }, numberOfThreads );
+
+    // the root of a subtree replaces its placeholder, the rest is appended
+    for ( size_t i = 0; i < subtrees.size( ); i++ )
+    {
+        uint32_t base = uint32_t( nodes_.size( ) ) - 1;
+        auto relocate = [base]( Node node ){
+            if ( node.count_ == 0 )
+            {
+                node.first_ += base;
+            }
+            return node;
+        };
+        nodes_[ subtrees[ i ].node_ ] = relocate( built[ i ][ 0 ] );
+        for ( size_t j = 1; j < built[ i ].size( ); j++ )
+        {
+            nodes_.push_back( relocate( built[ i ][ j ] ) );
+        }
+        depth_ = std::max( depth_, depths[ i ] );
+    }
+
+    std::vector< glm::vec3 >( ).swap( lower_ );
+    std::vector< glm::vec3 >( ).swap( upper_ );
+    std::vector< glm::vec3 >( ).swap( centroids_ );
+}
+
+std::vector< TriangleBVH::Node > TriangleBVH::buildSubtree( const Task& root, int& depth ){
+    std::vector< Node > nodes( 1 );
+    std::vector< Task > stack = { { 0, root.begin_, root.end_, root.depth_ } };
+    while ( !stack.empty( ) )
+    {
+        Task task = stack.back( );
+        stack.pop_back( );
+        depth = std::max( depth, task.depth_ + 1 );
+        Task children[ 2 ];
+        if ( split( task, nodes, children ) )
+        {
+            stack.push_back( children[ 1 ] );
+            stack.push_back( children[ 0 ] );
+        }
+    }
+    return nodes;
+}
+
+bool TriangleBVH::split( const Task& task, std::vector< Node >& nodes, Task children[ 2 ] ){
+
+    glm::vec3 lower( infinity ), upper( -infinity );
+    glm::vec3 centroidLower( infinity ), centroidUpper( -infinity );
+    for ( uint32_t i = task.begin_; i < task.end_; i++ )
+    {
+        uint32_t t = triangles_[ i ];
+        lower = glm::min( lower, lower_[ t ] );
+        upper = glm::max( upper, upper_[ t ] );
+        centroidLower = glm::min( centroidLower, centroids_[ t ] );
+        centroidUpper = glm::max( centroidUpper, centroids_[ t ] );
+    }
+    uint32_t count = task.end_ - task.begin_;
+    nodes[ task.node_ ] = { lower, task.begin_, upper, count };
+    if ( count <= leafSize || task.depth_ >= maximumDepth - 1 )
+    {
+        return false;
+    }
+
+    glm::vec3 extent = centroidUpper - centroidLower;
+    int axis = extent.x > extent.y && extent.x > extent.z ? 0 : extent.y > extent.z ? 1 : 2;
+    uint32_t middle = task.begin_ + count / 2;
+    auto first = triangles_.begin( ) + task.begin_;
+    auto last = triangles_.begin( ) + task.end_;
+    // coinciding centroids are split in halves as they are
+    if ( extent[ axis ] > 0.0f )
+    {
+        struct Bin{
+            glm::vec3 min_ = glm::vec3( infinity );
+            glm::vec3 max_ = glm::vec3( -infinity );
+            uint32_t count_ = 0;
+        };
+        Bin bins[ numberOfBins ];
+        float scale = float( numberOfBins ) / extent[ axis ];
+        auto binOf = [&]( uint32_t t ){
+            return std::min( int( ( centroids_[ t ][ axis ] - centroidLower[ axis ] ) * scale ), numberOfBins - 1 );
+        };
+        for ( uint32_t i = task.begin_; i < task.end_; i++ )
+        {
+            uint32_t t = triangles_[ i ];
+            Bin& bin = bins[ binOf( t ) ];
+            bin.min_ = glm::min( bin.min_, lower_[ t ] );
+            bin.max_ = glm::max( bin.max_, upper_[ t ] );
+            bin.count_++;
+        }
+
+        // cost of the right side for a split before every bin, then sweep the left side
+        float rightCost[ numberOfBins ];
+        Bin side;
+        for ( int b = numberOfBins - 1; b > 0; b-- )
+        {
+            side.min_ = glm::min( side.min_, bins[ b ].min_ );
+            side.max_ = glm::max( side.max_, bins[ b ].max_ );
+            side.count_ += bins[ b ].count_;
+            rightCost[ b ] = side.count_ > 0 ? halfArea( side.min_, side.max_ ) * float( side.count_ ) : 0.0f;
+        }
+        side = Bin( );
+        int bestSplit = 0;
+        float bestCost = infinity;
+        for ( int b = 1; b < numberOfBins; b++ )
+        {
+            side.min_ = glm::min( side.min_, bins[ b - 1 ].min_ );
+            side.max_ = glm::max( side.max_, bins[ b - 1 ].max_ );
+            side.count_ += bins[ b - 1 ].count_;
+            if ( side.count_ == 0 || side.count_ == count )
+            {
+                continue;
+            }
+            float cost = halfArea( side.min_, side.max_ ) * float( side.count_ ) + rightCost[ b ];
+            if ( cost < bestCost )
+            {
+                bestCost = cost;
+                bestSplit = b;
+            }
+        }
+        if ( bestSplit > 0 )
+        {
+            middle = uint32_t( std::partition( first, last, [&]( uint32_t t ){ return binOf( t ) < bestSplit; } ) - triangles_.begin( ) );
+        }
+        else
+        {
+            std::nth_element( first, triangles_.begin( ) + middle, last, [&]( uint32_t a, uint32_t b ){
+                return centroids_[ a ][ axis ] < centroids_[ b ][ axis ];
+            } );
+        }
+    }
+
+    uint32_t left = uint32_t( nodes.size( ) );
+    nodes.resize( nodes.size( ) + 2 );
+    nodes[ task.node_ ].first_ = left;
+    nodes[ task.node_ ].count_ = 0;
+    children[ 0 ] = { left, task.begin_, middle, task.depth_ + 1 };
+    children[ 1 ] = { left + 1, middle, task.end_, task.depth_ + 1 };
+    return true;
+}
+
+RayHit TriangleBVH::intersect( const Ray& ray ) const {
+
+    RayHit hit;
+    if ( nodes_.empty( ) )
+    {
+        return hit;
+    }
+    const MeshGeometry& mesh = *geometry_;
+    glm::vec3 inverseDirection = 1.0f / ray.direction_;
+
+    // children are visited nearest first, so at most one sibling per level waits
+    uint32_t stack[ maximumDepth + 1 ];
+    int size = 0;
+    if ( boxEntry( nodes_[ 0 ].min_, nodes_[ 0 ].max_, ray, inverseDirection ) < infinity )
+    {
+        stack[ size++ ] = 0;
+    }
+    while ( size > 0 )
+    {
+        const Node& node = nodes_[ stack[ --size ] ];
+        if ( node.count_ > 0 )
+        {
+            for ( uint32_t i = node.first_; i < node.first_ + node.count_; i++ )
+            {
+                uint32_t t = triangles_[ i ];
+                float distance;
+                if ( intersectTriangle( ray, mesh.positions_[ mesh.indices_[ 3*t ] ], mesh.positions_[ mesh.indices_[ 3*t + 1 ] ],
+                                        mesh.positions_[ mesh.indices_[ 3*t + 2 ] ], distance ) && distance < hit.distance_ )
+                {
+                    hit.triangle_ = int( t );
+                    hit.distance_ = distance;
+                }
+            }
+            continue;
+        }
+        uint32_t near = node.first_;
+        uint32_t far = node.first_ + 1;
+        float nearEntry = boxEntry( nodes_[ near ].min_, nodes_[ near ].max_, ray, inverseDirection );
+        float farEntry = boxEntry( nodes_[ far ].min_, nodes_[ far ].max_, ray, inverseDirection );
+        if ( farEntry < nearEntry )
+        {
+            std::swap( near, far );
+            std::swap( nearEntry, farEntry );
+        }
+        if ( farEntry < hit.distance_ )
+        {
+            stack[ size++ ] = far;
+        }
+        if ( nearEntry < hit.distance_ )
+        {
+            stack[ size++ ] = near;
+        }
+    }
+    if ( hit.valid( ) )
+    {
+        hit.point_ = ray.origin_ + ray.direction_ * hit.distance_;
+    }
+    return hit;
+}
+
+uint32_t TriangleBVH::occluded( const RayPacket& packet ) const {
+
+    uint32_t hit = 0;
+    if ( nodes_.empty( ) || packet.active_ == 0 )
+    {
+        return hit;
+    }
+    const MeshGeometry& mesh = *geometry_;
+    const glm::vec3 direction = packet.direction_;
+    // axis aligned directions, e.g. a sun picked in the viewer, would give 0 * inf in the box tests
+    glm::vec3 inverseDirection;
+    for ( int k = 0; k < 3; k++ )
+    {
+        inverseDirection[ k ] = 1.0f / ( std::abs( direction[ k ] ) > 1e-20f ? direction[ k ] : std::copysign( 1e-20f, direction[ k ] ) );
+    }
+
+    // rays of the packet that hit the box, among those in mask
+    auto boxMask = [&]( const Node& node, uint32_t mask ){
+        uint32_t inside = 0;
+        for ( int r = 0; r < rayPacketSize; r++ )
+        {
+            float x0 = ( node.min_.x - packet.x_[ r ] ) * inverseDirection.x;
+            float x1 = ( node.max_.x - packet.x_[ r ] ) * inverseDirection.x;
+            float y0 = ( node.min_.y - packet.y_[ r ] ) * inverseDirection.y;
+            float y1 = ( node.max_.y - packet.y_[ r ] ) * inverseDirection.y;
+            float z0 = ( node.min_.z - packet.z_[ r ] ) * inverseDirection.z;
+            float z1 = ( node.max_.z - packet.z_[ r ] ) * inverseDirection.z;
+            float entry = std::max( std::max( std::min( x0, x1 ), std::min( y0, y1 ) ), std::max( std::min( z0, z1 ), 0.0f ) );
+            float exit = std::min( std::min( std::max( x0, x1 ), std::max( y0, y1 ) ), std::max( z0, z1 ) );
+            inside |= uint32_t( entry <= exit ) << r;
+        }
+        return inside & mask;
+    };
+
+    struct Entry{
+        uint32_t node_;
+        uint32_t mask_;
+    };
+    Entry stack[ maximumDepth + 1 ];
+    int size = 0;
+    uint32_t rootMask = boxMask( nodes_[ 0 ], packet.active_ );
+    if ( rootMask )
+    {
+        stack[ size++ ] = { 0, rootMask };
+    }
+    while ( size > 0 )
+    {
+        Entry entry = stack[ --size ];
+        // rays that already hit something need no further triangles
+        uint32_t mask = entry.mask_ & ~hit;
+        if ( mask == 0 )
+        {
+            continue;
+        }
+        const Node& node = nodes_[ entry.node_ ];
+        if ( node.count_ > 0 )
+        {
+            for ( uint32_t i = node.first_; i < node.first_ + node.count_; i++ )
+            {
+                uint32_t t = triangles_[ i ];
+                const glm::vec3& a = mesh.positions_[ mesh.indices_[ 3*t ] ];
+                glm::vec3 edge1 = mesh.positions_[ mesh.indices_[ 3*t + 1 ] ] - a;
+                glm::vec3 edge2 = mesh.positions_[ mesh.indices_[ 3*t + 2 ] ] - a;
+                // Moeller-Trumbore, the terms of the shared direction once per triangle
+                glm::vec3 p = glm::cross( direction, edge2 );
+                float determinant = glm::dot( edge1, p );
+                if ( determinant == 0.0f )
+                {
+                    continue;
+                }
+                float inverse = 1.0f / determinant;
+                uint32_t hits = 0;
+                for ( int r = 0; r < rayPacketSize; r++ )
+                {
+                    glm::vec3 s( packet.x_[ r ] - a.x, packet.y_[ r ] - a.y, packet.z_[ r ] - a.z );
+                    float u = glm::dot( s, p ) * inverse;
+                    glm::vec3 q = glm::cross( s, edge1 );
+                    float v = glm::dot( direction, q ) * inverse;
+                    float distance = glm::dot( edge2, q ) * inverse;
+                    hits |= uint32_t( u >= 0.0f && v >= 0.0f && u + v <= 1.0f && distance > 0.0f ) << r;
+                }
+                hit |= hits & mask;
+                mask &= ~hit;
+                if ( mask == 0 )
+                {
+                    break;
+                }
+            }
+            if ( hit == packet.active_ )
+            {
+                return hit;
+            }
+            continue;
+        }
+        for ( uint32_t child = node.first_; child < node.first_ + 2; child++ )
+        {
+            uint32_t childMask = boxMask( nodes_[ child ], mask );
+            if ( childMask )
+            {
+                stack[ size++ ] = { child, childMask };
+            }
+        }
+    }
+    return hit;
+}
@@ -0,0 +1,131 @@
+#include "capture.h"
+
+#include <cstring>
+#include <iostream>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+//
+// READBACK
+//
+void PixelReadback::request( int width, int height, const std::string& path ){
+
+    GLuint buffer;
+    if ( freeBuffers_.empty( ) )
+    {
+        glGenBuffers(1, &buffer);
+    }
+    else
+    {
+        buffer = freeBuffers_.back( );
+        freeBuffers_.pop_back( );
+    }
+
+    GLsizeiptr size = GLsizeiptr( width ) * height * 3;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+    glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    // with a pack buffer bound this returns immediately
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, (void*)0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    inFlight_.push_back( { buffer, fence, width, height, path } );
+}
+
+bool PixelReadback::collect( Image& image, bool wait ){
+
+    if ( inFlight_.empty( ) )
+    {
+        return false;
+    }
+    Request& request = inFlight_.front( );
+    GLuint64 timeout = wait ? GLuint64( 1000000000 ) : 0;
+    GLenum status = glClientWaitSync(request.fence_, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+    while ( wait && status == GL_TIMEOUT_EXPIRED )
+    {
+        status = glClientWaitSync(request.fence_, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+    }
+    if ( status == GL_TIMEOUT_EXPIRED )
+    {
+        return false;
+    }
+    glDeleteSync(request.fence_);
+
+    image.width_ = request.width_;
+    image.height_ = request.height_;
+    image.path_ = request.path_;
+    size_t size = size_t( request.width_ ) * request.height_ * 3;
+    image.pixels_.resize( size );
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, request.buffer_);
+    const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr( size ), GL_MAP_READ_BIT);
+    if ( pixels )
+    {
+        std::memcpy( image.pixels_.data( ), pixels, size );
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    freeBuffers_.push_back( request.buffer_ );
+    inFlight_.pop_front( );
+    return pixels != nullptr;
+}
+
+void PixelReadback::release( ){
+    for ( auto& request : inFlight_ )
+    {
+        glDeleteSync(request.fence_);
+        freeBuffers_.push_back( request.buffer_ );
+    }
+    inFlight_.clear( );
+    if ( !freeBuffers_.empty( ) )
+    {
+        glDeleteBuffers(GLsizei( freeBuffers_.size( ) ), freeBuffers_.data( ));
+    }
+    freeBuffers_.clear( );
+}
+
+//
+// WRITER
+//
+void ImageWriter::write( Image image ){
+
+    pool_.submit( [this, image = std::move( image )]( ) mutable {
+        // an exception would end the worker and the program, it is a failed write
+        // like any other (the row buffer and stb allocate)
+        bool success = false;
+        try
+        {
+            // OpenGL rows start at the bottom, PNG rows at the top
+            size_t stride = size_t( image.width_ ) * 3;
+            std::vector< unsigned char > row( stride );
+            for ( int y = 0; y < image.height_ / 2; y++ )
+            {
+                unsigned char* top = image.pixels_.data( ) + y * stride;
+                unsigned char* bottom = image.pixels_.data( ) + ( image.height_ - 1 - y ) * stride;
+                std::memcpy( row.data( ), top, stride );
+                std::memcpy( top, bottom, stride );
+                std::memcpy( bottom, row.data( ), stride );
+            }
+            success = stbi_write_png( image.path_.c_str( ), image.width_, image.height_, 3, image.pixels_.data( ), int( stride ) ) != 0;
+        }
+        catch ( const std::exception& e )
+        {
+            std::cerr << "Error, " << e.what( ) << std::endl;
+        }
+        catch ( ... )
+        {
+        }
+        if ( success )
+        {
+            written_++;
+        }
+        else
+        {
+            failed_++;
+            std::cerr << "Error, failed to write " << image.path_ << std::endl;
+        }
+    } );
+}
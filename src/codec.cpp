@@ -0,0 +1,543 @@
+#include "codec.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+constexpr size_t blockSize = 64;
+
+size_t numberOfBlocks( size_t count ){
+    return ( count + blockSize - 1 ) / blockSize;
+}
+
+inline uint32_t zigzag( int32_t value ){
+    return ( uint32_t( value ) << 1 ) ^ uint32_t( value >> 31 );
+}
+
+inline int32_t unzigzag( uint32_t value ){
+    return int32_t( value >> 1 ) ^ -int32_t( value & 1 );
+}
+
+// nearest multiple of step, clamped so that differences of two values still fit
+inline int32_t quantize( float value, float step ){
+    double q = std::round( double( value ) / double( step ) );
+    q = std::isfinite( q ) ? q : 0.0;
+    return int32_t( std::min( std::max( q, -1073741823.0 ), 1073741823.0 ) );
+}
+
+// residual i of a block with the given width, words holds width + 1 words
+inline uint32_t residual( const uint64_t* words, uint32_t width, size_t i ){
+    size_t bit = i * width;
+    size_t word = bit >> 6;
+    uint32_t shift = uint32_t( bit & 63 );
+    uint64_t value = words[ word ] >> shift;
+    if ( shift + width > 64 )
+    {
+        value |= words[ word + 1 ] << ( 64 - shift );
+    }
+    return uint32_t( value & ( ( uint64_t( 1 ) << width ) - 1 ) );
+}
+
+// length of a section of count values, from its widths
+size_t sectionSize( const uint8_t* widths, size_t count, bool keyframe ){
+    size_t blocks = numberOfBlocks( count );
+    size_t size = blocks * ( keyframe ? 1 + sizeof( int32_t ) : 1 );
+    for ( size_t b = 0; b < blocks; b++ )
+    {
+        size += 8 * size_t( widths[ b ] );
+    }
+    return size;
+}
+
+// length of a section in the available bytes, false when a width exceeds the
+// 32 bits of a residual or the section does not fit
+bool checkSection( const char* section, size_t available, size_t count, bool keyframe, size_t& size ){
+    size_t blocks = numberOfBlocks( count );
+    if ( blocks > available )
+    {
+        return false;
+    }
+    const uint8_t* widths = reinterpret_cast< const uint8_t* >( section );
+    for ( size_t b = 0; b < blocks; b++ )
+    {
+        if ( widths[ b ] > 32 )
+        {
+            return false;
+        }
+    }
+    size = sectionSize( widths, count, keyframe );
+    return size <= available;
+}
+
+// applies one section to the quantized values, returns the end of the section
+const char* decodeSection( const char* section, size_t count, bool keyframe, int32_t* values ){
+
+    size_t blocks = numberOfBlocks( count );
+    const uint8_t* widths = reinterpret_cast< const uint8_t* >( section );
+    const char* bases = section + blocks;
+    const char* payload = bases + ( keyframe ? blocks * sizeof( int32_t ) : 0 );
+    uint64_t words[ 33 ];
+    for ( size_t b = 0; b < blocks; b++ )
+    {
+        uint32_t width = widths[ b ];
+        size_t first = b * blockSize;
+        size_t last = std::min( first + blockSize, count );
+        if ( !keyframe && width == 0 )
+        {
+            continue;
+        }
+        std::memcpy( words, payload, 8 * width );
+        words[ width ] = 0;
+        payload += 8 * width;
+        if ( keyframe )
+        {
+            int32_t value;
+            std::memcpy( &value, bases + b * sizeof( int32_t ), sizeof( int32_t ) );
+            for ( size_t i = first; i < last; i++ )
+            {
+                value += width ? unzigzag( residual( words, width, i - first ) ) : 0;
+                values[ i ] = value;
+            }
+        }
+        else
+        {
+            for ( size_t i = first; i < last; i++ )
+            {
+                values[ i ] += unzigzag( residual( words, width, i - first ) );
+            }
+        }
+    }
+    return payload;
+}
+
+// applies one section to the quantized value of a single triangle
+void decodeSectionValue( const char* section, size_t count, bool keyframe, size_t index, int32_t& value ){
+
+    size_t blocks = numberOfBlocks( count );
+    size_t block = index / blockSize;
+    const uint8_t* widths = reinterpret_cast< const uint8_t* >( section );
+    const char* payload = section + blocks * ( keyframe ? 1 + sizeof( int32_t ) : 1 );
+    size_t words = 0;
+    for ( size_t b = 0; b < block; b++ )
+    {
+        words += widths[ b ];
+    }
+    payload += 8 * words;
+    uint32_t width = widths[ block ];
+    uint64_t bits[ 33 ];
+    std::memcpy( bits, payload, 8 * width );
+    bits[ width ] = 0;
+    if ( keyframe )
+    {
+        std::memcpy( &value, section + blocks + block * sizeof( int32_t ), sizeof( int32_t ) );
+        for ( size_t i = 1; i <= index - block * blockSize && width > 0; i++ )
+        {
+            value += unzigzag( residual( bits, width, i ) );
+        }
+    }
+    else if ( width > 0 )
+    {
+        value += unzigzag( residual( bits, width, index - block * blockSize ) );
+    }
+}
+
+std::atomic< uint64_t > nextDatasetId( 1 );
+
+// quantized values of the last timestep decoded on this thread
+struct DecodeCursor{
+    uint64_t dataset_ = 0;
+    int step_ = -1;
+    std::vector< int32_t > shadow_;
+    std::vector< int32_t > temperature_;
+};
+
+thread_local DecodeCursor cursor;
+
+} // namespace
+
+//
+// WRITER
+//
+CompressedDatasetWriter::CompressedDatasetWriter( const std::string& path, int numberOfTriangles, bool temperature,
+    const CodecSettings& settings ) :
+    numberOfTriangles_( uint64_t( numberOfTriangles ) ),
+    temperature_( temperature ),
+    settings_( settings ) {
+
+    if ( !( settings_.shadowStep_ > 0.0f ) || !( settings_.temperatureStep_ > 0.0f ) || settings_.keyframeInterval_ < 1 )
+    {
+        throw std::runtime_error( "Error, quantization steps and the keyframe interval must be positive!" );
+    }
+    if ( !path.empty( ) )
+    {
+        file_ = std::fopen( path.c_str( ), "wb" );
+        if ( !file_ )
+        {
+            throw std::runtime_error( "Error, failed to create " + path );
+        }
+    }
+    // counts and the index offset are patched in close( )
+    CompressedDatasetHeader header{ };
+    append( &header, sizeof( header ) );
+
+    size_t padded = numberOfBlocks( numberOfTriangles_ ) * blockSize;
+    previousShadow_.assign( numberOfTriangles_, 0 );
+    previousTemperature_.assign( temperature_ ? numberOfTriangles_ : 0, 0 );
+    residuals_.assign( padded, 0 );
+}
+
+CompressedDatasetWriter::~CompressedDatasetWriter( ){
+    if ( file_ )
+    {
+        std::fclose( file_ );
+    }
+}
+
+void CompressedDatasetWriter::write( const std::vector< double >& row, const std::vector< double >* temperature ){
+
+    if ( row.size( ) != timestepHeaderSize + 10 * numberOfTriangles_ )
+    {
+        throw std::runtime_error( "Error, timestep " + std::to_string( timeSteps( ) ) + " has an inconsistent number of values!" );
+    }
+    if ( temperature_ != ( temperature != nullptr ) )
+    {
+        throw std::runtime_error( "Error, timestep " + std::to_string( timeSteps( ) ) + " has no temperatures!" );
+    }
+    auto toFloat = []( double value ){ return float( value ); };
+    auto shadow = row.begin( ) + timestepHeaderSize;
+    auto positions = shadow + numberOfTriangles_;
+    converted_.resize( ( temperature_ ? 2 : 1 ) * numberOfTriangles_ );
+    std::transform( shadow, positions, converted_.begin( ), toFloat );
+    if ( temperature )
+    {
+        checkTemperatureRow( *temperature, row[ 0 ], int( numberOfTriangles_ ), timeSteps( ) );
+        std::transform( temperature->begin( ) + 1, temperature->end( ), converted_.begin( ) + numberOfTriangles_, toFloat );
+    }
+    std::vector< float > current( positions, row.end( ) );
+    bool changed = entries_.empty( ) || current != positions_;
+    if ( changed )
+    {
+        positions_.swap( current );
+    }
+    write( row.data( ), converted_.data( ), temperature ? converted_.data( ) + numberOfTriangles_ : nullptr,
+        changed ? positions_.data( ) : nullptr );
+}
+
+void CompressedDatasetWriter::write( const TimestepView& timestep ){
+
+    if ( uint64_t( timestep.numberOfTriangles_ ) != numberOfTriangles_ || temperature_ != ( timestep.temperature_ != nullptr ) )
+    {
+        throw std::runtime_error( "Error, timestep " + std::to_string( timeSteps( ) ) + " does not match the dataset!" );
+    }
+    size_t count = 9 * numberOfTriangles_;
+    bool changed = entries_.empty( ) || std::memcmp( timestep.positions_, positions_.data( ), count * sizeof( float ) ) != 0;
+    if ( changed )
+    {
+        positions_.assign( timestep.positions_, timestep.positions_ + count );
+    }
+    write( timestep.header_, timestep.shadow_, timestep.temperature_, changed ? positions_.data( ) : nullptr );
+}
+
+void CompressedDatasetWriter::write( const double* header, const float* shadow, const float* temperature, const float* positions ){
+
+    if ( closed_ )
+    {
+        throw std::runtime_error( "Error, compressed dataset is already closed!" );
+    }
+    CompressedFrameEntry entry;
+    std::copy( header, header + timestepHeaderSize, entry.header_ );
+    if ( positions )
+    {
+        entry.positionsOffset_ = offset_;
+        append( positions, 9 * numberOfTriangles_ * sizeof( float ) );
+        pad( );
+    }
+    else
+    {
+        entry.positionsOffset_ = entries_.back( ).positionsOffset_;
+    }
+
+    bool keyframe = entries_.size( ) % size_t( settings_.keyframeInterval_ ) == 0;
+    frame_.clear( );
+    encodeSection( shadow, settings_.shadowStep_, keyframe, previousShadow_ );
+    if ( temperature_ )
+    {
+        encodeSection( temperature, settings_.temperatureStep_, keyframe, previousTemperature_ );
+    }
+    entry.frameOffset_ = offset_;
+    append( frame_.data( ), frame_.size( ) );
+    pad( );
+    entries_.push_back( entry );
+}
+
+void CompressedDatasetWriter::encodeSection( const float* values, float step, bool keyframe, std::vector< int32_t >& previous ){
+
+    size_t count = numberOfTriangles_;
+    size_t blocks = numberOfBlocks( count );
+    std::vector< int32_t > bases( keyframe ? blocks : 0 );
+    for ( size_t i = 0; i < count; i++ )
+    {
+        int32_t value = quantize( values[ i ], step );
+        if ( keyframe )
+        {
+            // the first triangle of a block is its base, the others follow their predecessor
+            bool first = i % blockSize == 0;
+            bases[ i / blockSize ] = first ? value : bases[ i / blockSize ];
+            residuals_[ i ] = first ? 0 : zigzag( value - previous[ i - 1 ] );
+        }
+        else
+        {
+            residuals_[ i ] = zigzag( value - previous[ i ] );
+        }
+        previous[ i ] = value;
+    }
+
+    size_t widthsAt = frame_.size( );
+    frame_.resize( widthsAt + blocks );
+    if ( keyframe )
+    {
+        const char* data = reinterpret_cast< const char* >( bases.data( ) );
+        frame_.insert( frame_.end( ), data, data + blocks * sizeof( int32_t ) );
+    }
+    uint64_t words[ 33 ];
+    for ( size_t b = 0; b < blocks; b++ )
+    {
+        const uint32_t* block = residuals_.data( ) + b * blockSize;
+        uint32_t bits = 0;
+        for ( size_t i = 0; i < blockSize; i++ )
+        {
+            bits |= block[ i ];
+        }
+        uint32_t width = 0;
+        while ( width < 32 && ( bits >> width ) != 0 )
+        {
+            width++;
+        }
+        frame_[ widthsAt + b ] = char( width );
+        if ( width == 0 )
+        {
+            continue;
+        }
+        std::fill( words, words + width + 1, 0 );
+        for ( size_t i = 0; i < blockSize; i++ )
+        {
+            size_t bit = i * width;
+            uint32_t shift = uint32_t( bit & 63 );
+            words[ bit >> 6 ] |= uint64_t( block[ i ] ) << shift;
+            if ( shift + width > 64 )
+            {
+                words[ ( bit >> 6 ) + 1 ] |= uint64_t( block[ i ] ) >> ( 64 - shift );
+            }
+        }
+        const char* data = reinterpret_cast< const char* >( words );
+        frame_.insert( frame_.end( ), data, data + 8 * width );
+    }
+    // residuals past the last triangle stay zero in the final block
+}
+
+void CompressedDatasetWriter::append( const void* data, size_t size ){
+    if ( file_ )
+    {
+        if ( size > 0 && std::fwrite( data, size, 1, file_ ) != 1 )
+        {
+            throw std::runtime_error( "Error, failed to write timestep " + std::to_string( timeSteps( ) ) );
+        }
+    }
+    else
+    {
+        const char* bytes = static_cast< const char* >( data );
+        memory_.insert( memory_.end( ), bytes, bytes + size );
+    }
+    offset_ += size;
+}
+
+void CompressedDatasetWriter::pad( ){
+    const char zeros[ 8 ] = { };
+    append( zeros, ( 8 - offset_ % 8 ) % 8 );
+}
+
+void CompressedDatasetWriter::close( ){
+
+    if ( closed_ )
+    {
+        return;
+    }
+    CompressedDatasetHeader header{ };
+    std::memcpy( header.magic_, compressedDatasetMagic, sizeof( compressedDatasetMagic ) );
+    header.version_ = compressedDatasetVersion;
+    header.flags_ = temperature_ ? binaryFlagTemperature : 0;
+    header.numberOfTriangles_ = numberOfTriangles_;
+    header.timeSteps_ = entries_.size( );
+    header.indexOffset_ = offset_;
+    header.keyframeInterval_ = uint32_t( settings_.keyframeInterval_ );
+    header.shadowStep_ = settings_.shadowStep_;
+    header.temperatureStep_ = settings_.temperatureStep_;
+    append( entries_.data( ), entries_.size( ) * sizeof( CompressedFrameEntry ) );
+
+    if ( file_ )
+    {
+        std::fseek( file_, 0, SEEK_SET );
+        std::fwrite( &header, sizeof( header ), 1, file_ );
+        std::fclose( file_ );
+        file_ = nullptr;
+    }
+    else
+    {
+        std::memcpy( memory_.data( ), &header, sizeof( header ) );
+    }
+    closed_ = true;
+}
+
+std::vector< char > CompressedDatasetWriter::release( ){
+    close( );
+    return std::move( memory_ );
+}
+
+//
+// DATASET
+//
+bool CompressedDataset::isCompressedDataset( const std::string& path ){
+    std::ifstream file( path, std::ios::binary );
+    char magic[ sizeof( compressedDatasetMagic ) ];
+    if ( !file.read( magic, sizeof( magic ) ) )
+    {
+        return false;
+    }
+    return std::memcmp( magic, compressedDatasetMagic, sizeof( magic ) ) == 0;
+}
+
+CompressedDataset::CompressedDataset( const std::string& path ) : file_( path ) {
+    data_ = file_.data( );
+    size_ = file_.size( );
+    open( path );
+}
+
+CompressedDataset::CompressedDataset( std::vector< char > memory ) : memory_( std::move( memory ) ) {
+    data_ = memory_.data( );
+    size_ = memory_.size( );
+    open( "compressed dataset" );
+}
+
+void CompressedDataset::open( const std::string& name ){
+
+    if ( size_ < sizeof( CompressedDatasetHeader ) )
+    {
+        throw std::runtime_error( "Error, " + name + " is too small to be a compressed dataset!" );
+    }
+    std::memcpy( &header_, data_, sizeof( CompressedDatasetHeader ) );
+    if ( std::memcmp( header_.magic_, compressedDatasetMagic, sizeof( compressedDatasetMagic ) ) != 0 )
+    {
+        throw std::runtime_error( "Error, " + name + " is not a compressed dataset!" );
+    }
+    if ( header_.version_ != compressedDatasetVersion )
+    {
+        throw std::runtime_error( "Error, unsupported compressed dataset version " + std::to_string( header_.version_ ) );
+    }
+    if ( header_.keyframeInterval_ == 0 || header_.indexOffset_ % 8 != 0 ||
+         header_.indexOffset_ + header_.timeSteps_ * sizeof( CompressedFrameEntry ) > size_ )
+    {
+        throw std::runtime_error( "Error, compressed dataset " + name + " is truncated or corrupt!" );
+    }
+    entries_ = reinterpret_cast< const CompressedFrameEntry* >( data_ + header_.indexOffset_ );
+    uint64_t positionsSize = 9 * header_.numberOfTriangles_ * sizeof( float );
+    for ( uint64_t i = 0; i < header_.timeSteps_; i++ )
+    {
+        if ( entries_[ i ].frameOffset_ > header_.indexOffset_ || entries_[ i ].positionsOffset_ % 8 != 0 ||
+             entries_[ i ].positionsOffset_ + positionsSize > header_.indexOffset_ )
+        {
+            throw std::runtime_error( "Error, compressed dataset " + name + " is truncated or corrupt!" );
+        }
+    }
+    // the decoders trust the widths, so every section is checked once here
+    for ( uint64_t i = 0; i < header_.timeSteps_; i++ )
+    {
+        bool keyframe = i % header_.keyframeInterval_ == 0;
+        const char* section = data_ + entries_[ i ].frameOffset_;
+        size_t available = size_t( header_.indexOffset_ - entries_[ i ].frameOffset_ );
+        size_t size = 0;
+        bool valid = checkSection( section, available, header_.numberOfTriangles_, keyframe, size );
+        if ( valid && hasTemperature( ) )
+        {
+            valid = checkSection( section + size, available - size, header_.numberOfTriangles_, keyframe, size );
+        }
+        if ( !valid )
+        {
+            throw std::runtime_error( "Error, compressed dataset " + name + " is truncated or corrupt!" );
+        }
+    }
+    id_ = nextDatasetId++;
+}
+
+TimestepView CompressedDataset::timestep( int index ) const {
+    TimestepView view;
+    view.numberOfTriangles_ = numberOfTriangles( );
+    view.header_ = entries_[ index ].header_;
+    view.shadow_ = nullptr;
+    view.temperature_ = nullptr;
+    view.positions_ = reinterpret_cast< const float* >( data_ + entries_[ index ].positionsOffset_ );
+    return view;
+}
+
+void CompressedDataset::decode( int index, float* shadow, float* temperature ) const {
+
+    size_t count = header_.numberOfTriangles_;
+    int keyframe = index - index % keyframeInterval( );
+    if ( cursor.dataset_ != id_ || cursor.step_ < keyframe || cursor.step_ > index )
+    {
+        cursor.dataset_ = id_;
+        cursor.step_ = keyframe - 1;
+        cursor.shadow_.resize( count );
+        cursor.temperature_.resize( hasTemperature( ) ? count : 0 );
+    }
+    for ( int step = cursor.step_ + 1; step <= index; step++ )
+    {
+        const char* section = data_ + entries_[ step ].frameOffset_;
+        section = decodeSection( section, count, step == keyframe, cursor.shadow_.data( ) );
+        if ( hasTemperature( ) )
+        {
+            decodeSection( section, count, step == keyframe, cursor.temperature_.data( ) );
+        }
+        cursor.step_ = step;
+    }
+
+    for ( size_t i = 0; shadow && i < count; i++ )
+    {
+        shadow[ i ] = float( cursor.shadow_[ i ] ) * header_.shadowStep_;
+    }
+    if ( temperature )
+    {
+        for ( size_t i = 0; i < count; i++ )
+        {
+            temperature[ i ] = hasTemperature( ) ? float( cursor.temperature_[ i ] ) * header_.temperatureStep_ : 0.0f;
+        }
+    }
+}
+
+void CompressedDataset::decodeTriangle( int index, int triangle, float& shadow, float& temperature ) const {
+
+    size_t count = header_.numberOfTriangles_;
+    int keyframe = index - index % keyframeInterval( );
+    int32_t shadowValue = 0;
+    int32_t temperatureValue = 0;
+    for ( int step = keyframe; step <= index; step++ )
+    {
+        const char* section = data_ + entries_[ step ].frameOffset_;
+        decodeSectionValue( section, count, step == keyframe, size_t( triangle ), shadowValue );
+        if ( hasTemperature( ) )
+        {
+            section += sectionSize( reinterpret_cast< const uint8_t* >( section ), count, step == keyframe );
+            decodeSectionValue( section, count, step == keyframe, size_t( triangle ), temperatureValue );
+        }
+    }
+    shadow = float( shadowValue ) * header_.shadowStep_;
+    temperature = float( temperatureValue ) * header_.temperatureStep_;
+}
+
+uint64_t CompressedDataset::uncompressedSize( ) const {
+    return sizeof( BinaryDatasetHeader ) + header_.timeSteps_ * binaryRecordSize( header_.numberOfTriangles_, header_.flags_ );
+}
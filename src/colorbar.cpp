@@ -0,0 +1,95 @@
+#include "colorbar.h"
+
+void Colorbar::draw( ImDrawList* drawList, VisualizationMode mode, float width, float height,
+    const ValueRange& temperatureRange, GLuint colormap ) const {
+
+    const Layout& layout = layout_;
+    if ( !layout.valid_ || layout.x_ != x_ || layout.y_ != y_ || layout.size_ != size_ ||
+         layout.fontSize_ != fontSize_ || layout.vertical_ != vertical_ || layout.mode_ != mode ||
+         layout.width_ != width || layout.height_ != height ||
+         ( mode == VisualizationMode::TEMPERATURE && ( layout.range_.min_ != temperatureRange.min_ ||
+                                                      layout.range_.max_ != temperatureRange.max_ ) ) )
+    {
+        updateLayout( mode, width, height, temperatureRange );
+    }
+
+    const ImU32 black = IM_COL32(0, 0, 0, 255);
+    drawList->AddImageQuad((ImTextureID)(intptr_t)colormap,
+        layout.corners_[0], layout.corners_[1], layout.corners_[2], layout.corners_[3],
+        layout.uvs_[0], layout.uvs_[1], layout.uvs_[2], layout.uvs_[3]);
+
+    // Border
+    drawList->AddRect(layout.corners_[0], layout.corners_[2], black, 0.0f, 0, 1.5f);
+
+    // Labels
+    for (int i = 0; i < numberOfLabels; i++) {
+        drawList->AddLine(layout.ticks_[2*i], layout.ticks_[2*i + 1], black, 1.5f);
+        drawList->AddText(ImGui::GetFont(), fontSize_, layout.labelPositions_[i], black, layout.labels_[i].data());
+    }
+
+    // Title above colorbar
+    drawList->AddText(ImGui::GetFont(), fontSize_, layout.titlePosition_, black, layout.title_);
+}
+
+void Colorbar::updateLayout( VisualizationMode mode, float width, float height, const ValueRange& temperatureRange ) const {
+
+    Layout& layout = layout_;
+    layout.valid_ = true;
+    layout.x_ = x_;
+    layout.y_ = y_;
+    layout.size_ = size_;
+    layout.fontSize_ = fontSize_;
+    layout.vertical_ = vertical_;
+    layout.mode_ = mode;
+    layout.width_ = width;
+    layout.height_ = height;
+    layout.range_ = temperatureRange;
+
+    float maxValue = 1.0f;
+    float minValue = 0.0f;
+    layout.title_ = "f [-]";
+    if ( mode == VisualizationMode::TEMPERATURE ){
+        maxValue = temperatureRange.max_;
+        minValue = temperatureRange.min_;
+        layout.title_ = "T [K]";
+    }
+
+    float barWidth = ( vertical_ ? 25.0f : 200.0f ) * size_;
+    float barHeight = ( vertical_ ? 200.0f : 25.0f ) * size_;
+    float x = x_ * width;
+    float y = y_ * height;
+    layout.corners_ = { ImVec2(x, y), ImVec2(x + barWidth, y), ImVec2(x + barWidth, y + barHeight), ImVec2(x, y + barHeight) };
+
+    // the ends of the bar sample the centers of the first and last texel, like the mesh shader
+    float low = 0.5f / ColormapLibrary::textureSize;
+    float high = 1.0f - low;
+    if ( vertical_ ){
+        layout.uvs_ = { ImVec2(high, 0.5f), ImVec2(high, 0.5f), ImVec2(low, 0.5f), ImVec2(low, 0.5f) };
+    }
+    else{
+        layout.uvs_ = { ImVec2(low, 0.5f), ImVec2(high, 0.5f), ImVec2(high, 0.5f), ImVec2(low, 0.5f) };
+    }
+
+    for (int i = 0; i < numberOfLabels; i++) {
+        float t = (float)i / ( numberOfLabels - 1 );
+        float value;
+        if ( vertical_ ){
+            value = maxValue - t * (maxValue - minValue);
+            float yPos = y + t * barHeight;
+            layout.ticks_[2*i] = ImVec2(x + barWidth, yPos);
+            layout.ticks_[2*i + 1] = ImVec2(x + barWidth + 5, yPos);
+            layout.labelPositions_[i] = ImVec2(x + barWidth + 8, yPos - 7);
+        }
+        else{
+            value = minValue + t * (maxValue - minValue);
+            float xPos = x + t * barWidth;
+            layout.ticks_[2*i] = ImVec2(xPos, y + barHeight);
+            layout.ticks_[2*i + 1] = ImVec2(xPos, y + barHeight + 5);
+            layout.labelPositions_[i] = ImVec2(xPos - 7, y + barHeight + 8);
+        }
+        snprintf(layout.labels_[i].data(), layout.labels_[i].size(), "%.1f", value);
+    }
+
+    ImVec2 textSize = ImGui::CalcTextSize(layout.title_);
+    layout.titlePosition_ = ImVec2(x + (barWidth - textSize.x) / 2.0f, y - ( vertical_ ? 20.0f : 25.0f ));
+}
@@ -0,0 +1,154 @@
+#include "colormap.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+Colormap fromHex( const std::string& name, std::initializer_list< unsigned int > colors ){
+    Colormap colormap;
+    colormap.name_ = name;
+    for ( unsigned int color : colors )
+    {
+        colormap.colors_.push_back( glm::vec3( float( ( color >> 16 ) & 0xFF ), float( ( color >> 8 ) & 0xFF ),
+            float( color & 0xFF ) ) / 255.0f );
+    }
+    return colormap;
+}
+
+} // namespace
+
+glm::vec3 Colormap::sample( float t ) const {
+    if ( colors_.empty( ) )
+    {
+        return glm::vec3( 0.0f );
+    }
+    float position = std::clamp( t, 0.0f, 1.0f ) * float( colors_.size( ) - 1 );
+    size_t lower = std::min( size_t( position ), colors_.size( ) - 1 );
+    size_t upper = std::min( lower + 1, colors_.size( ) - 1 );
+    return glm::mix( colors_[ lower ], colors_[ upper ], position - float( lower ) );
+}
+
+Colormap Colormap::load( const std::string& path ){
+
+    std::ifstream file( path );
+    if ( !file )
+    {
+        throw std::runtime_error( "Error, colormap " + path + " does not exist!" );
+    }
+    Colormap colormap;
+    colormap.name_ = std::filesystem::path( path ).stem( ).string( );
+    std::string line;
+    float largest = 0.0f;
+    while ( std::getline( file, line ) )
+    {
+        std::istringstream values( line );
+        glm::vec3 color;
+        // empty and comment lines do not start with a number
+        if ( !( values >> color.x ) )
+        {
+            continue;
+        }
+        if ( !( values >> color.y >> color.z ) )
+        {
+            throw std::runtime_error( "Error, colormap " + path + " has a line without three values: " + line );
+        }
+        largest = std::max( { largest, color.x, color.y, color.z } );
+        colormap.colors_.push_back( color );
+    }
+    if ( colormap.colors_.size( ) < 2 )
+    {
+        throw std::runtime_error( "Error, colormap " + path + " needs at least two colors!" );
+    }
+    // 8 bit colors
+    if ( largest > 1.0f )
+    {
+        for ( glm::vec3& color : colormap.colors_ )
+        {
+            color /= 255.0f;
+        }
+    }
+    return colormap;
+}
+
+const std::vector< Colormap >& builtinColormaps( ){
+    // the perceptual maps are sampled at 10 (coolwarm 9) points, which the
+    // linear interpolation reproduces within a few 8 bit steps
+    static const std::vector< Colormap > colormaps = {
+        fromHex( "white-red", { 0xFFFFFF, 0xFF0000 } ),
+        fromHex( "blue-red", { 0x0000FF, 0xFF0000 } ),
+        fromHex( "viridis", { 0x440154, 0x482878, 0x3E4A89, 0x31688E, 0x26828E,
+                              0x1F9E89, 0x35B779, 0x6DCD59, 0xB4DE2C, 0xFDE725 } ),
+        fromHex( "inferno", { 0x000004, 0x1B0C42, 0x4B0C6B, 0x781C6D, 0xA52C60,
+                              0xCF4446, 0xED6925, 0xFB9A06, 0xF7D03C, 0xFCFFA4 } ),
+        fromHex( "coolwarm", { 0x3B4CC0, 0x6282EA, 0x8DB0FE, 0xB8D0F9, 0xDDDDDD,
+                               0xF5C4AD, 0xF49A7B, 0xDE604D, 0xB40426 } ),
+    };
+    return colormaps;
+}
+
+void ColormapLibrary::init( ){
+    for ( const Colormap& colormap : builtinColormaps( ) )
+    {
+        add( colormap );
+    }
+}
+
+void ColormapLibrary::release( ){
+    if ( !textures_.empty( ) )
+    {
+        glDeleteTextures(GLsizei(textures_.size()), textures_.data());
+    }
+    textures_.clear( );
+    colormaps_.clear( );
+}
+
+int ColormapLibrary::add( const Colormap& colormap ){
+
+    std::vector< unsigned char > texels( 4 * textureSize );
+    for ( int i = 0; i < textureSize; i++ )
+    {
+        glm::vec3 color = colormap.sample( float( i ) / float( textureSize - 1 ) );
+        for ( int c = 0; c < 3; c++ )
+        {
+            texels[ 4*i + c ] = (unsigned char)( std::clamp( color[ c ], 0.0f, 1.0f ) * 255.0f + 0.5f );
+        }
+        texels[ 4*i + 3 ] = 255;
+    }
+
+    int index = find( colormap.name_ );
+    if ( index < 0 )
+    {
+        GLuint texture;
+        glGenTextures(1, &texture);
+        colormaps_.push_back( colormap );
+        textures_.push_back( texture );
+        index = size( ) - 1;
+    }
+    else
+    {
+        colormaps_[ index ] = colormap;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, textures_[ index ]);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, textureSize, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return index;
+}
+
+int ColormapLibrary::load( const std::string& path ){
+    return add( Colormap::load( path ) );
+}
+
+int ColormapLibrary::find( const std::string& name ) const {
+    auto found = std::find_if( colormaps_.begin( ), colormaps_.end( ),
+        [&]( const Colormap& colormap ){ return colormap.name_ == name; } );
+    return found != colormaps_.end( ) ? int( found - colormaps_.begin( ) ) : -1;
+}
@@ -0,0 +1,188 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+
+#include "codec.h"
+#include "dataset.h"
+
+// scrt-convert: turns a text mesh.txt into a memory mappable .scrt dataset
+//
+//   scrt-convert mesh.txt mesh.scrt [--temperature temperature.txt]
+//   scrt-convert mesh.txt|mesh.scrt mesh.scrtz --compress [--temperature temperature.txt]
+//                [--shadow-step 0.000244] [--temperature-step 0.01] [--keyframe-interval 16]
+//
+// The text file is streamed one timestep at a time, so the conversion never
+// holds more than a single line in memory. Temperatures, if given, are read
+// line by line alongside and stored in every record. With --compress the
+// attributes are stored as quantized differences between timesteps (see codec.h),
+// a .scrt dataset can be compressed as well.
+
+namespace {
+
+// size against the same timesteps as .scrt records, and the largest quantization error
+void reportCompression( const std::string& path, const CodecSettings& settings, std::chrono::steady_clock::time_point start ){
+    CompressedDataset dataset( path );
+    double seconds = std::chrono::duration< double >( std::chrono::steady_clock::now( ) - start ).count( );
+    std::cout << "compressed " << dataset.timeSteps( ) << " timesteps" << ( dataset.hasTemperature( ) ? " with temperatures" : "" )
+              << " to " << path << " in " << seconds << " s: " << dataset.size( ) / ( 1024.0 * 1024.0 ) << " MB, "
+              << double( dataset.uncompressedSize( ) ) / double( dataset.size( ) ) << "x smaller than .scrt; shadow within "
+              << 0.5f * settings.shadowStep_ << ", temperature within " << 0.5f * settings.temperatureStep_ << " K" << std::endl;
+}
+
+} // namespace
+
+int main( int argc, char** argv )
+{
+    std::vector< std::string > paths;
+    std::string pathToTemperature;
+    bool compress = false;
+    CodecSettings settings;
+    for ( int i = 1; i < argc; i++ )
+    {
+        std::string argument = argv[ i ];
+        if ( argument == "--temperature" && i + 1 < argc )
+        {
+            pathToTemperature = argv[ ++i ];
+        }
+        else if ( argument == "--compress" )
+        {
+            compress = true;
+        }
+        else if ( argument == "--shadow-step" && i + 1 < argc )
+        {
+            settings.shadowStep_ = std::stof( argv[ ++i ] );
+        }
+        else if ( argument == "--temperature-step" && i + 1 < argc )
+        {
+            settings.temperatureStep_ = std::stof( argv[ ++i ] );
+        }
+        else if ( argument == "--keyframe-interval" && i + 1 < argc )
+        {
+            settings.keyframeInterval_ = std::stoi( argv[ ++i ] );
+        }
+        else
+        {
+            paths.push_back( argument );
+        }
+    }
+    if ( paths.size( ) != 2 )
+    {
+        std::cerr << "usage: " << argv[ 0 ] << " <mesh.txt> <output.scrt> [--temperature <temperature.txt>]\n"
+                  << "       " << argv[ 0 ] << " <mesh.txt|mesh.scrt> <output.scrtz> --compress [--temperature <temperature.txt>]"
+                  << " [--shadow-step s] [--temperature-step s] [--keyframe-interval n]" << std::endl;
+        return 1;
+    }
+    std::string pathToText = paths[ 0 ];
+    std::string pathToBinary = paths[ 1 ];
+
+    try
+    {
+        auto start = std::chrono::steady_clock::now( );
+
+        if ( compress && BinaryDataset::isBinaryDataset( pathToText ) )
+        {
+            if ( !pathToTemperature.empty( ) )
+            {
+                throw std::runtime_error( "Error, a binary dataset already stores its temperatures, convert it from text again" );
+            }
+            BinaryDataset dataset( pathToText );
+            dataset.file( ).adviseSequential( );
+            CompressedDatasetWriter writer( pathToBinary, dataset.numberOfTriangles( ), dataset.hasTemperature( ), settings );
+            for ( int i = 0; i < dataset.timeSteps( ); i++ )
+            {
+                writer.write( dataset.timestep( i ) );
+            }
+            writer.close( );
+            reportCompression( pathToBinary, settings, start );
+            return 0;
+        }
+
+        std::ifstream file( pathToText );
+        if ( !file )
+        {
+            throw std::runtime_error( "Error, path to mesh does not exist!" );
+        }
+        std::ifstream temperatureFile;
+        if ( !pathToTemperature.empty( ) )
+        {
+            temperatureFile.open( pathToTemperature );
+            if ( !temperatureFile )
+            {
+                throw std::runtime_error( "Error, path to temperatures does not exist!" );
+            }
+        }
+
+        std::string line;
+        std::vector< double > values;
+        std::vector< double > temperature;
+        std::unique_ptr< BinaryDatasetWriter > writer;
+        std::unique_ptr< CompressedDatasetWriter > compressedWriter;
+        while ( std::getline( file, line ) )
+        {
+            if ( !parseTextRow( line, values ) )
+            {
+                continue;
+            }
+            if ( !writer && !compressedWriter )
+            {
+                int numberOfTriangles = int( ( values.size( ) - timestepHeaderSize ) / 10 );
+                if ( compress )
+                {
+                    compressedWriter = std::make_unique< CompressedDatasetWriter >( pathToBinary, numberOfTriangles,
+                        temperatureFile.is_open( ), settings );
+                }
+                else
+                {
+                    writer = std::make_unique< BinaryDatasetWriter >( pathToBinary, numberOfTriangles, temperatureFile.is_open( ) );
+                }
+            }
+            if ( temperatureFile.is_open( ) )
+            {
+                // the next non-empty line belongs to this timestep
+                temperature.clear( );
+                while ( temperature.empty( ) && std::getline( temperatureFile, line ) )
+                {
+                    parseTextRow( line, temperature );
+                }
+                if ( temperature.empty( ) )
+                {
+                    throw std::runtime_error( "Error, " + pathToTemperature + " has fewer lines than " + pathToText );
+                }
+            }
+            if ( compressedWriter )
+            {
+                compressedWriter->write( values, temperatureFile.is_open( ) ? &temperature : nullptr );
+            }
+            else
+            {
+                writer->write( values, temperatureFile.is_open( ) ? &temperature : nullptr );
+            }
+        }
+        if ( !writer && !compressedWriter )
+        {
+            throw std::runtime_error( "Error, " + pathToText + " does not contain any timestep!" );
+        }
+        if ( compressedWriter )
+        {
+            compressedWriter->close( );
+            reportCompression( pathToBinary, settings, start );
+            return 0;
+        }
+        int timeSteps = writer->timeSteps( );
+        writer->close( );
+
+        double seconds = std::chrono::duration< double >( std::chrono::steady_clock::now( ) - start ).count( );
+        std::cout << "converted " << timeSteps << " timesteps" << ( temperatureFile.is_open( ) ? " with temperatures" : "" )
+                  << " to " << pathToBinary
+                  << " in " << seconds << " s" << std::endl;
+    }
+    catch ( const std::exception& error )
+    {
+        std::cerr << error.what( ) << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
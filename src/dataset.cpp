@@ -0,0 +1,387 @@
+#include "dataset.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#include "parallel.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+uint64_t binaryRecordSize( uint64_t numberOfTriangles, uint32_t flags ){
+    uint64_t floatsPerTriangle = flags & binaryFlagTemperature ? 11 : 10;
+    uint64_t size = timestepHeaderSize * sizeof( double ) + floatsPerTriangle * numberOfTriangles * sizeof( float );
+    return ( size + 7 ) & ~uint64_t( 7 );
+}
+
+//
+// MAPPED FILE
+//
+MappedFile::MappedFile( const std::string& path ){
+
+    int fd = ::open( path.c_str( ), O_RDONLY );
+    if ( fd < 0 )
+    {
+        throw std::runtime_error( "Error, failed to open " + path );
+    }
+    struct stat info;
+    if ( ::fstat( fd, &info ) != 0 )
+    {
+        ::close( fd );
+        throw std::runtime_error( "Error, failed to stat " + path );
+    }
+    size_ = size_t( info.st_size );
+    if ( size_ > 0 )
+    {
+        void* mapping = ::mmap( nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0 );
+        if ( mapping == MAP_FAILED )
+        {
+            ::close( fd );
+            throw std::runtime_error( "Error, failed to map " + path );
+        }
+        data_ = static_cast< char* >( mapping );
+    }
+    // the mapping stays valid after the descriptor is closed
+    ::close( fd );
+}
+
+MappedFile::~MappedFile( ){
+    release( );
+}
+
+MappedFile::MappedFile( MappedFile&& other ) noexcept :
+    data_( other.data_ ),
+    size_( other.size_ ) {
+    other.data_ = nullptr;
+    other.size_ = 0;
+}
+
+MappedFile& MappedFile::operator=( MappedFile&& other ) noexcept {
+    if ( this != &other )
+    {
+        release( );
+        data_ = other.data_;
+        size_ = other.size_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+    }
+    return *this;
+}
+
+void MappedFile::adviseSequential( ) const {
+    if ( data_ )
+    {
+        ::madvise( data_, size_, MADV_SEQUENTIAL );
+    }
+}
+
+void MappedFile::release( ){
+    if ( data_ )
+    {
+        ::munmap( data_, size_ );
+    }
+    data_ = nullptr;
+    size_ = 0;
+}
+
+//
+// BINARY DATASET
+//
+bool BinaryDataset::isBinaryDataset( const std::string& path ){
+    std::ifstream file( path, std::ios::binary );
+    char magic[ sizeof( binaryDatasetMagic ) ];
+    if ( !file.read( magic, sizeof( magic ) ) )
+    {
+        return false;
+    }
+    return std::memcmp( magic, binaryDatasetMagic, sizeof( magic ) ) == 0;
+}
+
+BinaryDataset::BinaryDataset( const std::string& path ) : file_( path ) {
+
+    if ( file_.size( ) < sizeof( BinaryDatasetHeader ) )
+    {
+        throw std::runtime_error( "Error, " + path + " is too small to be a binary dataset!" );
+    }
+    std::memcpy( &header_, file_.data( ), sizeof( BinaryDatasetHeader ) );
+
+    if ( std::memcmp( header_.magic_, binaryDatasetMagic, sizeof( binaryDatasetMagic ) ) != 0 )
+    {
+        throw std::runtime_error( "Error, " + path + " is not a binary dataset!" );
+    }
+    if ( header_.version_ < 1 || header_.version_ > binaryDatasetVersion )
+    {
+        throw std::runtime_error( "Error, unsupported binary dataset version " + std::to_string( header_.version_ ) );
+    }
+    if ( header_.version_ < 2 )
+    {
+        header_.flags_ = 0;
+    }
+    // records hold doubles, so they start 8 byte aligned behind at least the header
+    if ( header_.headerSize_ < sizeof( BinaryDatasetHeader ) || header_.headerSize_ % 8 != 0 ||
+         header_.headerSize_ > file_.size( ) )
+    {
+        throw std::runtime_error( "Error, binary dataset " + path + " has an invalid header size!" );
+    }
+    if ( header_.recordSize_ != binaryRecordSize( header_.numberOfTriangles_, header_.flags_ ) ||
+         header_.timeSteps_ > ( file_.size( ) - header_.headerSize_ ) / header_.recordSize_ )
+    {
+        throw std::runtime_error( "Error, binary dataset " + path + " is truncated or corrupt!" );
+    }
+}
+
+TimestepView BinaryDataset::timestep( int index ) const {
+
+    const char* record = file_.data( ) + header_.headerSize_ + uint64_t( index ) * header_.recordSize_;
+    TimestepView view;
+    view.numberOfTriangles_ = int( header_.numberOfTriangles_ );
+    view.header_ = reinterpret_cast< const double* >( record );
+    view.shadow_ = reinterpret_cast< const float* >( record + timestepHeaderSize * sizeof( double ) );
+    view.temperature_ = hasTemperature( ) ? view.shadow_ + header_.numberOfTriangles_ : nullptr;
+    view.positions_ = view.shadow_ + ( hasTemperature( ) ? 2 : 1 ) * header_.numberOfTriangles_;
+    return view;
+}
+
+//
+// BINARY DATASET WRITER
+//
+BinaryDatasetWriter::BinaryDatasetWriter( const std::string& path, int numberOfTriangles, bool temperature ) :
+    numberOfTriangles_( uint64_t( numberOfTriangles ) ),
+    temperature_( temperature ),
+    record_( binaryRecordSize( uint64_t( numberOfTriangles ), temperature ? binaryFlagTemperature : 0 ), 0 ) {
+
+    file_ = std::fopen( path.c_str( ), "wb" );
+    if ( !file_ )
+    {
+        throw std::runtime_error( "Error, failed to create " + path );
+    }
+
+    // timestep count is patched in close( )
+    BinaryDatasetHeader header{ };
+    std::memcpy( header.magic_, binaryDatasetMagic, sizeof( binaryDatasetMagic ) );
+    header.version_ = binaryDatasetVersion;
+    header.flags_ = temperature_ ? binaryFlagTemperature : 0;
+    header.numberOfTriangles_ = numberOfTriangles_;
+    header.headerSize_ = sizeof( BinaryDatasetHeader );
+    header.recordSize_ = record_.size( );
+    if ( std::fwrite( &header, sizeof( header ), 1, file_ ) != 1 )
+    {
+        std::fclose( file_ );
+        file_ = nullptr;
+        throw std::runtime_error( "Error, failed to write the header of " + path );
+    }
+}
+
+BinaryDatasetWriter::~BinaryDatasetWriter( ){
+    if ( !file_ )
+    {
+        return;
+    }
+    // after a failed write the header keeps zero timesteps, the file reads as empty
+    if ( failed_ )
+    {
+        std::fclose( file_ );
+        return;
+    }
+    try
+    {
+        close( );
+    }
+    catch ( const std::exception& )
+    {
+    }
+}
+
+void BinaryDatasetWriter::write( const std::vector< double >& row, const std::vector< double >* temperature ){
+
+    if ( row.size( ) != timestepHeaderSize + 10 * numberOfTriangles_ )
+    {
+        throw std::runtime_error( "Error, timestep " + std::to_string( timeSteps_ ) + " has an inconsistent number of values!" );
+    }
+    if ( temperature_ != ( temperature != nullptr ) )
+    {
+        throw std::runtime_error( "Error, timestep " + std::to_string( timeSteps_ ) + " has no temperatures!" );
+    }
+
+    auto toFloat = []( double value ){ return float( value ); };
+    double* header = reinterpret_cast< double* >( record_.data( ) );
+    float* values = reinterpret_cast< float* >( record_.data( ) + timestepHeaderSize * sizeof( double ) );
+    std::copy( row.begin( ), row.begin( ) + timestepHeaderSize, header );
+    auto positions = row.begin( ) + timestepHeaderSize + numberOfTriangles_;
+    values = std::transform( row.begin( ) + timestepHeaderSize, positions, values, toFloat );
+    if ( temperature )
+    {
+        checkTemperatureRow( *temperature, row[ 0 ], int( numberOfTriangles_ ), int( timeSteps_ ) );
+        values = std::transform( temperature->begin( ) + 1, temperature->end( ), values, toFloat );
+    }
+    std::transform( positions, row.end( ), values, toFloat );
+
+    if ( std::fwrite( record_.data( ), record_.size( ), 1, file_ ) != 1 )
+    {
+        failed_ = true;
+        throw std::runtime_error( "Error, failed to write timestep " + std::to_string( timeSteps_ ) );
+    }
+    timeSteps_++;
+}
+
+void BinaryDatasetWriter::close( ){
+
+    if ( failed_ )
+    {
+        throw std::runtime_error( "Error, the dataset is incomplete after a failed write!" );
+    }
+    bool written = std::fseek( file_, offsetof( BinaryDatasetHeader, timeSteps_ ), SEEK_SET ) == 0 &&
+                   std::fwrite( &timeSteps_, sizeof( timeSteps_ ), 1, file_ ) == 1;
+    // fclose flushes the buffered records, which can fail as well
+    written = std::fclose( file_ ) == 0 && written;
+    file_ = nullptr;
+    if ( !written )
+    {
+        throw std::runtime_error( "Error, failed to finish the dataset header" );
+    }
+}
+
+//
+// TEXT FORMAT
+//
+namespace {
+
+// anything but the newline separates values on a line
+inline bool isBlank( char c ){
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// parses the values of the line starting at cursor and leaves cursor behind its newline
+void parseLine( const char*& cursor, const char* end, std::vector< double >& values ){
+
+    while ( cursor < end )
+    {
+        char c = *cursor;
+        if ( c == '\n' )
+        {
+            ++cursor;
+            return;
+        }
+        if ( isBlank( c ) )
+        {
+            ++cursor;
+            continue;
+        }
+        // from_chars does not accept an explicit plus sign
+        if ( c == '+' )
+        {
+            ++cursor;
+        }
+
+        double value;
+        auto result = std::from_chars( cursor, end, value );
+        if ( result.ec == std::errc::result_out_of_range )
+        {
+            // let strtod decide between denormal, zero and infinity
+            value = std::strtod( std::string( cursor, result.ptr ).c_str( ), nullptr );
+        }
+        else if ( result.ec != std::errc( ) )
+        {
+            const char* tokenEnd = cursor;
+            while ( tokenEnd < end && tokenEnd - cursor < 32 && *tokenEnd != '\n' && !isBlank( *tokenEnd ) )
+            {
+                ++tokenEnd;
+            }
+            throw std::runtime_error( "Error, invalid value in mesh file: '" + std::string( cursor, tokenEnd ) + "'" );
+        }
+        values.push_back( value );
+        cursor = result.ptr;
+    }
+}
+
+} // namespace
+
+bool parseTextRow( const std::string& line, std::vector< double >& values ){
+    return parseTextRow( line.data( ), line.data( ) + line.size( ), values );
+}
+
+bool parseTextRow( const char* begin, const char* end, std::vector< double >& values ){
+    values.clear( );
+    parseLine( begin, end, values );
+    return !values.empty( );
+}
+
+std::vector< std::vector< double > > parseTextMesh( const char* begin, const char* end, int numberOfThreads ){
+
+    if ( numberOfThreads <= 0 )
+    {
+        numberOfThreads = hardwareThreads( );
+    }
+
+    // a few chunks per thread balance lines of uneven length, but chunks
+    // smaller than a page are not worth a task
+    const size_t minimumChunkSize = 1 << 16;
+    size_t size = size_t( end - begin );
+    int numberOfChunks = int( std::min< size_t >( size_t( numberOfThreads ) * 4, size / minimumChunkSize + 1 ) );
+
+    // chunk boundaries are moved forward to the next line start, so no line is split
+    std::vector< const char* > bounds( numberOfChunks + 1 );
+    bounds[ 0 ] = begin;
+    bounds[ numberOfChunks ] = end;
+    for ( int i = 1; i < numberOfChunks; i++ )
+    {
+        const char* boundary = std::max( begin + size * i / numberOfChunks, bounds[ i - 1 ] );
+        boundary = std::find( boundary, end, '\n' );
+        bounds[ i ] = boundary < end ? boundary + 1 : end;
+    }
+
+    std::vector< std::vector< std::vector< double > > > chunks( numberOfChunks );
+    parallelFor( numberOfChunks, [&]( int chunk ){
+        const char* cursor = bounds[ chunk ];
+        const char* chunkEnd = bounds[ chunk + 1 ];
+        size_t expectedSize = 0;
+        while ( cursor < chunkEnd )
+        {
+            // every line of a file has the same length, reserve from the previous one
+            std::vector< double > values;
+            values.reserve( expectedSize );
+            parseLine( cursor, chunkEnd, values );
+            if ( !values.empty( ) )
+            {
+                expectedSize = values.size( );
+                chunks[ chunk ].push_back( std::move( values ) );
+            }
+        }
+    }, numberOfThreads );
+
+    size_t numberOfRows = 0;
+    for ( const auto& rows : chunks )
+    {
+        numberOfRows += rows.size( );
+    }
+    std::vector< std::vector< double > > allData;
+    allData.reserve( numberOfRows );
+    for ( auto& rows : chunks )
+    {
+        std::move( rows.begin( ), rows.end( ), std::back_inserter( allData ) );
+    }
+    return allData;
+}
+
+void checkTemperatureRow( const std::vector< double >& row, double time, int numberOfTriangles, int step ){
+
+    if ( row.size( ) != size_t( numberOfTriangles ) + 1 )
+    {
+        throw std::runtime_error( "Error, temperature line of timestep " + std::to_string( step ) + " has " +
+            std::to_string( row.empty( ) ? 0 : row.size( ) - 1 ) + " values, expected " + std::to_string( numberOfTriangles ) );
+    }
+    // both files may be written with a different number of digits
+    if ( std::abs( row[ 0 ] - time ) > 1e-6 * std::max( std::abs( time ), 1.0 ) )
+    {
+        throw std::runtime_error( "Error, temperature line of timestep " + std::to_string( step ) +
+            " is at time " + std::to_string( row[ 0 ] ) + " instead of " + std::to_string( time ) );
+    }
+}
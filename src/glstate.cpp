@@ -0,0 +1,203 @@
+#include "glstate.h"
+
+#include <cstring>
+
+GLCounters& GLCounters::operator+=( const GLCounters& other ){
+    calls_ += other.calls_;
+    stateChanges_ += other.stateChanges_;
+    uniforms_ += other.uniforms_;
+    skipped_ += other.skipped_;
+    draws_ += other.draws_;
+    uploadedBytes_ += other.uploadedBytes_;
+    return *this;
+}
+
+bool GLStateCache::changed( GLuint& cached, GLuint value ){
+    if ( cached == value ){
+        frame_.skipped_++;
+        return false;
+    }
+    cached = value;
+    frame_.calls_++;
+    frame_.stateChanges_++;
+    return true;
+}
+
+void GLStateCache::useProgram( GLuint program ){
+    if ( changed( program_, program ) ){
+        glUseProgram(program);
+    }
+}
+
+void GLStateCache::bindVertexArray( GLuint vertexArray ){
+    if ( changed( vertexArray_, vertexArray ) ){
+        glBindVertexArray(vertexArray);
+    }
+}
+
+void GLStateCache::bindBuffer( GLenum target, GLuint buffer ){
+    // without a known vertex array the binding cannot be tracked
+    if ( target == GL_ELEMENT_ARRAY_BUFFER && vertexArray_ == unknown ){
+        frame_.calls_++;
+        frame_.stateChanges_++;
+        glBindBuffer(target, buffer);
+        return;
+    }
+    auto& cached = target == GL_ELEMENT_ARRAY_BUFFER ? elementBuffers_.try_emplace( vertexArray_, unknown ).first->second
+                                                     : buffers_.try_emplace( target, unknown ).first->second;
+    if ( changed( cached, buffer ) ){
+        glBindBuffer(target, buffer);
+    }
+}
+
+void GLStateCache::bindBufferBase( GLenum target, GLuint index, GLuint buffer ){
+    auto& cached = indexedBuffers_.try_emplace( uint64_t( target ) << 32 | index, unknown ).first->second;
+    if ( changed( cached, buffer ) ){
+        glBindBufferBase(target, index, buffer);
+        // binds the generic binding point as well
+        buffers_[ target ] = buffer;
+    }
+}
+
+void GLStateCache::activeTexture( int unit ){
+    if ( changed( activeUnit_, GLuint( unit ) ) ){
+        glActiveTexture(GL_TEXTURE0 + unit);
+    }
+}
+
+void GLStateCache::bindTexture( int unit, GLenum target, GLuint texture ){
+    auto& cached = textures_.try_emplace( uint64_t( unit ) << 32 | target, unknown ).first->second;
+    if ( cached == texture ){
+        frame_.skipped_++;
+        return;
+    }
+    activeTexture( unit );
+    changed( cached, texture );
+    glBindTexture(target, texture);
+}
+
+void GLStateCache::polygonMode( GLenum mode ){
+    if ( changed( polygonMode_, mode ) ){
+        glPolygonMode(GL_FRONT_AND_BACK, mode);
+    }
+}
+
+void GLStateCache::enable( GLenum capability, bool enabled ){
+    auto& cached = capabilities_.try_emplace( capability, unknown ).first->second;
+    if ( changed( cached, enabled ? 1 : 0 ) ){
+        if ( enabled ){
+            glEnable(capability);
+        }
+        else {
+            glDisable(capability);
+        }
+    }
+}
+
+void GLStateCache::polygonOffset( float factor, float units ){
+    if ( polygonOffsetKnown_ && polygonOffset_ == glm::vec2( factor, units ) ){
+        frame_.skipped_++;
+        return;
+    }
+    polygonOffsetKnown_ = true;
+    polygonOffset_ = glm::vec2( factor, units );
+    frame_.calls_++;
+    frame_.stateChanges_++;
+    glPolygonOffset(factor, units);
+}
+
+bool GLStateCache::changedUniform( GLint location, const void* value, size_t bytes ){
+    if ( location < 0 ){
+        return false;
+    }
+    // values of an unknown program cannot be compared
+    if ( program_ != unknown ){
+        std::vector< UniformValue >& values = uniforms_[ program_ ];
+        if ( size_t( location ) >= values.size( ) ){
+            values.resize( location + 1 );
+        }
+        UniformValue& cached = values[ location ];
+        std::array< uint32_t, 4 > bits{ };
+        std::memcpy( bits.data( ), value, bytes );
+        if ( cached.set_ && cached.bits_ == bits ){
+            frame_.skipped_++;
+            return false;
+        }
+        cached.bits_ = bits;
+        cached.set_ = true;
+    }
+    frame_.calls_++;
+    frame_.uniforms_++;
+    return true;
+}
+
+void GLStateCache::uniform( GLint location, int value ){
+    if ( changedUniform( location, &value, sizeof( value ) ) ){
+        glUniform1i(location, value);
+    }
+}
+
+void GLStateCache::uniform( GLint location, float value ){
+    if ( changedUniform( location, &value, sizeof( value ) ) ){
+        glUniform1f(location, value);
+    }
+}
+
+void GLStateCache::uniform( GLint location, const glm::vec2& value ){
+    if ( changedUniform( location, &value, sizeof( value ) ) ){
+        glUniform2f(location, value.x, value.y);
+    }
+}
+
+void GLStateCache::uniform( GLint location, const glm::vec3& value ){
+    if ( changedUniform( location, &value, sizeof( value ) ) ){
+        glUniform3f(location, value.x, value.y, value.z);
+    }
+}
+
+void GLStateCache::uniform( GLint location, const glm::vec4& value ){
+    if ( changedUniform( location, &value, sizeof( value ) ) ){
+        glUniform4f(location, value.x, value.y, value.z, value.w);
+    }
+}
+
+void GLStateCache::bufferData( GLenum target, size_t bytes, const void* data, GLenum usage ){
+    glBufferData(target, GLsizeiptr( bytes ), data, usage);
+    count( 1, data ? bytes : 0 );
+}
+
+void GLStateCache::bufferSubData( GLenum target, size_t offset, size_t bytes, const void* data ){
+    glBufferSubData(target, GLintptr( offset ), GLsizeiptr( bytes ), data);
+    count( 1, bytes );
+}
+
+void GLStateCache::drawElements( GLenum mode, GLsizei count ){
+    glDrawElements(mode, count, GL_UNSIGNED_INT, (void*)0);
+    frame_.calls_++;
+    frame_.draws_++;
+}
+
+void GLStateCache::invalidate( ){
+    program_ = unknown;
+    vertexArray_ = unknown;
+    activeUnit_ = unknown;
+    polygonMode_ = unknown;
+    polygonOffsetKnown_ = false;
+    buffers_.clear( );
+    elementBuffers_.clear( );
+    indexedBuffers_.clear( );
+    textures_.clear( );
+    capabilities_.clear( );
+}
+
+void GLStateCache::forgetProgram( GLuint program ){
+    uniforms_.erase( program );
+    if ( program_ == program ){
+        program_ = unknown;
+    }
+}
+
+void GLStateCache::endFrame( ){
+    lastFrame_ = frame_;
+    frame_ = GLCounters( );
+}
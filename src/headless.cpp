@@ -0,0 +1,132 @@
+#include "headless.h"
+
+#include <stdexcept>
+
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+namespace {
+
+EGLDisplay openDisplay( ){
+
+    // surfaceless works without X, Wayland or a DRM device
+    auto getPlatformDisplay = reinterpret_cast< PFNEGLGETPLATFORMDISPLAYEXTPROC >(
+        eglGetProcAddress( "eglGetPlatformDisplayEXT" ) );
+    if ( getPlatformDisplay )
+    {
+        EGLDisplay display = getPlatformDisplay( EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr );
+        if ( display != EGL_NO_DISPLAY && eglInitialize( display, nullptr, nullptr ) )
+        {
+            return display;
+        }
+    }
+    EGLDisplay display = eglGetDisplay( EGL_DEFAULT_DISPLAY );
+    if ( display == EGL_NO_DISPLAY || !eglInitialize( display, nullptr, nullptr ) )
+    {
+        throw std::runtime_error( "Error, no EGL display available!" );
+    }
+    return display;
+}
+
+} // namespace
+
+HeadlessContext::HeadlessContext( int width, int height ) :
+    width_( width ),
+    height_( height ) {
+
+    EGLDisplay display = openDisplay( );
+    display_ = display;
+
+    // the default surface type is a window, which surfaceless displays never offer
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint numberOfConfigs = 0;
+    if ( !eglChooseConfig( display, configAttributes, &config, 1, &numberOfConfigs ) || numberOfConfigs == 0 )
+    {
+        throw std::runtime_error( "Error, no EGL config supports desktop OpenGL!" );
+    }
+    if ( !eglBindAPI( EGL_OPENGL_API ) )
+    {
+        throw std::runtime_error( "Error, EGL does not support desktop OpenGL!" );
+    }
+
+    // same feature level as the viewer, fall back to whatever the driver offers
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext context = eglCreateContext( display, config, EGL_NO_CONTEXT, contextAttributes );
+    if ( context == EGL_NO_CONTEXT )
+    {
+        context = eglCreateContext( display, config, EGL_NO_CONTEXT, nullptr );
+    }
+    if ( context == EGL_NO_CONTEXT )
+    {
+        throw std::runtime_error( "Error during creation of the EGL context!" );
+    }
+    context_ = context;
+
+    if ( !eglMakeCurrent( display, EGL_NO_SURFACE, EGL_NO_SURFACE, context ) )
+    {
+        throw std::runtime_error( "Error, EGL context cannot be made current without a surface!" );
+    }
+    if ( !gladLoadGLLoader( (GLADloadproc)eglGetProcAddress ) )
+    {
+        throw std::runtime_error( "Error, failed to initialize GLAD" );
+    }
+
+    glGenFramebuffers(1, &framebuffer_);
+    glGenRenderbuffers(1, &colorBuffer_);
+    glGenRenderbuffers(1, &depthBuffer_);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width_, height_);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width_, height_);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer_);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer_);
+    if ( glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE )
+    {
+        throw std::runtime_error( "Error, offscreen framebuffer is incomplete!" );
+    }
+    bind( );
+}
+
+HeadlessContext::~HeadlessContext( ){
+    if ( framebuffer_ )
+    {
+        glDeleteFramebuffers(1, &framebuffer_);
+        glDeleteRenderbuffers(1, &colorBuffer_);
+        glDeleteRenderbuffers(1, &depthBuffer_);
+    }
+    if ( context_ )
+    {
+        eglMakeCurrent( display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT );
+        eglDestroyContext( display_, context_ );
+    }
+    if ( display_ )
+    {
+        eglTerminate( display_ );
+    }
+}
+
+void HeadlessContext::bind( ){
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glViewport(0, 0, width_, height_);
+}
+
+std::string HeadlessContext::description( ) const {
+    return std::string( reinterpret_cast< const char* >( glGetString(GL_RENDERER) ) ) + ", OpenGL " +
+        reinterpret_cast< const char* >( glGetString(GL_VERSION) );
+}
@@ -0,0 +1,470 @@
+#include "lod.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#include "parallel.h"
+
+namespace {
+
+// sum of squared distances to a set of planes, x^T A x + 2 b.x + c with x
+// relative to the position of its vertex. Planes pass through the vertex when
+// they are added, b and c only appear when the quadric of another vertex is merged
+struct Quadric{
+
+    float xx_ = 0.0f, xy_ = 0.0f, xz_ = 0.0f, yy_ = 0.0f, yz_ = 0.0f, zz_ = 0.0f;
+    glm::vec3 b_ = glm::vec3( 0.0f );
+    float c_ = 0.0f;
+
+    void addPlane( const glm::vec3& normal, float weight ){
+        xx_ += weight * normal.x * normal.x;
+        xy_ += weight * normal.x * normal.y;
+        xz_ += weight * normal.x * normal.z;
+        yy_ += weight * normal.y * normal.y;
+        yz_ += weight * normal.y * normal.z;
+        zz_ += weight * normal.z * normal.z;
+    }
+
+    glm::vec3 apply( const glm::vec3& x ) const {
+        return glm::vec3( xx_ * x.x + xy_ * x.y + xz_ * x.z,
+                          xy_ * x.x + yy_ * x.y + yz_ * x.z,
+                          xz_ * x.x + yz_ * x.y + zz_ * x.z );
+    }
+
+    float evaluate( const glm::vec3& x ) const {
+        return glm::dot( x, apply( x ) ) + 2.0f * glm::dot( b_, x ) + c_;
+    }
+
+    // adds other, whose vertex lies at -offset from the vertex of this quadric
+    void merge( const Quadric& other, const glm::vec3& offset ){
+        glm::vec3 shifted = other.apply( offset );
+        c_ += glm::dot( offset, shifted ) + 2.0f * glm::dot( other.b_, offset ) + other.c_;
+        b_ += other.b_ + shifted;
+        xx_ += other.xx_;
+        xy_ += other.xy_;
+        xz_ += other.xz_;
+        yy_ += other.yy_;
+        yz_ += other.yz_;
+        zz_ += other.zz_;
+    }
+
+};
+
+// triangles around every vertex, rebuilt from the live triangles after every pass
+struct Adjacency{
+
+    std::vector< uint32_t > offsets_;
+    std::vector< uint32_t > triangles_;
+
+    void build( const std::vector< uint32_t >& corners, const std::vector< uint32_t >& live, size_t numberOfVertices ){
+        offsets_.assign( numberOfVertices + 1, 0 );
+        for ( uint32_t t : live )
+        {
+            for ( int k = 0; k < 3; k++ )
+            {
+                offsets_[ corners[ 3*t + k ] + 1 ]++;
+            }
+        }
+        std::partial_sum( offsets_.begin( ), offsets_.end( ), offsets_.begin( ) );
+        triangles_.resize( offsets_.back( ) );
+        std::vector< uint32_t > next( offsets_.begin( ), offsets_.end( ) - 1 );
+        for ( uint32_t t : live )
+        {
+            for ( int k = 0; k < 3; k++ )
+            {
+                triangles_[ next[ corners[ 3*t + k ] ]++ ] = t;
+            }
+        }
+    }
+
+    const uint32_t* begin( uint32_t vertex ) const { return triangles_.data( ) + offsets_[ vertex ]; }
+    const uint32_t* end( uint32_t vertex ) const { return triangles_.data( ) + offsets_[ vertex + 1 ]; }
+
+};
+
+// distance of p to the triangle abc, through the closest point of the region
+// of the triangle p projects to (vertex, edge or face)
+float triangleDistance( const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c ){
+    glm::vec3 ab = b - a;
+    glm::vec3 ac = c - a;
+    glm::vec3 ap = p - a;
+    float d1 = glm::dot( ab, ap );
+    float d2 = glm::dot( ac, ap );
+    if ( d1 <= 0.0f && d2 <= 0.0f )
+    {
+        return glm::length( ap );
+    }
+    glm::vec3 bp = p - b;
+    float d3 = glm::dot( ab, bp );
+    float d4 = glm::dot( ac, bp );
+    if ( d3 >= 0.0f && d4 <= d3 )
+    {
+        return glm::length( bp );
+    }
+    float vc = d1 * d4 - d3 * d2;
+    if ( vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f )
+    {
+        return glm::length( ap - ab * ( d1 / ( d1 - d3 ) ) );
+    }
+    glm::vec3 cp = p - c;
+    float d5 = glm::dot( ab, cp );
+    float d6 = glm::dot( ac, cp );
+    if ( d6 >= 0.0f && d5 <= d6 )
+    {
+        return glm::length( cp );
+    }
+    float vb = d5 * d2 - d1 * d6;
+    if ( vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f )
+    {
+        return glm::length( ap - ac * ( d2 / ( d2 - d6 ) ) );
+    }
+    float va = d3 * d6 - d5 * d4;
+    if ( va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f )
+    {
+        return glm::length( bp - ( c - b ) * ( ( d4 - d3 ) / ( ( d4 - d3 ) + ( d5 - d6 ) ) ) );
+    }
+    float area = va + vb + vc;
+    if ( area <= 0.0f )
+    {
+        // degenerate, the corners are as close as it gets
+        return std::min( { glm::length( ap ), glm::length( bp ), glm::length( cp ) } );
+    }
+    return glm::length( ap - ab * ( vb / area ) - ac * ( vc / area ) );
+}
+
+// largest difference of the attributes of two triangles over the samples
+float attributeDifference( const std::vector< const MeshData* >& samples, float temperatureScale, uint32_t a, uint32_t b ){
+    float difference = 0.0f;
+    for ( const MeshData* sample : samples )
+    {
+        difference = std::max( { difference, std::abs( sample->shadow_[ a ] - sample->shadow_[ b ] ),
+            std::abs( sample->temperature_[ a ] - sample->temperature_[ b ] ) * temperatureScale } );
+    }
+    return difference;
+}
+
+} // namespace
+
+int LevelsOfDetail::select( const glm::mat4& view, const glm::mat4& projection, float viewportHeight, float pixelError ) const {
+    glm::vec3 camera = glm::vec3( glm::inverse( view )[ 3 ] );
+    float distance = glm::length( camera - center_ ) - radius_;
+    if ( distance <= 0.0f )
+    {
+        return -1;
+    }
+    // pixels per model unit at the closest point of the bounding sphere
+    float scale = projection[ 1 ][ 1 ] * 0.5f * viewportHeight / distance;
+    for ( int level = int( levels_.size( ) ) - 1; level >= 0; level-- )
+    {
+        if ( levels_[ level ].error_ * scale <= pixelError )
+        {
+            return level;
+        }
+    }
+    return -1;
+}
+
+std::shared_ptr< const LevelsOfDetail > buildLevelsOfDetail( const MeshGeometry& geometry,
+    const std::vector< const MeshData* >& samples, const ValueRange& temperatureRange,
+    const SimplificationSettings& settings, int numberOfThreads ){
+
+    auto result = std::make_shared< LevelsOfDetail >( );
+    result->geometryRevision_ = geometry.revision_;
+    const std::vector< glm::vec3 >& positions = geometry.positions_;
+    if ( positions.empty( ) )
+    {
+        return result;
+    }
+    glm::vec3 lower( std::numeric_limits< float >::max( ) );
+    glm::vec3 upper( -std::numeric_limits< float >::max( ) );
+    for ( const glm::vec3& position : positions )
+    {
+        lower = glm::min( lower, position );
+        upper = glm::max( upper, position );
+    }
+    result->center_ = 0.5f * ( lower + upper );
+    result->radius_ = 0.5f * glm::length( upper - lower );
+
+    // triangles collapsed by the welding never reach a level
+    uint32_t numberOfTriangles = uint32_t( geometry.numberOfTriangles( ) );
+    size_t numberOfVertices = positions.size( );
+    std::vector< uint32_t > corners = geometry.indices_;
+    auto contains = [&]( uint32_t t, uint32_t vertex ){
+        return corners[ 3*t ] == vertex || corners[ 3*t + 1 ] == vertex || corners[ 3*t + 2 ] == vertex;
+    };
+    std::vector< uint32_t > live;
+    live.reserve( numberOfTriangles );
+    for ( uint32_t t = 0; t < numberOfTriangles; t++ )
+    {
+        if ( corners[ 3*t ] != corners[ 3*t + 1 ] && corners[ 3*t + 1 ] != corners[ 3*t + 2 ] && corners[ 3*t ] != corners[ 3*t + 2 ] )
+        {
+            live.push_back( t );
+        }
+    }
+    Adjacency adjacency;
+    adjacency.build( corners, live, numberOfVertices );
+
+    float width = temperatureRange.max_ - temperatureRange.min_;
+    float temperatureScale = width > 0.0f ? 1.0f / width : 0.0f;
+
+    // planes of the adjacent triangles, plus planes perpendicular to the surface
+    // through border, non-manifold and feature edges, which keep those in place
+    std::vector< Quadric > quadrics( numberOfVertices );
+    const size_t chunkSize = 16384;
+    parallelFor( int( ( numberOfVertices + chunkSize - 1 ) / chunkSize ), [&]( int chunk ){
+        size_t end = std::min( ( size_t( chunk ) + 1 ) * chunkSize, numberOfVertices );
+        for ( uint32_t v = uint32_t( size_t( chunk ) * chunkSize ); v < end; v++ )
+        {
+            Quadric& quadric = quadrics[ v ];
+            for ( const uint32_t* t = adjacency.begin( v ); t != adjacency.end( v ); t++ )
+            {
+                const uint32_t* corner = &corners[ 3 * *t ];
+                glm::vec3 normal = glm::cross( positions[ corner[ 1 ] ] - positions[ corner[ 0 ] ],
+                                               positions[ corner[ 2 ] ] - positions[ corner[ 0 ] ] );
+                float length = glm::length( normal );
+                if ( length == 0.0f )
+                {
+                    continue;
+                }
+                normal /= length;
+                quadric.addPlane( normal, 1.0f );
+                for ( int k = 0; k < 3; k++ )
+                {
+                    if ( corner[ k ] != v )
+                    {
+                        continue;
+                    }
+                    for ( uint32_t other : { corner[ ( k + 1 ) % 3 ], corner[ ( k + 2 ) % 3 ] } )
+                    {
+                        int shared = 0;
+                        uint32_t neighbour = 0;
+                        for ( const uint32_t* u = adjacency.begin( v ); u != adjacency.end( v ); u++ )
+                        {
+                            if ( *u != *t && contains( *u, other ) )
+                            {
+                                shared++;
+                                neighbour = *u;
+                            }
+                        }
+                        if ( shared == 1 && attributeDifference( samples, temperatureScale, *t, neighbour ) <= settings.featureThreshold_ )
+                        {
+                            continue;
+                        }
+                        glm::vec3 side = glm::cross( positions[ other ] - positions[ v ], normal );
+                        float sideLength = glm::length( side );
+                        if ( sideLength > 0.0f )
+                        {
+                            quadric.addPlane( side / sideLength, settings.boundaryWeight_ );
+                        }
+                    }
+                }
+            }
+        }
+    }, numberOfThreads );
+
+    // a collapse must not flip a triangle around the removed vertex, and the two
+    // ends may only share the vertices opposite to their common triangles
+    std::vector< uint32_t > neighbours;
+    auto collapsible = [&]( uint32_t source, uint32_t target ){
+        int common = 0;
+        for ( const uint32_t* t = adjacency.begin( source ); t != adjacency.end( source ); t++ )
+        {
+            const uint32_t* corner = &corners[ 3 * *t ];
+            if ( contains( *t, target ) )
+            {
+                common++;
+                continue;
+            }
+            glm::vec3 p[ 3 ], q[ 3 ];
+            for ( int k = 0; k < 3; k++ )
+            {
+                p[ k ] = positions[ corner[ k ] ];
+                q[ k ] = positions[ corner[ k ] == source ? target : corner[ k ] ];
+            }
+            glm::vec3 before = glm::cross( p[ 1 ] - p[ 0 ], p[ 2 ] - p[ 0 ] );
+            glm::vec3 after = glm::cross( q[ 1 ] - q[ 0 ], q[ 2 ] - q[ 0 ] );
+            if ( glm::dot( before, after ) <= 0.0f )
+            {
+                return false;
+            }
+        }
+        neighbours.clear( );
+        for ( const uint32_t* t = adjacency.begin( source ); t != adjacency.end( source ); t++ )
+        {
+            neighbours.insert( neighbours.end( ), &corners[ 3 * *t ], &corners[ 3 * *t ] + 3 );
+        }
+        std::sort( neighbours.begin( ), neighbours.end( ) );
+        neighbours.erase( std::unique( neighbours.begin( ), neighbours.end( ) ), neighbours.end( ) );
+        int shared = 0;
+        for ( const uint32_t* t = adjacency.begin( target ); t != adjacency.end( target ); t++ )
+        {
+            for ( int k = 0; k < 3; k++ )
+            {
+                uint32_t vertex = corners[ 3 * *t + k ];
+                if ( vertex != source && vertex != target && std::binary_search( neighbours.begin( ), neighbours.end( ), vertex ) )
+                {
+                    shared++;
+                }
+            }
+        }
+        // every opposite vertex is seen from both triangles around it at the target
+        return shared <= 2 * common;
+    };
+
+    struct Candidate{
+        float cost_;
+        uint32_t source_;
+        uint32_t target_;
+    };
+    std::vector< Candidate > candidates;
+    std::vector< uint8_t > locked( numberOfVertices );
+    std::vector< uint8_t > collapsed( numberOfTriangles );
+    // vertex every vertex was collapsed into, itself while it is part of the mesh
+    std::vector< uint32_t > mergedInto( numberOfVertices );
+    std::iota( mergedInto.begin( ), mergedInto.end( ), 0u );
+    std::vector< uint32_t > representative( numberOfVertices );
+    float previousError = 0.0f;
+
+    for ( float ratio : settings.ratios_ )
+    {
+        size_t target = std::max( size_t( double( ratio ) * numberOfTriangles ), size_t( settings.minimumTriangles_ ) );
+        bool progress = true;
+        size_t widening = 1;
+        while ( live.size( ) > target && progress )
+        {
+            // every edge once, towards the end that deviates less
+            candidates.resize( 3 * live.size( ) );
+            parallelFor( int( ( live.size( ) + chunkSize - 1 ) / chunkSize ), [&]( int chunk ){
+                size_t end = std::min( ( size_t( chunk ) + 1 ) * chunkSize, live.size( ) );
+                for ( size_t i = size_t( chunk ) * chunkSize; i < end; i++ )
+                {
+                    for ( int k = 0; k < 3; k++ )
+                    {
+                        uint32_t a = corners[ 3 * live[ i ] + k ];
+                        uint32_t b = corners[ 3 * live[ i ] + ( k + 1 ) % 3 ];
+                        Candidate& candidate = candidates[ 3*i + k ];
+                        if ( a > b )
+                        {
+                            candidate.cost_ = -1.0f;
+                            continue;
+                        }
+                        glm::vec3 offset = positions[ b ] - positions[ a ];
+                        float towardsB = quadrics[ b ].c_ + quadrics[ a ].evaluate( offset );
+                        float towardsA = quadrics[ a ].c_ + quadrics[ b ].evaluate( -offset );
+                        candidate = towardsB <= towardsA ? Candidate{ std::max( towardsB, 0.0f ), a, b }
+                                                         : Candidate{ std::max( towardsA, 0.0f ), b, a };
+                    }
+                }
+            }, numberOfThreads );
+            candidates.erase( std::remove_if( candidates.begin( ), candidates.end( ),
+                []( const Candidate& candidate ){ return candidate.cost_ < 0.0f; } ), candidates.end( ) );
+
+            // most collapses remove two triangles. Only the cheapest needed edges, and
+            // at least a small fraction of all, are tried. Locking rejects some of them
+            // and the next pass continues, after a pass without any collapse more are tried
+            size_t needed = ( live.size( ) - target + 1 ) / 2;
+            size_t considered = std::min( candidates.size( ), std::max( needed, candidates.size( ) / 32 ) * widening );
+            auto cheaper = []( const Candidate& a, const Candidate& b ){ return a.cost_ < b.cost_; };
+            std::nth_element( candidates.begin( ), candidates.begin( ) + considered, candidates.end( ), cheaper );
+            std::sort( candidates.begin( ), candidates.begin( ) + considered, cheaper );
+
+            // independent collapses: everything around a collapse is locked for the rest of the pass
+            std::fill( locked.begin( ), locked.end( ), 0 );
+            size_t removed = 0;
+            for ( size_t i = 0; i < considered && live.size( ) - removed > target; i++ )
+            {
+                uint32_t source = candidates[ i ].source_;
+                uint32_t destination = candidates[ i ].target_;
+                if ( locked[ source ] || locked[ destination ] || !collapsible( source, destination ) )
+                {
+                    continue;
+                }
+                for ( const uint32_t* t = adjacency.begin( source ); t != adjacency.end( source ); t++ )
+                {
+                    uint32_t* corner = &corners[ 3 * *t ];
+                    for ( int k = 0; k < 3; k++ )
+                    {
+                        locked[ corner[ k ] ] = 1;
+                    }
+                    if ( contains( *t, destination ) )
+                    {
+                        collapsed[ *t ] = 1;
+                        removed++;
+                    }
+                    for ( int k = 0; k < 3; k++ )
+                    {
+                        corner[ k ] = corner[ k ] == source ? destination : corner[ k ];
+                    }
+                }
+                quadrics[ destination ].merge( quadrics[ source ], positions[ destination ] - positions[ source ] );
+                mergedInto[ source ] = destination;
+            }
+            progress = removed > 0 || considered < candidates.size( );
+            widening = removed > 0 ? 1 : 2 * widening;
+            live.erase( std::remove_if( live.begin( ), live.end( ), [&]( uint32_t t ){ return collapsed[ t ] != 0; } ), live.end( ) );
+            adjacency.build( corners, live, numberOfVertices );
+        }
+
+        if ( !result->levels_.empty( ) && result->levels_.back( ).triangles_.size( ) == live.size( ) )
+        {
+            break;
+        }
+        DetailLevel level;
+        level.triangles_ = live;
+        level.indices_.reserve( 3 * live.size( ) );
+        for ( uint32_t t : live )
+        {
+            level.indices_.insert( level.indices_.end( ), &corners[ 3*t ], &corners[ 3*t ] + 3 );
+        }
+
+        // the quadric costs only order the collapses. The error of the level is the
+        // largest distance of a removed vertex to the triangles near the vertex it
+        // ended up in, which bounds its distance to the level from above
+        for ( size_t v = 0; v < numberOfVertices; v++ )
+        {
+            uint32_t root = mergedInto[ v ];
+            while ( mergedInto[ root ] != root )
+            {
+                root = mergedInto[ root ];
+            }
+            representative[ v ] = root;
+            mergedInto[ v ] = root;
+        }
+        int numberOfChunks = int( ( numberOfVertices + chunkSize - 1 ) / chunkSize );
+        std::vector< float > deviation( numberOfChunks, 0.0f );
+        parallelFor( numberOfChunks, [&]( int chunk ){
+            size_t end = std::min( ( size_t( chunk ) + 1 ) * chunkSize, numberOfVertices );
+            for ( size_t v = size_t( chunk ) * chunkSize; v < end; v++ )
+            {
+                uint32_t root = representative[ v ];
+                if ( root == v || adjacency.begin( root ) == adjacency.end( root ) )
+                {
+                    continue;
+                }
+                // the triangles around the corners of the fan, a removed vertex
+                // often lies over a neighbour of the fan rather than the fan itself
+                float distance = std::numeric_limits< float >::max( );
+                for ( const uint32_t* t = adjacency.begin( root ); t != adjacency.end( root ); t++ )
+                {
+                    // the corner after root, every vertex of the ring once on closed surfaces
+                    const uint32_t* fan = &corners[ 3 * *t ];
+                    uint32_t around = fan[ 0 ] == root ? fan[ 1 ] : fan[ 1 ] == root ? fan[ 2 ] : fan[ 0 ];
+                    for ( const uint32_t* u = adjacency.begin( around ); u != adjacency.end( around ); u++ )
+                    {
+                        const uint32_t* corner = &corners[ 3 * *u ];
+                        distance = std::min( distance, triangleDistance( positions[ v ],
+                            positions[ corner[ 0 ] ], positions[ corner[ 1 ] ], positions[ corner[ 2 ] ] ) );
+                    }
+                }
+                deviation[ chunk ] = std::max( deviation[ chunk ], distance );
+            }
+        }, numberOfThreads );
+        // coarser levels never claim to be more accurate than finer ones
+        level.error_ = std::max( previousError, *std::max_element( deviation.begin( ), deviation.end( ) ) );
+        previousError = level.error_;
+        result->levels_.push_back( std::move( level ) );
+    }
+    return result;
+}
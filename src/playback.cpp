@@ -0,0 +1,145 @@
+#include "playback.h"
+
+#include <cmath>
+
+//
+// PLAYBACK
+//
+void Playback::play( double time ){
+    playing_ = true;
+    time_ = time;
+    previous_ = Clock::now( );
+    deadline_ = previous_;
+}
+
+double Playback::advance( double first, double last ){
+
+    Clock::time_point now = Clock::now( );
+    double elapsed = std::chrono::duration< double >( now - previous_ ).count( );
+    previous_ = now;
+    frames_++;
+    frameTime_ = float( 1000.0 * elapsed );
+
+    // the clock follows wall time, late frames skip ahead instead of slowing down
+    time_ += double( speed_ ) * elapsed;
+    if ( time_ > last )
+    {
+        if ( loop_ && last > first )
+        {
+            time_ = first + std::fmod( time_ - first, last - first );
+        }
+        else
+        {
+            time_ = last;
+            playing_ = false;
+        }
+    }
+    return time_;
+}
+
+void Playback::waitForNextFrame( ){
+
+    auto interval = std::chrono::duration_cast< Clock::duration >(
+        std::chrono::duration< double >( 1.0 / std::max( targetFps_, 1.0f ) ) );
+    deadline_ += interval;
+
+    Clock::time_point now = Clock::now( );
+    if ( now > deadline_ )
+    {
+        // missed the slot, start counting again from now
+        late_++;
+        deadline_ = now;
+        return;
+    }
+    std::this_thread::sleep_until( deadline_ );
+}
+
+void Playback::resetStatistics( ){
+    frames_ = 0;
+    late_ = 0;
+    dropped_ = 0;
+}
+
+//
+// STAGER
+//
+TimestepStager::TimestepStager( Loader loader ) :
+    loader_( std::move( loader ) ) {
+    worker_ = std::thread( &TimestepStager::run, this );
+}
+
+TimestepStager::~TimestepStager( ){
+    {
+        std::lock_guard< std::mutex > lock( mutex_ );
+        stop_ = true;
+    }
+    wake_.notify_all( );
+    worker_.join( );
+}
+
+bool TimestepStager::busy( ){
+    std::lock_guard< std::mutex > lock( mutex_ );
+    return pending_ || finished_;
+}
+
+int TimestepStager::step( ){
+    std::lock_guard< std::mutex > lock( mutex_ );
+    return pending_ || finished_ ? job_.step_ : -1;
+}
+
+void TimestepStager::submit( int step, const Renderer::StagingSlot& slot ){
+    {
+        std::lock_guard< std::mutex > lock( mutex_ );
+        job_ = Result( );
+        job_.slot_ = slot;
+        job_.step_ = step;
+        pending_ = true;
+    }
+    wake_.notify_one( );
+}
+
+bool TimestepStager::collect( Result& result ){
+    std::lock_guard< std::mutex > lock( mutex_ );
+    if ( !finished_ )
+    {
+        return false;
+    }
+    result = job_;
+    finished_ = false;
+    return true;
+}
+
+void TimestepStager::run( ){
+
+    std::unique_lock< std::mutex > lock( mutex_ );
+    while ( true )
+    {
+        wake_.wait( lock, [&]( ){ return stop_ || pending_; } );
+        if ( stop_ )
+        {
+            return;
+        }
+        Result job = job_;
+        lock.unlock( );
+
+        try
+        {
+            std::shared_ptr< const MeshData > mesh = loader_( job.step_ );
+            if ( mesh && job.slot_.shadow_ && job.slot_.temperature_ &&
+                 mesh->shadow_.size( ) == job.slot_.numberOfTriangles_ )
+            {
+                job.slot_.write( *mesh );
+                job.revision_ = mesh->revision_;
+            }
+        }
+        catch ( const std::exception& error )
+        {
+            std::cerr << "staging of timestep " << job.step_ << " failed: " << error.what( ) << std::endl;
+        }
+
+        lock.lock( );
+        job_ = job;
+        pending_ = false;
+        finished_ = true;
+    }
+}
@@ -0,0 +1,296 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <stdexcept>
+
+namespace {
+
+// stages that issue GL commands get a timer query
+bool measuresGpu( ProfileStage stage ){
+    return stage == ProfileStage::UPLOAD || stage == ProfileStage::DRAW ||
+           stage == ProfileStage::OVERLAY || stage == ProfileStage::GUI;
+}
+
+} // namespace
+
+const char* profileStageName( ProfileStage stage ){
+    switch ( stage )
+    {
+        case ProfileStage::UPDATE: return "update";
+        case ProfileStage::UPLOAD: return "upload";
+        case ProfileStage::DRAW: return "draw";
+        case ProfileStage::OVERLAY: return "overlay";
+        case ProfileStage::COLORBAR: return "colorbar";
+        case ProfileStage::GUI: return "gui";
+        case ProfileStage::SWAP: return "swap";
+        default: return "unknown";
+    }
+}
+
+FrameProfiler::FrameProfiler( ) :
+    created_( std::chrono::steady_clock::now( ) ) { }
+
+double FrameProfiler::now( ) const {
+    return std::chrono::duration< double >( std::chrono::steady_clock::now( ) - created_ ).count( );
+}
+
+void FrameProfiler::init( ){
+    for ( auto& queries : queries_ )
+    {
+        glGenQueries(GLsizei( queries.size( ) ), queries.data( ));
+    }
+    // the first timer query around any GL work returns garbage on llvmpipe, spend it
+    // here on a clear, nothing has been drawn yet anyway
+    GLuint64 elapsed;
+    glBeginQuery(GL_TIME_ELAPSED, queries_[ 0 ][ 0 ]);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glEndQuery(GL_TIME_ELAPSED);
+    glGetQueryObjectui64v(queries_[ 0 ][ 0 ], GL_QUERY_RESULT, &elapsed);
+    initialized_ = true;
+}
+
+void FrameProfiler::release( ){
+    stopCsv( );
+    if ( initialized_ )
+    {
+        for ( auto& queries : queries_ )
+        {
+            glDeleteQueries(GLsizei( queries.size( ) ), queries.data( ));
+        }
+    }
+    initialized_ = false;
+}
+
+void FrameProfiler::beginFrame( ){
+
+    if ( !enabled_ || !initialized_ )
+    {
+        return;
+    }
+    // the slot is about to be reused, results that are still not there are dropped
+    PendingFrame& pending = ring_[ frame_ % ringSize ];
+    if ( pending.pending_ )
+    {
+        collect( pending, false );
+    }
+    // the older frames usually finished meanwhile
+    for ( int i = 1; i < ringSize; i++ )
+    {
+        PendingFrame& older = ring_[ ( frame_ + i ) % ringSize ];
+        if ( older.pending_ )
+        {
+            collect( older, false );
+            if ( older.pending_ )
+            {
+                break;
+            }
+        }
+    }
+
+    pending = PendingFrame( );
+    pending.timing_.frame_ = frame_;
+    frameStart_ = now( );
+    pending.timing_.start_ = frameStart_;
+    inFrame_ = true;
+}
+
+void FrameProfiler::endFrame( ){
+
+    if ( !inFrame_ )
+    {
+        return;
+    }
+    PendingFrame& pending = ring_[ frame_ % ringSize ];
+    pending.timing_.frameTime_ = 1000.0 * ( now( ) - frameStart_ );
+    pending.pending_ = true;
+    inFrame_ = false;
+    frame_++;
+}
+
+void FrameProfiler::begin( ProfileStage stage ){
+
+    if ( !inFrame_ )
+    {
+        return;
+    }
+    int index = int( stage );
+    stageStart_[ index ] = now( );
+    PendingFrame& pending = ring_[ frame_ % ringSize ];
+    if ( measuresGpu( stage ) && activeQuery_ < 0 )
+    {
+        int& issued = pending.queried_[ index ];
+        if ( issued == queriesPerStage )
+        {
+            pending.incomplete_[ index ] = true;
+            return;
+        }
+        glBeginQuery(GL_TIME_ELAPSED, queries_[ frame_ % ringSize ][ index * queriesPerStage + issued ]);
+        activeQuery_ = index;
+        issued++;
+    }
+}
+
+void FrameProfiler::end( ProfileStage stage ){
+
+    if ( !inFrame_ )
+    {
+        return;
+    }
+    int index = int( stage );
+    // stages running more than once per frame add up
+    ring_[ frame_ % ringSize ].timing_.cpu_[ index ] += 1000.0 * ( now( ) - stageStart_[ index ] );
+    if ( activeQuery_ == index )
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        activeQuery_ = -1;
+    }
+}
+
+void FrameProfiler::collect( PendingFrame& pending, bool wait ){
+
+    GLuint* queries = queries_[ pending.timing_.frame_ % ringSize ].data( );
+    if ( !wait )
+    {
+        for ( int i = 0; i < profileStageCount; i++ )
+        {
+            // the last query of a stage finishes last
+            GLint available = GL_TRUE;
+            if ( pending.queried_[ i ] > 0 )
+            {
+                glGetQueryObjectiv(queries[ i * queriesPerStage + pending.queried_[ i ] - 1 ], GL_QUERY_RESULT_AVAILABLE, &available);
+            }
+            if ( !available )
+            {
+                // called for the slot about to be reused, give up on its GPU times
+                if ( &pending == &ring_[ frame_ % ringSize ] )
+                {
+                    pending.timing_.gpu_.fill( -1.0 );
+                    pending.pending_ = false;
+                    complete( pending.timing_ );
+                }
+                return;
+            }
+        }
+    }
+    for ( int i = 0; i < profileStageCount; i++ )
+    {
+        // all runs of the stage in the frame
+        GLuint64 sum = 0;
+        for ( int k = 0; k < pending.queried_[ i ]; k++ )
+        {
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(queries[ i * queriesPerStage + k ], GL_QUERY_RESULT, &elapsed);
+            sum += elapsed;
+        }
+        bool measured = pending.queried_[ i ] > 0 && !pending.incomplete_[ i ];
+        pending.timing_.gpu_[ i ] = measured ? double( sum ) * 1e-6 : -1.0;
+    }
+    pending.pending_ = false;
+    complete( pending.timing_ );
+}
+
+void FrameProfiler::complete( const FrameTiming& timing ){
+
+    history_.push_back( timing );
+    while ( history_.size( ) > historySize_ )
+    {
+        history_.pop_front( );
+    }
+
+    if ( csv_.is_open( ) )
+    {
+        csv_ << timing.frame_ << ',' << timing.start_ << ',' << timing.frameTime_;
+        for ( int i = 0; i < profileStageCount; i++ )
+        {
+            csv_ << ',' << timing.cpu_[ i ] << ',';
+            if ( timing.gpu_[ i ] >= 0.0 )
+            {
+                csv_ << timing.gpu_[ i ];
+            }
+        }
+        csv_ << '\n';
+    }
+}
+
+FrameTiming FrameProfiler::average( int frames ) const {
+
+    FrameTiming mean;
+    int count = std::min( frames, int( history_.size( ) ) );
+    std::array< int, profileStageCount > gpuCount{ };
+    for ( int f = int( history_.size( ) ) - count; f < int( history_.size( ) ); f++ )
+    {
+        const FrameTiming& timing = history_[ f ];
+        mean.frameTime_ += timing.frameTime_;
+        for ( int i = 0; i < profileStageCount; i++ )
+        {
+            mean.cpu_[ i ] += timing.cpu_[ i ];
+            if ( timing.gpu_[ i ] >= 0.0 )
+            {
+                mean.gpu_[ i ] += timing.gpu_[ i ];
+                gpuCount[ i ]++;
+            }
+        }
+    }
+    if ( count > 0 )
+    {
+        mean.frameTime_ /= count;
+        for ( int i = 0; i < profileStageCount; i++ )
+        {
+            mean.cpu_[ i ] /= count;
+            mean.gpu_[ i ] = gpuCount[ i ] > 0 ? mean.gpu_[ i ] / gpuCount[ i ] : -1.0;
+        }
+    }
+    return mean;
+}
+
+void FrameProfiler::startCsv( const std::string& path, const std::string& comment ){
+
+    stopCsv( );
+    csv_.open( path );
+    if ( !csv_ )
+    {
+        throw std::runtime_error( "Error, cannot write profile to " + path );
+    }
+    csvPath_ = path;
+    csv_ << std::setprecision( 6 );
+    if ( !comment.empty( ) )
+    {
+        csv_ << "# " << comment << '\n';
+    }
+    // times in milliseconds, start in seconds, an empty GPU column means not measured or dropped.
+    // Both columns of a stage sum all of its runs in the frame, one per viewport
+    csv_ << "frame,start_s,frame_ms";
+    for ( int i = 0; i < profileStageCount; i++ )
+    {
+        const char* name = profileStageName( ProfileStage( i ) );
+        csv_ << ',' << name << "_cpu_ms," << name << "_gpu_ms";
+    }
+    csv_ << '\n';
+}
+
+void FrameProfiler::stopCsv( ){
+    if ( !csv_.is_open( ) )
+    {
+        return;
+    }
+    // frames still waiting for their queries are written as well
+    flush( );
+    csv_.close( );
+}
+
+void FrameProfiler::flush( ){
+    if ( !initialized_ )
+    {
+        return;
+    }
+    // oldest first, the slot of frame_ holds the oldest frame
+    for ( int i = 0; i < ringSize; i++ )
+    {
+        PendingFrame& pending = ring_[ ( frame_ + i ) % ringSize ];
+        if ( pending.pending_ )
+        {
+            collect( pending, true );
+        }
+    }
+}
@@ -0,0 +1,95 @@
+#include "quantization.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+QuantizedPositions::QuantizedPositions( const std::vector< glm::vec3 >& positions ){
+
+    glm::vec3 minimum( std::numeric_limits< float >::max( ) );
+    glm::vec3 maximum( -std::numeric_limits< float >::max( ) );
+    for ( const glm::vec3& position : positions )
+    {
+        minimum = glm::min( minimum, position );
+        maximum = glm::max( maximum, position );
+    }
+    if ( positions.empty( ) )
+    {
+        minimum = maximum = glm::vec3( 0.0f );
+    }
+    offset_ = minimum;
+    // flat axes keep a unit scale, every value there quantizes to 0
+    scale_ = maximum - minimum;
+    for ( int axis = 0; axis < 3; axis++ )
+    {
+        scale_[ axis ] = scale_[ axis ] > 0.0f ? scale_[ axis ] : 1.0f;
+    }
+
+    values_.resize( 4 * positions.size( ) );
+    for ( size_t i = 0; i < positions.size( ); i++ )
+    {
+        glm::vec3 t = ( positions[ i ] - offset_ ) / scale_;
+        values_[ 4*i ] = quantizeUnorm16( t.x );
+        values_[ 4*i + 1 ] = quantizeUnorm16( t.y );
+        values_[ 4*i + 2 ] = quantizeUnorm16( t.z );
+        values_[ 4*i + 3 ] = 0;
+    }
+}
+
+glm::vec3 QuantizedPositions::position( size_t vertex ) const {
+    glm::vec3 t( values_[ 4*vertex ], values_[ 4*vertex + 1 ], values_[ 4*vertex + 2 ] );
+    return offset_ + scale_ * ( t / 65535.0f );
+}
+
+void packShadow( const float* shadow, size_t count, uint8_t* packed ){
+    for ( size_t i = 0; i < count; i++ )
+    {
+        packed[ i ] = uint8_t( std::min( std::max( shadow[ i ], 0.0f ), 1.0f ) * 255.0f + 0.5f );
+    }
+}
+
+void packTemperature( const float* temperature, size_t count, const ValueRange& range, uint16_t* packed ){
+    float width = range.max_ - range.min_;
+    float scale = width > 0.0f ? 1.0f / width : 0.0f;
+    for ( size_t i = 0; i < count; i++ )
+    {
+        packed[ i ] = quantizeUnorm16( ( temperature[ i ] - range.min_ ) * scale );
+    }
+}
+
+QuantizationError measureQuantizationError( const std::vector< glm::vec3 >& positions,
+    const std::vector< float >& shadow, const std::vector< float >& temperature, const ValueRange& temperatureRange ){
+
+    QuantizationError error;
+
+    QuantizedPositions quantized( positions );
+    for ( size_t i = 0; i < positions.size( ); i++ )
+    {
+        glm::vec3 difference = glm::abs( quantized.position( i ) - positions[ i ] );
+        error.position_ = std::max( { error.position_, difference.x, difference.y, difference.z } );
+    }
+    float diagonal = glm::length( quantized.scale_ );
+    error.positionRelative_ = diagonal > 0.0f ? error.position_ / diagonal : 0.0f;
+
+    std::vector< uint8_t > packedShadow( shadow.size( ) );
+    packShadow( shadow.data( ), shadow.size( ), packedShadow.data( ) );
+    for ( size_t i = 0; i < shadow.size( ); i++ )
+    {
+        error.shadow_ = std::max( error.shadow_, std::abs( float( packedShadow[ i ] ) / 255.0f - shadow[ i ] ) );
+    }
+
+    std::vector< uint16_t > packedTemperature( temperature.size( ) );
+    packTemperature( temperature.data( ), temperature.size( ), temperatureRange, packedTemperature.data( ) );
+    float width = temperatureRange.max_ - temperatureRange.min_;
+    for ( size_t i = 0; i < temperature.size( ); i++ )
+    {
+        if ( temperature[ i ] < temperatureRange.min_ || temperature[ i ] > temperatureRange.max_ )
+        {
+            error.temperatureClamped_++;
+            continue;
+        }
+        float decoded = temperatureRange.min_ + width * float( packedTemperature[ i ] ) / 65535.0f;
+        error.temperature_ = std::max( error.temperature_, std::abs( decoded - temperature[ i ] ) );
+    }
+    return error;
+}
@@ -0,0 +1,29 @@
+#include "resources.h"
+
+#include <fstream>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+size_t residentBytes( ){
+    // total and resident size in pages
+    std::ifstream statm( "/proc/self/statm" );
+    size_t pages = 0;
+    size_t residentPages = 0;
+    if ( !( statm >> pages >> residentPages ) )
+    {
+        return 0;
+    }
+    long pageSize = sysconf( _SC_PAGESIZE );
+    return pageSize > 0 ? residentPages * size_t( pageSize ) : 0;
+}
+
+size_t peakResidentBytes( ){
+    struct rusage usage;
+    if ( getrusage( RUSAGE_SELF, &usage ) != 0 )
+    {
+        return 0;
+    }
+    // kilobytes on Linux
+    return size_t( usage.ru_maxrss ) * 1024;
+}
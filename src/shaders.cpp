@@ -0,0 +1,275 @@
+#include "shaders.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+struct EmbeddedShader{
+    const char* name_;
+    const char* source_;
+};
+
+const EmbeddedShader embeddedShaders[] = {
+#include "embedded_shaders.inc"
+};
+
+// FNV-1a, only used to name the cache files
+uint64_t hashText( uint64_t hash, const std::string& text ){
+    for ( unsigned char c : text )
+    {
+        hash = ( hash ^ c ) * 1099511628211ull;
+    }
+    // separates the parts, so moving text from one part into the next changes the key
+    return ( hash ^ 0xffu ) * 1099511628211ull;
+}
+
+std::string glString( GLenum name ){
+    const GLubyte* value = glGetString( name );
+    return value ? reinterpret_cast< const char* >( value ) : "";
+}
+
+GLuint compile( const std::string& name, const std::string& source, GLenum type ){
+    const char* text = source.c_str( );
+    GLuint shader = glCreateShader( type );
+    glShaderSource( shader, 1, &text, nullptr );
+    glCompileShader( shader );
+    GLint success = 0;
+    glGetShaderiv( shader, GL_COMPILE_STATUS, &success );
+    if ( !success )
+    {
+        GLint length = 0;
+        glGetShaderiv( shader, GL_INFO_LOG_LENGTH, &length );
+        std::string log( size_t( std::max( length, 1 ) ), '\0' );
+        glGetShaderInfoLog( shader, length, nullptr, log.data( ) );
+        glDeleteShader( shader );
+        throw std::runtime_error( "Error, compiling " + name + " failed: " + log.c_str( ) );
+    }
+    return shader;
+}
+
+bool linked( GLuint program ){
+    GLint success = 0;
+    glGetProgramiv( program, GL_LINK_STATUS, &success );
+    return success;
+}
+
+} // namespace
+
+const char* embeddedShader( const std::string& name ){
+    for ( const EmbeddedShader& shader : embeddedShaders )
+    {
+        if ( name == shader.name_ )
+        {
+            return shader.source_;
+        }
+    }
+    return nullptr;
+}
+
+ShaderLibrary::ShaderLibrary( ){
+    if ( const char* directory = std::getenv( "SCRT_SHADER_DIR" ) )
+    {
+        directory_ = directory;
+    }
+    if ( const char* cache = std::getenv( "SCRT_SHADER_CACHE" ) )
+    {
+        cacheDirectory_ = cache;
+    }
+    else if ( const char* cache = std::getenv( "XDG_CACHE_HOME" ) )
+    {
+        cacheDirectory_ = ( std::filesystem::path( cache ) / "scrt" ).string( );
+    }
+    else if ( const char* home = std::getenv( "HOME" ) )
+    {
+        cacheDirectory_ = ( std::filesystem::path( home ) / ".cache" / "scrt" ).string( );
+    }
+}
+
+std::string ShaderLibrary::source( const std::string& name ) const {
+    if ( !directory_.empty( ) )
+    {
+        std::ifstream file( std::filesystem::path( directory_ ) / name );
+        if ( file )
+        {
+            std::stringstream buffer;
+            buffer << file.rdbuf( );
+            return buffer.str( );
+        }
+    }
+    const char* embedded = embeddedShader( name );
+    if ( !embedded )
+    {
+        throw std::runtime_error( "Error, there is no shader " + name + "!" );
+    }
+    return embedded;
+}
+
+GLuint ShaderLibrary::link( const std::string& vertexName, const std::string& fragmentName ){
+
+    auto start = std::chrono::steady_clock::now( );
+    std::string vertexSource = source( vertexName );
+    std::string fragmentSource = source( fragmentName );
+
+    watched_.clear( );
+    if ( !directory_.empty( ) )
+    {
+        for ( const std::string& name : { vertexName, fragmentName } )
+        {
+            std::filesystem::path path = std::filesystem::path( directory_ ) / name;
+            std::error_code error;
+            std::filesystem::file_time_type time = std::filesystem::last_write_time( path, error );
+            if ( !error )
+            {
+                watched_.emplace_back( path, time );
+            }
+        }
+    }
+
+    // a driver update or a different GPU changes the strings and thereby the file
+    std::filesystem::path cachePath;
+    GLint formats = 0;
+    glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &formats );
+    if ( !cacheDirectory_.empty( ) && formats > 0 && glGetProgramBinary && glProgramBinary )
+    {
+        uint64_t key = 14695981039346656037ull;
+        for ( const std::string& part : { glString( GL_VENDOR ), glString( GL_RENDERER ), glString( GL_VERSION ),
+                                         vertexSource, fragmentSource } )
+        {
+            key = hashText( key, part );
+        }
+        char name[ 32 ];
+        std::snprintf( name, sizeof( name ), "%016llx.bin", static_cast< unsigned long long >( key ) );
+        cachePath = std::filesystem::path( cacheDirectory_ ) / name;
+    }
+
+    fromCache_ = false;
+    GLuint program = cachePath.empty( ) ? 0 : loadBinary( cachePath );
+    if ( program )
+    {
+        fromCache_ = true;
+    }
+    else
+    {
+        GLuint vertexShader = compile( vertexName, vertexSource, GL_VERTEX_SHADER );
+        GLuint fragmentShader = 0;
+        try
+        {
+            fragmentShader = compile( fragmentName, fragmentSource, GL_FRAGMENT_SHADER );
+        }
+        catch ( ... )
+        {
+            glDeleteShader( vertexShader );
+            throw;
+        }
+        program = glCreateProgram( );
+        if ( !cachePath.empty( ) )
+        {
+            glProgramParameteri( program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+        }
+        glAttachShader( program, vertexShader );
+        glAttachShader( program, fragmentShader );
+        glLinkProgram( program );
+        glDeleteShader( vertexShader );
+        glDeleteShader( fragmentShader );
+        if ( !linked( program ) )
+        {
+            GLint length = 0;
+            glGetProgramiv( program, GL_INFO_LOG_LENGTH, &length );
+            std::string log( size_t( std::max( length, 1 ) ), '\0' );
+            glGetProgramInfoLog( program, length, nullptr, log.data( ) );
+            glDeleteProgram( program );
+            throw std::runtime_error( "Error, linking " + vertexName + " and " + fragmentName + " failed: " + log.c_str( ) );
+        }
+        if ( !cachePath.empty( ) )
+        {
+            storeBinary( program, cachePath );
+        }
+    }
+    linkSeconds_ = std::chrono::duration< double >( std::chrono::steady_clock::now( ) - start ).count( );
+    return program;
+}
+
+// 0 when there is no binary or the driver rejects it
+GLuint ShaderLibrary::loadBinary( const std::filesystem::path& path ){
+    std::ifstream file( path, std::ios::binary );
+    uint32_t format = 0;
+    if ( !file.read( reinterpret_cast< char* >( &format ), sizeof( format ) ) )
+    {
+        return 0;
+    }
+    std::vector< char > binary( ( std::istreambuf_iterator< char >( file ) ), std::istreambuf_iterator< char >( ) );
+    if ( binary.empty( ) )
+    {
+        return 0;
+    }
+    GLuint program = glCreateProgram( );
+    glProgramBinary( program, GLenum( format ), binary.data( ), GLsizei( binary.size( ) ) );
+    if ( !linked( program ) )
+    {
+        glDeleteProgram( program );
+        return 0;
+    }
+    return program;
+}
+
+// written to a temporary file and renamed, so concurrent starts never read half a binary
+void ShaderLibrary::storeBinary( GLuint program, const std::filesystem::path& path ){
+    GLint length = 0;
+    glGetProgramiv( program, GL_PROGRAM_BINARY_LENGTH, &length );
+    if ( length <= 0 )
+    {
+        return;
+    }
+    std::vector< char > binary( static_cast< size_t >( length ) );
+    GLenum format = 0;
+    glGetProgramBinary( program, length, nullptr, &format, binary.data( ) );
+
+    std::error_code error;
+    std::filesystem::create_directories( path.parent_path( ), error );
+    std::filesystem::path temporary = path;
+    temporary += ".tmp";
+    {
+        std::ofstream file( temporary, std::ios::binary );
+        uint32_t header = uint32_t( format );
+        file.write( reinterpret_cast< const char* >( &header ), sizeof( header ) );
+        file.write( binary.data( ), std::streamsize( binary.size( ) ) );
+        if ( !file )
+        {
+            // a read-only cache only costs the faster start
+            std::cerr << "cannot write the shader cache " << temporary.string( ) << std::endl;
+            return;
+        }
+    }
+    std::filesystem::rename( temporary, path, error );
+}
+
+bool ShaderLibrary::changed( ){
+    if ( watched_.empty( ) )
+    {
+        return false;
+    }
+    auto now = std::chrono::steady_clock::now( );
+    if ( now - lastCheck_ < std::chrono::milliseconds( 500 ) )
+    {
+        return false;
+    }
+    lastCheck_ = now;
+    for ( const auto& [ path, time ] : watched_ )
+    {
+        std::error_code error;
+        std::filesystem::file_time_type current = std::filesystem::last_write_time( path, error );
+        if ( !error && current != time )
+        {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,108 @@
+#include "shadowing.h"
+
+#include <stdexcept>
+
+#include "parallel.h"
+
+namespace {
+
+// barycentric centers of the subdivisions^2 triangles of a regular split
+std::vector< glm::vec2 > samplePattern( int subdivisions ){
+    std::vector< glm::vec2 > samples;
+    float size = 1.0f / float( subdivisions );
+    for ( int i = 0; i < subdivisions; i++ )
+    {
+        for ( int j = 0; i + j < subdivisions; j++ )
+        {
+            samples.push_back( glm::vec2( size * ( float( i ) + 1.0f / 3.0f ), size * ( float( j ) + 1.0f / 3.0f ) ) );
+            if ( i + j < subdivisions - 1 )
+            {
+                samples.push_back( glm::vec2( size * ( float( i ) + 2.0f / 3.0f ), size * ( float( j ) + 2.0f / 3.0f ) ) );
+            }
+        }
+    }
+    return samples;
+}
+
+} // namespace
+
+void traceShadows( const TriangleBVH& bvh, const glm::vec3& sun, std::vector< float >& shadow,
+    const ShadowSettings& settings, int numberOfThreads ){
+
+    if ( glm::dot( sun, sun ) == 0.0f )
+    {
+        throw std::runtime_error( "Error, the sun vector is zero!" );
+    }
+    if ( settings.subdivisions_ < 1 )
+    {
+        throw std::runtime_error( "Error, at least one shadow sample per triangle is needed!" );
+    }
+    const MeshGeometry& mesh = *bvh.geometry( );
+    const std::vector< uint32_t >& order = bvh.leafOrder( );
+    glm::vec3 direction = glm::normalize( sun );
+    float offset = settings.offset_ * glm::length( bvh.upper( ) - bvh.lower( ) );
+    std::vector< glm::vec2 > samples = samplePattern( settings.subdivisions_ );
+    float weight = 1.0f / float( samples.size( ) );
+    shadow.assign( order.size( ), 0.0f );
+
+    // every chunk of the leaf order is spatially compact, so the rays of a packet stay coherent
+    const int chunkSize = 4096;
+    int numberOfChunks = int( ( order.size( ) + chunkSize - 1 ) / chunkSize );
+    parallelFor( numberOfChunks, [&]( int chunk ){
+        RayPacket packet;
+        packet.direction_ = direction;
+        uint32_t owners[ rayPacketSize ];
+        int size = 0;
+        auto trace = [&]( ){
+            packet.active_ = ( 1u << size ) - 1u;
+            uint32_t hits = bvh.occluded( packet );
+            for ( int r = 0; r < size; r++ )
+            {
+                if ( hits & ( 1u << r ) )
+                {
+                    shadow[ owners[ r ] ] += weight;
+                }
+            }
+            size = 0;
+        };
+
+        size_t end = std::min( order.size( ), size_t( chunk + 1 ) * chunkSize );
+        for ( size_t i = size_t( chunk ) * chunkSize; i < end; i++ )
+        {
+            uint32_t t = order[ i ];
+            const glm::vec3& a = mesh.positions_[ mesh.indices_[ 3*t ] ];
+            glm::vec3 edge1 = mesh.positions_[ mesh.indices_[ 3*t + 1 ] ] - a;
+            glm::vec3 edge2 = mesh.positions_[ mesh.indices_[ 3*t + 2 ] ] - a;
+            glm::vec3 normal = glm::cross( edge1, edge2 );
+            float facing = glm::dot( normal, direction );
+            if ( facing <= 0.0f && settings.backFacesShadowed_ )
+            {
+                shadow[ t ] = 1.0f;
+                continue;
+            }
+            float length = glm::length( normal );
+            if ( length == 0.0f )
+            {
+                continue;
+            }
+            // lifted off the side that faces the sun
+            glm::vec3 lift = normal * ( ( facing < 0.0f ? -offset : offset ) / length );
+            for ( const glm::vec2& sample : samples )
+            {
+                glm::vec3 origin = a + sample.x * edge1 + sample.y * edge2 + lift;
+                packet.x_[ size ] = origin.x;
+                packet.y_[ size ] = origin.y;
+                packet.z_[ size ] = origin.z;
+                owners[ size ] = t;
+                if ( ++size == rayPacketSize )
+                {
+                    trace( );
+                }
+            }
+        }
+        if ( size > 0 )
+        {
+            trace( );
+        }
+    }, numberOfThreads );
+}
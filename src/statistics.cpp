@@ -0,0 +1,166 @@
+#include "statistics.h"
+
+#include <algorithm>
+#include <limits>
+
+const char* rangeModeName( RangeMode mode ){
+    switch ( mode )
+    {
+        case RangeMode::GLOBAL: return "global";
+        case RangeMode::TIMESTEP: return "timestep";
+        case RangeMode::PERCENTILE: return "percentile";
+        default: return "unknown";
+    }
+}
+
+ValueRange reduceRange( const float* values, size_t count ){
+
+    // a comparison with NaN is false, so NaNs never replace a lane value
+    constexpr size_t lanes = 16;
+    float lower[ lanes ];
+    float upper[ lanes ];
+    std::fill( lower, lower + lanes, std::numeric_limits< float >::infinity( ) );
+    std::fill( upper, upper + lanes, -std::numeric_limits< float >::infinity( ) );
+
+    size_t i = 0;
+    for ( ; i + lanes <= count; i += lanes )
+    {
+        for ( size_t k = 0; k < lanes; k++ )
+        {
+            float value = values[ i + k ];
+            lower[ k ] = value < lower[ k ] ? value : lower[ k ];
+            upper[ k ] = value > upper[ k ] ? value : upper[ k ];
+        }
+    }
+    for ( size_t k = 0; i < count; i++, k++ )
+    {
+        float value = values[ i ];
+        lower[ k ] = value < lower[ k ] ? value : lower[ k ];
+        upper[ k ] = value > upper[ k ] ? value : upper[ k ];
+    }
+
+    ValueRange range{ lower[ 0 ], upper[ 0 ] };
+    for ( size_t k = 1; k < lanes; k++ )
+    {
+        range.min_ = std::min( range.min_, lower[ k ] );
+        range.max_ = std::max( range.max_, upper[ k ] );
+    }
+    if ( range.min_ > range.max_ )
+    {
+        // nothing but NaNs
+        return { 0.0f, 0.0f };
+    }
+    return range;
+}
+
+void RangeStatistics::reset( int timeSteps ){
+    steps_.clear( );
+    steps_.resize( size_t( std::max( timeSteps, 0 ) ) );
+    global_ = ValueRange( );
+    percentile_ = ValueRange( );
+}
+
+void RangeStatistics::add( int step, const float* values, size_t count ){
+
+    StepStatistics& statistics = steps_[ step ];
+    statistics.range_ = reduceRange( values, count );
+    statistics.histogram_.assign( histogramBins, 0 );
+    statistics.count_ = 0;
+
+    // the histogram spans the range of this step, finish( ) rebins it
+    float minimum = statistics.range_.min_;
+    float maximum = statistics.range_.max_;
+    float width = maximum - minimum;
+    float scale = width > 0.0f ? float( histogramBins ) / width : 0.0f;
+    uint32_t* histogram = statistics.histogram_.data( );
+    for ( size_t i = 0; i < count; i++ )
+    {
+        float value = values[ i ];
+        if ( value >= minimum && value <= maximum )
+        {
+            int bin = std::min( int( ( value - minimum ) * scale ), histogramBins - 1 );
+            histogram[ bin ]++;
+            statistics.count_++;
+        }
+    }
+}
+
+void RangeStatistics::finish( ){
+
+    bool first = true;
+    for ( const StepStatistics& statistics : steps_ )
+    {
+        if ( statistics.count_ == 0 )
+        {
+            continue;
+        }
+        global_.min_ = first ? statistics.range_.min_ : std::min( global_.min_, statistics.range_.min_ );
+        global_.max_ = first ? statistics.range_.max_ : std::max( global_.max_, statistics.range_.max_ );
+        first = false;
+    }
+    if ( first )
+    {
+        // no values at all, keep the defaults
+        percentile_ = global_;
+        return;
+    }
+
+    // every step bin moves to the global bin of its center, the error stays
+    // below one step bin, i.e. 1/256 of the range of that step
+    const int globalBins = 16 * histogramBins;
+    std::vector< uint64_t > histogram( globalBins, 0 );
+    float globalWidth = global_.max_ - global_.min_;
+    float globalScale = globalWidth > 0.0f ? float( globalBins ) / globalWidth : 0.0f;
+    uint64_t total = 0;
+    for ( StepStatistics& statistics : steps_ )
+    {
+        float binWidth = ( statistics.range_.max_ - statistics.range_.min_ ) / float( histogramBins );
+        for ( int bin = 0; bin < int( statistics.histogram_.size( ) ); bin++ )
+        {
+            uint32_t count = statistics.histogram_[ bin ];
+            if ( count == 0 )
+            {
+                continue;
+            }
+            float center = statistics.range_.min_ + ( float( bin ) + 0.5f ) * binWidth;
+            int globalBin = std::clamp( int( ( center - global_.min_ ) * globalScale ), 0, globalBins - 1 );
+            histogram[ globalBin ] += count;
+            total += count;
+        }
+        statistics.histogram_ = std::vector< uint32_t >( );
+    }
+
+    // value below which the given fraction of all values lies, linear within a bin
+    auto quantile = [&]( float fraction ){
+        double target = double( fraction ) * double( total );
+        uint64_t cumulative = 0;
+        for ( int bin = 0; bin < globalBins; bin++ )
+        {
+            if ( histogram[ bin ] > 0 && double( cumulative + histogram[ bin ] ) >= target )
+            {
+                double inside = ( target - double( cumulative ) ) / double( histogram[ bin ] );
+                return global_.min_ + float( ( bin + std::clamp( inside, 0.0, 1.0 ) ) / globalBins ) * globalWidth;
+            }
+            cumulative += histogram[ bin ];
+        }
+        return global_.max_;
+    };
+    percentile_ = { quantile( lowerPercentile_ ), quantile( upperPercentile_ ) };
+}
+
+ValueRange RangeStatistics::range( RangeMode mode, int step ) const {
+    if ( steps_.empty( ) )
+    {
+        return ValueRange( );
+    }
+    switch ( mode )
+    {
+        case RangeMode::TIMESTEP:
+        {
+            const StepStatistics& statistics = steps_[ std::clamp( step, 0, int( steps_.size( ) ) - 1 ) ];
+            return statistics.count_ > 0 ? statistics.range_ : global_;
+        }
+        case RangeMode::PERCENTILE: return percentile_;
+        default: return global_;
+    }
+}
@@ -0,0 +1,416 @@
+#include "streaming.h"
+
+#include <cctype>
+#include <cstring>
+#include <iterator>
+
+#include "parallel.h"
+
+namespace {
+
+// one pass over the file to find the non-empty lines, only the time column is parsed
+void indexLines( const MappedFile& file, std::vector< std::pair< size_t, size_t > >& lines, std::vector< double >& times ){
+
+    const char* begin = file.data( );
+    const char* end = begin + file.size( );
+    const char* line = begin;
+    std::vector< double > values;
+    while ( line < end )
+    {
+        const char* lineEnd = static_cast< const char* >( std::memchr( line, '\n', size_t( end - line ) ) );
+        lineEnd = lineEnd ? lineEnd : end;
+
+        const char* first = std::find_if( line, lineEnd, []( char c ){ return !std::isspace( static_cast< unsigned char >( c ) ); } );
+        if ( first != lineEnd )
+        {
+            const char* firstEnd = std::find_if( first, lineEnd, []( char c ){ return std::isspace( static_cast< unsigned char >( c ) ); } );
+            parseTextRow( first, firstEnd, values );
+            lines.push_back( { size_t( line - begin ), size_t( lineEnd - begin ) } );
+            times.push_back( values[ 0 ] );
+        }
+        line = lineEnd + 1;
+    }
+}
+
+} // namespace
+
+//
+// SOURCES
+//
+MeshData BinaryTimestepSource::load( int index, const std::shared_ptr< const MeshGeometry >& geometry ) const {
+    TimestepView timestep = dataset_.timestep( index );
+    return MeshData( timestep, geometry && geometry->matches( timestep ) ? geometry : nullptr );
+}
+
+void BinaryTimestepSource::loadTemperature( int index, std::vector< float >& temperature ) const {
+    TimestepView timestep = dataset_.timestep( index );
+    if ( timestep.temperature_ )
+    {
+        temperature.assign( timestep.temperature_, timestep.temperature_ + timestep.numberOfTriangles_ );
+    }
+    else
+    {
+        temperature.clear( );
+    }
+}
+
+void BinaryTimestepSource::loadTriangle( int index, int triangle, float& shadow, float& temperature ) const {
+    TimestepView timestep = dataset_.timestep( index );
+    bool valid = triangle >= 0 && triangle < timestep.numberOfTriangles_;
+    shadow = valid ? timestep.shadow_[ triangle ] : 0.0f;
+    temperature = valid && timestep.temperature_ ? timestep.temperature_[ triangle ] : 0.0f;
+}
+
+MeshData CompressedTimestepSource::load( int index, const std::shared_ptr< const MeshGeometry >& geometry ) const {
+    TimestepView timestep = dataset_.timestep( index );
+    MeshData mesh;
+    mesh.sunPosition_ = MeshData::bodyFrameSunPosition( timestep.header_ );
+    mesh.geometry_ = geometry && geometry->matches( timestep ) ? geometry : std::make_shared< const MeshGeometry >( timestep );
+    mesh.shadow_.resize( timestep.numberOfTriangles_ );
+    mesh.temperature_.resize( timestep.numberOfTriangles_ );
+    dataset_.decode( index, mesh.shadow_.data( ), mesh.temperature_.data( ) );
+    return mesh;
+}
+
+void CompressedTimestepSource::loadTemperature( int index, std::vector< float >& temperature ) const {
+    temperature.resize( hasTemperature( ) ? size_t( dataset_.numberOfTriangles( ) ) : 0 );
+    if ( hasTemperature( ) )
+    {
+        dataset_.decode( index, nullptr, temperature.data( ) );
+    }
+}
+
+void CompressedTimestepSource::loadTriangle( int index, int triangle, float& shadow, float& temperature ) const {
+    shadow = 0.0f;
+    temperature = 0.0f;
+    if ( triangle >= 0 && triangle < dataset_.numberOfTriangles( ) )
+    {
+        dataset_.decodeTriangle( index, triangle, shadow, temperature );
+    }
+}
+
+TextTimestepSource::TextTimestepSource( const std::string& path, const std::string& temperaturePath ) : file_( path ) {
+
+    indexLines( file_, lines_, times_ );
+    if ( !temperaturePath.empty( ) )
+    {
+        temperatureFile_ = MappedFile( temperaturePath );
+        std::vector< double > temperatureTimes;
+        indexLines( temperatureFile_, temperatureLines_, temperatureTimes );
+        if ( temperatureLines_.size( ) != lines_.size( ) )
+        {
+            throw std::runtime_error( "Error, " + temperaturePath + " has " + std::to_string( temperatureLines_.size( ) ) +
+                " timesteps but the mesh has " + std::to_string( lines_.size( ) ) );
+        }
+    }
+}
+
+MeshData TextTimestepSource::load( int index, const std::shared_ptr< const MeshGeometry >& geometry ) const {
+    std::vector< double > row;
+    parseTextRow( file_.data( ) + lines_[ index ].first, file_.data( ) + lines_[ index ].second, row );
+    std::vector< double > temperature;
+    if ( hasTemperature( ) )
+    {
+        parseTemperature( index, temperature );
+        checkTemperatureRow( temperature, row[ 0 ], int( ( row.size( ) - timestepHeaderSize ) / 10 ), index );
+    }
+    return MeshData( row, geometry && geometry->matches( row ) ? geometry : nullptr,
+        hasTemperature( ) ? temperature.data( ) + 1 : nullptr );
+}
+
+void TextTimestepSource::loadTemperature( int index, std::vector< float >& temperature ) const {
+    temperature.clear( );
+    if ( !hasTemperature( ) )
+    {
+        return;
+    }
+    std::vector< double > row;
+    parseTemperature( index, row );
+    temperature.reserve( row.size( ) );
+    std::transform( row.begin( ) + 1, row.end( ), std::back_inserter( temperature ), []( double value ){ return float( value ); } );
+}
+
+// text rows can only be parsed whole. Rows of steps with another geometry, and
+// short temperature rows, may not have the triangle, its values are then 0
+void TextTimestepSource::loadTriangle( int index, int triangle, float& shadow, float& temperature ) const {
+    std::vector< double > row;
+    parseTextRow( file_.data( ) + lines_[ index ].first, file_.data( ) + lines_[ index ].second, row );
+    size_t numberOfTriangles = row.size( ) > timestepHeaderSize ? ( row.size( ) - timestepHeaderSize ) / 10 : 0;
+    shadow = 0.0f;
+    temperature = 0.0f;
+    if ( triangle < 0 || size_t( triangle ) >= numberOfTriangles )
+    {
+        return;
+    }
+    shadow = float( row[ timestepHeaderSize + triangle ] );
+    if ( hasTemperature( ) )
+    {
+        parseTemperature( index, row );
+        if ( size_t( triangle ) + 1 < row.size( ) )
+        {
+            temperature = float( row[ 1 + triangle ] );
+        }
+    }
+}
+
+void TextTimestepSource::parseTemperature( int index, std::vector< double >& row ) const {
+    parseTextRow( temperatureFile_.data( ) + temperatureLines_[ index ].first,
+        temperatureFile_.data( ) + temperatureLines_[ index ].second, row );
+}
+
+std::unique_ptr< TimestepSource > openTimestepSource( const std::string& path, const std::string& temperaturePath ){
+    if ( BinaryDataset::isBinaryDataset( path ) )
+    {
+        if ( !temperaturePath.empty( ) )
+        {
+            throw std::runtime_error( "Error, temperatures of a binary dataset are added by scrt-convert --temperature" );
+        }
+        return std::make_unique< BinaryTimestepSource >( path );
+    }
+    if ( CompressedDataset::isCompressedDataset( path ) )
+    {
+        if ( !temperaturePath.empty( ) )
+        {
+            throw std::runtime_error( "Error, temperatures of a compressed dataset are added by scrt-convert --temperature" );
+        }
+        return std::make_unique< CompressedTimestepSource >( CompressedDataset( path ) );
+    }
+    return std::make_unique< TextTimestepSource >( path, temperaturePath );
+}
+
+CompressedDataset compressTimestepSource( const TimestepSource& source, const CodecSettings& settings, int numberOfThreads ){
+
+    if ( numberOfThreads <= 0 )
+    {
+        numberOfThreads = hardwareThreads( );
+    }
+    if ( source.timeSteps( ) == 0 )
+    {
+        throw std::runtime_error( "Error, mesh does not contain any timestep!" );
+    }
+    // the first step provides the geometry shared with every matching step
+    std::vector< MeshData > batch( 1 );
+    batch[ 0 ] = source.load( 0, nullptr );
+    std::shared_ptr< const MeshGeometry > geometry = batch[ 0 ].geometry_;
+    CompressedDatasetWriter writer( "", batch[ 0 ].numberOfTriangles( ), source.hasTemperature( ), settings );
+    std::vector< float > positions;
+    const MeshGeometry* written = nullptr;
+
+    int step = 0;
+    while ( step < source.timeSteps( ) )
+    {
+        for ( const MeshData& mesh : batch )
+        {
+            const glm::vec3& sun = mesh.sunPosition_;
+            double header[ timestepHeaderSize ] = { source.time( step++ ), sun.x, sun.y, sun.z,
+                                                    1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0 };
+            bool changed = mesh.geometry_.get( ) != written;
+            if ( changed )
+            {
+                // corners of every triangle, as in a mesh.txt row
+                const MeshGeometry& corners = *mesh.geometry_;
+                positions.resize( 3 * corners.indices_.size( ) );
+                for ( size_t k = 0; k < corners.indices_.size( ); k++ )
+                {
+                    const glm::vec3& position = corners.positions_[ corners.indices_[ k ] ];
+                    positions[ 3*k ] = position.x;
+                    positions[ 3*k + 1 ] = position.y;
+                    positions[ 3*k + 2 ] = position.z;
+                }
+                written = mesh.geometry_.get( );
+            }
+            writer.write( header, mesh.shadow_.data( ), source.hasTemperature( ) ? mesh.temperature_.data( ) : nullptr,
+                changed ? positions.data( ) : nullptr );
+        }
+        batch.resize( size_t( std::min( numberOfThreads, source.timeSteps( ) - step ) ) );
+        parallelFor( int( batch.size( ) ), [&]( int i ){
+            batch[ i ] = source.load( step + i, geometry );
+        }, numberOfThreads );
+    }
+    return CompressedDataset( writer.release( ) );
+}
+
+void computeTemperatureStatistics( const TimestepSource& source, RangeStatistics& statistics, int numberOfThreads ){
+
+    statistics.reset( source.hasTemperature( ) ? source.timeSteps( ) : 0 );
+    if ( !source.hasTemperature( ) )
+    {
+        return;
+    }
+    // compressed sources decode a step fastest right after the one before it
+    const int chunkSize = 16;
+    parallelFor( ( source.timeSteps( ) + chunkSize - 1 ) / chunkSize, [&]( int chunk ){
+        std::vector< float > temperature;
+        for ( int i = chunk * chunkSize; i < std::min( ( chunk + 1 ) * chunkSize, source.timeSteps( ) ); i++ )
+        {
+            source.loadTemperature( i, temperature );
+            statistics.add( i, temperature.data( ), temperature.size( ) );
+        }
+    }, numberOfThreads );
+    statistics.finish( );
+}
+
+//
+// CACHE
+//
+TimestepCache::TimestepCache( std::unique_ptr< TimestepSource > source, int capacity, int prefetchDepth,
+    std::shared_ptr< const MeshGeometry > geometry ) :
+    source_( std::move( source ) ),
+    capacity_( std::max( capacity, 2 ) ),
+    prefetchDepth_( prefetchDepth ) {
+
+    if ( source_->timeSteps( ) == 0 )
+    {
+        throw std::runtime_error( "Error, mesh does not contain any timestep!" );
+    }
+
+    // the first timestep provides the geometry shared with every matching step,
+    // unless it matches the one given
+    auto first = std::make_shared< const MeshData >( source_->load( 0, geometry ) );
+    geometry_ = first->geometry_;
+    insert( 0, first );
+
+    worker_ = std::thread( &TimestepCache::run, this );
+}
+
+TimestepCache::~TimestepCache( ){
+    {
+        std::lock_guard< std::mutex > lock( mutex_ );
+        stop_ = true;
+    }
+    wake_.notify_all( );
+    worker_.join( );
+}
+
+std::shared_ptr< const MeshData > TimestepCache::get( int index ){
+
+    std::unique_lock< std::mutex > lock( mutex_ );
+    auto entry = entries_.find( index );
+    if ( entry == entries_.end( ) && loading_.count( index ) )
+    {
+        // the prefetch thread is already on it, waiting is cheaper than loading twice
+        loaded_.wait( lock, [&]( ){ return loading_.count( index ) == 0; } );
+        entry = entries_.find( index );
+    }
+    if ( entry != entries_.end( ) )
+    {
+        hits_++;
+        recentlyUsed_.splice( recentlyUsed_.begin( ), recentlyUsed_, entry->second.position_ );
+        return entry->second.mesh_;
+    }
+
+    misses_++;
+    loading_.insert( index );
+    lock.unlock( );
+    std::shared_ptr< const MeshData > mesh;
+    try
+    {
+        mesh = std::make_shared< const MeshData >( source_->load( index, geometry_ ) );
+    }
+    catch ( ... )
+    {
+        lock.lock( );
+        loading_.erase( index );
+        loaded_.notify_all( );
+        throw;
+    }
+    lock.lock( );
+    loading_.erase( index );
+    insert( index, mesh );
+    loaded_.notify_all( );
+    return mesh;
+}
+
+std::shared_ptr< const MeshData > TimestepCache::peek( int index ){
+    std::lock_guard< std::mutex > lock( mutex_ );
+    auto entry = entries_.find( index );
+    return entry != entries_.end( ) ? entry->second.mesh_ : nullptr;
+}
+
+void TimestepCache::prefetch( int index, int direction ){
+
+    std::lock_guard< std::mutex > lock( mutex_ );
+    // steps queued for an older slider position are no longer interesting
+    queue_.clear( );
+    // never prefetch so far ahead that the current step gets evicted
+    int depth = std::min( prefetchDepth_, capacity_ - 1 );
+    for ( int k = 1; k <= depth; k++ )
+    {
+        int next = index + k * direction;
+        if ( next < 0 || next >= source_->timeSteps( ) )
+        {
+            break;
+        }
+        if ( !entries_.count( next ) && !loading_.count( next ) )
+        {
+            queue_.push_back( next );
+        }
+    }
+    wake_.notify_one( );
+}
+
+void TimestepCache::setCapacity( int capacity ){
+    std::lock_guard< std::mutex > lock( mutex_ );
+    capacity_ = std::max( capacity, 2 );
+    evict( );
+}
+
+int TimestepCache::resident( ){
+    std::lock_guard< std::mutex > lock( mutex_ );
+    return int( entries_.size( ) );
+}
+
+void TimestepCache::insert( int index, std::shared_ptr< const MeshData > mesh ){
+    recentlyUsed_.push_front( index );
+    entries_[ index ] = { std::move( mesh ), recentlyUsed_.begin( ) };
+    evict( );
+}
+
+void TimestepCache::evict( ){
+    // meshes still held by the renderer stay alive through their shared_ptr
+    while ( int( entries_.size( ) ) > capacity_ )
+    {
+        entries_.erase( recentlyUsed_.back( ) );
+        recentlyUsed_.pop_back( );
+    }
+}
+
+void TimestepCache::run( ){
+
+    std::unique_lock< std::mutex > lock( mutex_ );
+    while ( true )
+    {
+        wake_.wait( lock, [&]( ){ return stop_ || !queue_.empty( ); } );
+        if ( stop_ )
+        {
+            return;
+        }
+        int index = queue_.front( );
+        queue_.pop_front( );
+        if ( entries_.count( index ) || loading_.count( index ) )
+        {
+            continue;
+        }
+
+        loading_.insert( index );
+        lock.unlock( );
+        std::shared_ptr< const MeshData > mesh;
+        try
+        {
+            mesh = std::make_shared< const MeshData >( source_->load( index, geometry_ ) );
+        }
+        catch ( const std::exception& error )
+        {
+            // a failing step is reported again when the viewer asks for it
+            std::cerr << "prefetch of timestep " << index << " failed: " << error.what( ) << std::endl;
+        }
+        lock.lock( );
+        loading_.erase( index );
+        if ( mesh )
+        {
+            insert( index, std::move( mesh ) );
+            prefetched_++;
+        }
+        loaded_.notify_all( );
+    }
+}
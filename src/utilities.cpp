@@ -1,152 +1,627 @@
 #include "utilities.h"
+#include "lod.h"
 
+#include <limits>
+#include <unordered_map>
 
-std::string loadShaderSource(const std::string& filepath) {
-    std::ifstream file(filepath);
-    if (!file.is_open()) {
-        throw std::runtime_error("Failed to open shader file: " + filepath);
+
+//
+// GEOMETRY
+//
+MeshGeometry::MeshGeometry( const std::vector< double >& mesh ){
+    int numberOfTriangles = int( ( mesh.size( ) - timestepHeaderSize ) / 10 );
+    weld( mesh.data( ) + timestepHeaderSize + numberOfTriangles, numberOfTriangles );
+}
+
+MeshGeometry::MeshGeometry( const TimestepView& timestep ){
+    weld( timestep.positions_, timestep.numberOfTriangles_ );
+}
+
+bool MeshGeometry::matches( const std::vector< double >& mesh ) const {
+    int numberOfTriangles = int( ( mesh.size( ) - timestepHeaderSize ) / 10 );
+    return matches( mesh.data( ) + timestepHeaderSize + numberOfTriangles, numberOfTriangles );
+}
+
+bool MeshGeometry::matches( const TimestepView& timestep ) const {
+    return matches( timestep.positions_, timestep.numberOfTriangles_ );
+}
+
+template< typename T >
+void MeshGeometry::weld( const T* positions, int numberOfTriangles ){
+
+    size_t numberOfCorners = 3 * size_t( numberOfTriangles );
+    auto corner = [&]( size_t k ){
+        return glm::vec3( float(positions[ 3*k ]), float(positions[ 3*k + 1 ]), float(positions[ 3*k + 2 ]) );
+    };
+
+    glm::vec3 minimum( std::numeric_limits< float >::max( ) );
+    glm::vec3 maximum( -std::numeric_limits< float >::max( ) );
+    for ( size_t k = 0; k < numberOfCorners; k++ ){
+        minimum = glm::min( minimum, corner( k ) );
+        maximum = glm::max( maximum, corner( k ) );
     }
-    
-    std::stringstream buffer;
-    buffer << file.rdbuf();
 
-    return buffer.str();
+    // 2^21 cells per axis, so a quantized position packs into one 64 bit key
+    const float cells = float( ( 1 << 21 ) - 1 );
+    glm::vec3 extent = maximum - minimum;
+    float size = std::max( { extent.x, extent.y, extent.z, std::numeric_limits< float >::min( ) } );
+    weldTolerance_ = size / cells;
+
+    std::unordered_map< uint64_t, uint32_t > unique;
+    unique.reserve( numberOfCorners / 2 );
+    positions_.clear( );
+    positions_.reserve( numberOfCorners / 2 );
+    indices_.resize( numberOfCorners );
+    for ( size_t k = 0; k < numberOfCorners; k++ ){
+        glm::vec3 position = corner( k );
+        glm::vec3 cell = glm::round( ( position - minimum ) / weldTolerance_ );
+        uint64_t key = ( uint64_t( cell.x ) << 42 ) | ( uint64_t( cell.y ) << 21 ) | uint64_t( cell.z );
+        auto [ entry, inserted ] = unique.emplace( key, uint32_t( positions_.size( ) ) );
+        if ( inserted ){
+            positions_.push_back( position );
+        }
+        indices_[ k ] = entry->second;
+    }
+    positions_.shrink_to_fit( );
 }
 
-GLuint compileShaderFromFile(const std::string& filepath, GLenum type) {
-    std::string code = loadShaderSource(filepath);
-    const char* source = code.c_str();
-    
-    GLuint shader = glCreateShader(type);
-    glShaderSource(shader, 1, &source, NULL);
-    glCompileShader(shader);
-    
-    return shader;
+template< typename T >
+bool MeshGeometry::matches( const T* positions, int numberOfTriangles ) const {
+    if ( 3 * size_t( numberOfTriangles ) != indices_.size( ) ){
+        return false;
+    }
+    for ( size_t k = 0; k < indices_.size( ); k++ ){
+        glm::vec3 position( float(positions[ 3*k ]), float(positions[ 3*k + 1 ]), float(positions[ 3*k + 2 ]) );
+        glm::vec3 difference = glm::abs( position - positions_[ indices_[ k ] ] );
+        if ( std::max( { difference.x, difference.y, difference.z } ) > weldTolerance_ ){
+            return false;
+        }
+    }
+    return true;
 }
 
 
-void Renderer::checkShaderCompile(GLuint shader){
-    int success;
-    char infoLog[512];
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(shader, 512, NULL, infoLog);
-        throw std::runtime_error("Shader compilation failed: " + std::string(infoLog));
+// links the program and looks up its uniforms, the program is only replaced
+// when linking succeeded
+void Renderer::buildProgram( ){
+
+    GLuint program = shaders_.link( "vertex_shader.glsl", "fragment_shader.glsl" );
+    if ( shaderProgram_ ){
+        state_.forgetProgram( shaderProgram_ );
+        glDeleteProgram(shaderProgram_);
+    }
+    shaderProgram_ = program;
+
+    visualizationModeLocation_ = glGetUniformLocation(shaderProgram_, "visualizationMode");
+    wireframeColorLocation_ = glGetUniformLocation(shaderProgram_, "wireframeColor");
+    interpolationWeightLocation_ = glGetUniformLocation(shaderProgram_, "interpolationWeight");
+    wireframeWidthLocation_ = glGetUniformLocation(shaderProgram_, "wireframeWidth");
+    temperatureRangeLocation_ = glGetUniformLocation(shaderProgram_, "temperatureRange");
+    temperatureEncodingLocation_ = glGetUniformLocation(shaderProgram_, "temperatureEncoding");
+    positionOffsetLocation_ = glGetUniformLocation(shaderProgram_, "positionOffset");
+    positionScaleLocation_ = glGetUniformLocation(shaderProgram_, "positionScale");
+    positionStrideLocation_ = glGetUniformLocation(shaderProgram_, "positionStride");
+    useTriangleMapLocation_ = glGetUniformLocation(shaderProgram_, "useTriangleMap");
+    differenceLocation_ = glGetUniformLocation(shaderProgram_, "difference");
+    differenceRangeLocation_ = glGetUniformLocation(shaderProgram_, "differenceRange");
+
+    // linking, or loading a cached binary, resets the block bindings
+    GLuint cameraIndex = glGetUniformBlockIndex(shaderProgram_, "Camera");
+    if ( cameraIndex != GL_INVALID_INDEX ){
+        glUniformBlockBinding(shaderProgram_, cameraIndex, cameraBinding);
+    }
+
+    state_.useProgram( shaderProgram_ );
+    const char* samplers[ 8 ] = { "shadowBuffer", "temperatureBuffer", "nextShadowBuffer", "nextTemperatureBuffer",
+        "positionBuffer", "indexBuffer", "colormap", "triangleMap" };
+    for ( int unit = 0; unit < 8; unit++ ){
+        state_.uniform( glGetUniformLocation(shaderProgram_, samplers[ unit ]), unit );
     }
 }
 
-void Renderer::checkProgramLink(GLuint program){
-    int success;
-    char infoLog[512];
-    glGetProgramiv(program, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(program, 512, NULL, infoLog);
-        throw std::runtime_error("Program linking failed: " + std::string(infoLog));
+bool Renderer::reloadShaders( bool force ){
+    if ( !force && !shaders_.changed( ) ){
+        return false;
+    }
+    try {
+        buildProgram( );
+        std::cout << "shaders linked from " << ( shaders_.directory_.empty( ) ? "the executable" : shaders_.directory_ ) << std::endl;
+        return true;
+    }
+    catch ( const std::exception& error ) {
+        // the last working program stays in use until the file is fixed
+        std::cerr << error.what( ) << std::endl;
+        return false;
     }
 }
 
 void Renderer::init( ){
 
-    // create shaders
-    GLuint vertexShader = compileShaderFromFile("shaders/vertex_shader.glsl", GL_VERTEX_SHADER);
-    GLuint fragmentShader = compileShaderFromFile("shaders/fragment_shader.glsl", GL_FRAGMENT_SHADER);
-
-    shaderProgram_ = glCreateProgram();
-    glAttachShader(shaderProgram_, vertexShader);
-    glAttachShader(shaderProgram_, fragmentShader);
-    glLinkProgram(shaderProgram_);
-    checkProgramLink(shaderProgram_);
+    // another context or renderer may have left anything bound
+    state_.invalidate( );
+    cameraValid_ = false;
 
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    // create shaders
+    buildProgram( );
+    if ( shaders_.fromCache_ ){
+        std::cout << "shaders loaded from the program cache in " << 1000.0 * shaders_.linkSeconds_ << " ms" << std::endl;
+    }
 
     //
     // MESH BUFFERS
     //
     glGenVertexArrays(1, &VAO_);
     glGenBuffers(1, &VBO_); 
+    glGenBuffers(1, &EBO_); 
 
-    glBindVertexArray(VAO_);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_);
+    state_.bindVertexArray( VAO_ );
+    state_.bindBuffer( GL_ARRAY_BUFFER, VBO_ );
+    state_.bindBuffer( GL_ELEMENT_ARRAY_BUFFER, EBO_ );
         
-    // position attirbute
+    // position attirbute, shadow and temperature are per triangle and live in buffer textures
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 
-                            sizeof(Vertex),
-                            (void*)offsetof(Vertex, position_));
+                            sizeof(glm::vec3),
+                            (void*)0);
     glEnableVertexAttribArray(0);
-        
-    // shadow attribute
-    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE,
-                            sizeof(Vertex),
-                            (void*)offsetof(Vertex, shadow_));
-    glEnableVertexAttribArray(1);
 
-    // temperature attribute
-    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE,
-                            sizeof(Vertex),
-                            (void*)offsetof(Vertex, temperature_));
-    glEnableVertexAttribArray(2);
-    glBindVertexArray(0);
+    // the fragment shader reads triangle corners through these, they follow
+    // every reallocation of the buffers
+    glGenTextures(1, &positionTexture_);
+    state_.bindTexture( 0, GL_TEXTURE_BUFFER, positionTexture_ );
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, VBO_);
+    glGenTextures(1, &indexTexture_);
+    state_.bindTexture( 0, GL_TEXTURE_BUFFER, indexTexture_ );
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, EBO_);
 
+    // view, projection and viewport of both shader stages, bound once
+    glGenBuffers(1, &cameraBuffer_);
+    state_.bindBuffer( GL_UNIFORM_BUFFER, cameraBuffer_ );
+    state_.bufferData( GL_UNIFORM_BUFFER, sizeof( CameraBlock ), nullptr, GL_DYNAMIC_DRAW );
+    state_.bindBufferBase( GL_UNIFORM_BUFFER, cameraBinding, cameraBuffer_ );
 
-    visualizationModeLocation_ = glGetUniformLocation(shaderProgram_, "visualizationMode");
-    wireframeColorLocation_ = glGetUniformLocation(shaderProgram_, "wireframeColor");
+    // the original colors for the shadow fraction, a diverging map for temperatures
+    colormaps_.init( );
+    shadowColormap_ = colormaps_.find( "white-red" );
+    temperatureColormap_ = colormaps_.find( "coolwarm" );
+    differenceColormap_ = colormaps_.find( "coolwarm" );
+
+}
+
+void Renderer::release( ){
+    for ( auto& timestep : resident_ ){
+        glDeleteTextures(2, timestep.textures_);
+        glDeleteBuffers(2, timestep.buffers_);
+    }
+    resident_.clear( );
+    releaseLevels( );
+    colormaps_.release( );
+    glDeleteTextures(1, &positionTexture_);
+    glDeleteTextures(1, &indexTexture_);
+    glDeleteVertexArrays(1, &VAO_);
+    glDeleteBuffers(1, &VBO_);
+    glDeleteBuffers(1, &EBO_);
+    glDeleteBuffers(1, &cameraBuffer_);
+    state_.forgetProgram( shaderProgram_ );
+    glDeleteProgram(shaderProgram_);
+    shaderProgram_ = 0;
+    state_.invalidate( );
+    cameraValid_ = false;
+}
+
+void Renderer::checkFormat( ){
+
+    bool changed = compactVertices_ != residentCompact_ ||
+        ( compactVertices_ && ( packedTemperatureRange_.min_ != residentTemperatureRange_.min_ ||
+                                packedTemperatureRange_.max_ != residentTemperatureRange_.max_ ) );
+    if ( !changed ){
+        return;
+    }
+    // slots being staged are checked when they are committed
+    for ( auto& slot : resident_ ){
+        if ( !slot.mapped_ ){
+            slot.revision_ = 0;
+        }
+    }
+    geometryRevision_ = 0;
+    residentCompact_ = compactVertices_;
+    residentTemperatureRange_ = packedTemperatureRange_;
+}
+
+void Renderer::releaseLevels( ){
+    for ( LevelBuffers& level : levelBuffers_ ){
+        GLuint buffers[ 2 ] = { level.elements_, level.triangles_ };
+        GLuint textures[ 2 ] = { level.indexTexture_, level.triangleTexture_ };
+        glDeleteBuffers(2, buffers);
+        glDeleteTextures(2, textures);
+    }
+    if ( !levelBuffers_.empty( ) ){
+        state_.invalidate( );
+    }
+    levelBuffers_.clear( );
+    uploadedLevels_.reset( );
+}
+
+int Renderer::selectLevel( const MeshGeometry& geometry, const glm::mat4& view, const glm::mat4& projection, float viewportHeight ){
+
+    if ( !levelOfDetail_ || !levelsOfDetail_ || levelsOfDetail_->geometryRevision_ != geometry.revision_ ){
+        return -1;
+    }
+    if ( uploadedLevels_ != levelsOfDetail_ ){
+        releaseLevels( );
+        for ( const DetailLevel& level : levelsOfDetail_->levels_ ){
+            LevelBuffers buffers;
+            glGenBuffers(1, &buffers.elements_);
+            glGenBuffers(1, &buffers.triangles_);
+            glGenTextures(1, &buffers.indexTexture_);
+            glGenTextures(1, &buffers.triangleTexture_);
+            // uploaded through the texture buffer binding, the element binding belongs to the VAO
+            size_t indexBytes = level.indices_.size( ) * sizeof(uint32_t);
+            size_t triangleBytes = level.triangles_.size( ) * sizeof(uint32_t);
+            state_.bindBuffer( GL_TEXTURE_BUFFER, buffers.elements_ );
+            state_.bufferData( GL_TEXTURE_BUFFER, indexBytes, level.indices_.data(), GL_STATIC_DRAW );
+            state_.bindBuffer( GL_TEXTURE_BUFFER, buffers.triangles_ );
+            state_.bufferData( GL_TEXTURE_BUFFER, triangleBytes, level.triangles_.data(), GL_STATIC_DRAW );
+            state_.bindTexture( 0, GL_TEXTURE_BUFFER, buffers.indexTexture_ );
+            glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, buffers.elements_);
+            state_.bindTexture( 0, GL_TEXTURE_BUFFER, buffers.triangleTexture_ );
+            glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, buffers.triangles_);
+            state_.count( 6 );
+            buffers.numberOfIndices_ = GLsizei( level.indices_.size( ) );
+            levelBuffers_.push_back( buffers );
+            uploadedBytes_ += indexBytes + triangleBytes;
+        }
+        uploadedLevels_ = levelsOfDetail_;
+    }
+    return levelsOfDetail_->select( view, projection, viewportHeight, lodPixelError_ );
+}
+
+// buffer texture format and bytes per triangle of shadow (0) and temperature (1)
+GLenum Renderer::attributeFormat( int attribute ) const {
+    return !residentCompact_ ? GL_R32F : attribute == 0 ? GL_R8 : GL_R16;
+}
+
+size_t Renderer::attributeSize( int attribute ) const {
+    return !residentCompact_ ? sizeof(float) : attribute == 0 ? sizeof(uint8_t) : sizeof(uint16_t);
+}
+
+void Renderer::StagingSlot::write( const MeshData& mesh ) const {
+    if ( compact_ ){
+        packShadow( mesh.shadow_.data( ), numberOfTriangles_, static_cast< uint8_t* >( shadow_ ) );
+        packTemperature( mesh.temperature_.data( ), numberOfTriangles_, temperatureRange_, static_cast< uint16_t* >( temperature_ ) );
+    }
+    else {
+        std::memcpy( shadow_, mesh.shadow_.data( ), numberOfTriangles_ * sizeof( float ) );
+        std::memcpy( temperature_, mesh.temperature_.data( ), numberOfTriangles_ * sizeof( float ) );
+    }
+}
 
+void Renderer::uploadGeometry( const MeshGeometry& geometry ){
+
+    // positions only change with the geometry, not with the timestep
+    if ( geometry.revision_ == geometryRevision_ ){
+        return;
+    }
+    state_.bindBuffer( GL_ARRAY_BUFFER, VBO_ );
+    size_t positionBytes;
+    if ( residentCompact_ ){
+        QuantizedPositions quantized( geometry.positions_ );
+        positionBytes = quantized.values_.size() * sizeof(uint16_t);
+        state_.bufferData( GL_ARRAY_BUFFER, positionBytes, quantized.values_.data(), GL_STATIC_DRAW );
+        positionOffset_ = quantized.offset_;
+        positionScale_ = quantized.scale_;
+    }
+    else {
+        positionBytes = geometry.positions_.size() * sizeof(glm::vec3);
+        state_.bufferData( GL_ARRAY_BUFFER, positionBytes, geometry.positions_.data(), GL_STATIC_DRAW );
+        positionOffset_ = glm::vec3( 0.0f );
+        positionScale_ = glm::vec3( 1.0f );
+    }
+    // the element buffer binding is part of the VAO
+    state_.bindVertexArray( VAO_ );
+    state_.bindBuffer( GL_ELEMENT_ARRAY_BUFFER, EBO_ );
+    state_.bufferData( GL_ELEMENT_ARRAY_BUFFER,
+                       geometry.indices_.size() * sizeof(uint32_t),
+                       geometry.indices_.data(),
+                       GL_STATIC_DRAW );
+    // x, y, z and one padding value of 16 bit normalized, or 3 floats
+    if ( residentCompact_ ){
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, 4 * sizeof(uint16_t), (void*)0);
+    }
+    else {
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+    }
+    state_.bindTexture( 0, GL_TEXTURE_BUFFER, positionTexture_ );
+    glTexBuffer(GL_TEXTURE_BUFFER, residentCompact_ ? GL_R16 : GL_R32F, VBO_);
+    state_.count( 2 );
+    uploadedBytes_ += positionBytes + geometry.indices_.size() * sizeof(uint32_t);
+    geometryRevision_ = geometry.revision_;
+}
+
+int Renderer::acquireSlot( ){
+
+    if ( int( resident_.size( ) ) < std::max( residentTimesteps_, 2 ) ){
+        resident_.emplace_back( );
+        glGenBuffers(2, resident_.back( ).buffers_);
+        glGenTextures(2, resident_.back( ).textures_);
+        return int( resident_.size( ) ) - 1;
+    }
+
+    // recycle the least recently used slot that is neither being staged nor
+    // holding a timestep drawn in the current frame
+    int victim = -1;
+    for ( int i = 0; i < int( resident_.size( ) ); i++ ){
+        const ResidentTimestep& candidate = resident_[ i ];
+        if ( candidate.mapped_ || candidate.lastUsed_ == frame_ ){
+            continue;
+        }
+        if ( victim < 0 || candidate.lastUsed_ < resident_[ victim ].lastUsed_ ){
+            victim = i;
+        }
+    }
+    if ( victim < 0 ){
+        // every slot is busy, grow beyond the budget until the next trim
+        resident_.emplace_back( );
+        glGenBuffers(2, resident_.back( ).buffers_);
+        glGenTextures(2, resident_.back( ).textures_);
+        victim = int( resident_.size( ) ) - 1;
+    }
+    resident_[ victim ].revision_ = 0;
+    return victim;
+}
+
+int Renderer::residentAttributes( const MeshData& mesh ){
+
+    // already on the GPU, scrubbing back and forth lands here
+    for ( int i = 0; i < int( resident_.size( ) ); i++ ){
+        if ( resident_[ i ].revision_ == mesh.revision_ && !resident_[ i ].mapped_ ){
+            resident_[ i ].lastUsed_ = frame_;
+            return i;
+        }
+    }
+
+    int index = acquireSlot( );
+    ResidentTimestep& slot = resident_[ index ];
+    const void* attributes[ 2 ] = { mesh.shadow_.data( ), mesh.temperature_.data( ) };
+    std::vector< uint8_t > packedShadow;
+    std::vector< uint16_t > packedTemperature;
+    if ( residentCompact_ ){
+        packedShadow.resize( mesh.shadow_.size( ) );
+        packedTemperature.resize( mesh.temperature_.size( ) );
+        packShadow( mesh.shadow_.data( ), mesh.shadow_.size( ), packedShadow.data( ) );
+        packTemperature( mesh.temperature_.data( ), mesh.temperature_.size( ), residentTemperatureRange_, packedTemperature.data( ) );
+        attributes[ 0 ] = packedShadow.data( );
+        attributes[ 1 ] = packedTemperature.data( );
+    }
+    for ( int k = 0; k < 2; k++ ){
+        size_t bytes = size_t( mesh.numberOfTriangles( ) ) * attributeSize( k );
+        state_.bindBuffer( GL_TEXTURE_BUFFER, slot.buffers_[ k ] );
+        // orphan the old storage so the driver never waits for frames still reading it
+        state_.bufferData( GL_TEXTURE_BUFFER, bytes, nullptr, GL_STATIC_DRAW );
+        state_.bufferSubData( GL_TEXTURE_BUFFER, 0, bytes, attributes[ k ] );
+        state_.bindTexture( 0, GL_TEXTURE_BUFFER, slot.textures_[ k ] );
+        glTexBuffer(GL_TEXTURE_BUFFER, attributeFormat( k ), slot.buffers_[ k ]);
+        state_.count( 1 );
+        uploadedBytes_ += bytes;
+    }
+
+    slot.revision_ = mesh.revision_;
+    slot.lastUsed_ = frame_;
+    return index;
 }
 
-void Renderer::renderMesh( MeshData& mesh, 
+bool Renderer::isResident( const MeshData& mesh ) const {
+    return std::any_of( resident_.begin( ), resident_.end( ), [&]( const ResidentTimestep& slot ){
+        return slot.revision_ == mesh.revision_ && !slot.mapped_;
+    } );
+}
+
+Renderer::StagingSlot Renderer::mapStaging( size_t numberOfTriangles ){
+
+    checkFormat( );
+    int index = acquireSlot( );
+    ResidentTimestep& slot = resident_[ index ];
+    StagingSlot staging;
+    staging.slot_ = index;
+    staging.numberOfTriangles_ = numberOfTriangles;
+    staging.compact_ = residentCompact_;
+    staging.temperatureRange_ = residentTemperatureRange_;
+
+    void** targets[ 2 ] = { &staging.shadow_, &staging.temperature_ };
+    for ( int k = 0; k < 2; k++ ){
+        size_t bytes = numberOfTriangles * attributeSize( k );
+        state_.bindBuffer( GL_TEXTURE_BUFFER, slot.buffers_[ k ] );
+        state_.bufferData( GL_TEXTURE_BUFFER, bytes, nullptr, GL_STATIC_DRAW );
+        *targets[ k ] = glMapBufferRange(GL_TEXTURE_BUFFER, 0, bytes,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        state_.count( 1 );
+    }
+    slot.mapped_ = true;
+    return staging;
+}
+
+void Renderer::commitStaging( const StagingSlot& staging, uint64_t revision ){
+
+    ResidentTimestep& slot = resident_[ staging.slot_ ];
+    // staged in a format that was switched meanwhile
+    checkFormat( );
+    bool valid = revision != 0 && staging.compact_ == residentCompact_ &&
+        staging.temperatureRange_.min_ == residentTemperatureRange_.min_ &&
+        staging.temperatureRange_.max_ == residentTemperatureRange_.max_;
+    GLenum formats[ 2 ] = { staging.compact_ ? GLenum(GL_R8) : GLenum(GL_R32F), staging.compact_ ? GLenum(GL_R16) : GLenum(GL_R32F) };
+    for ( int k = 0; k < 2; k++ ){
+        state_.bindBuffer( GL_TEXTURE_BUFFER, slot.buffers_[ k ] );
+        // contents of a buffer can get lost while mapped, it is then simply not resident
+        valid = glUnmapBuffer(GL_TEXTURE_BUFFER) == GL_TRUE && valid;
+        state_.bindTexture( 0, GL_TEXTURE_BUFFER, slot.textures_[ k ] );
+        glTexBuffer(GL_TEXTURE_BUFFER, formats[ k ], slot.buffers_[ k ]);
+        state_.count( 2 );
+    }
+    size_t bytes = staging.numberOfTriangles_ * ( staging.compact_ ? sizeof(uint8_t) + sizeof(uint16_t) : 2 * sizeof(float) );
+    // written through the mapping by another thread
+    state_.count( 0, bytes );
+    uploadedBytes_ += bytes;
+
+    slot.mapped_ = false;
+    slot.revision_ = valid ? revision : 0;
+    slot.lastUsed_ = frame_;
+}
+
+void Renderer::beginFrame( ){
+    frame_++;
+    // drop slots beyond a lowered budget, between frames so no viewport loses
+    // a slot another one has bound
+    while ( int( resident_.size( ) ) > std::max( residentTimesteps_, 2 ) && !resident_.back( ).mapped_ ){
+        glDeleteTextures(2, resident_.back( ).textures_);
+        glDeleteBuffers(2, resident_.back( ).buffers_);
+        resident_.pop_back( );
+        state_.invalidate( );
+    }
+}
+
+void Renderer::renderMesh( const MeshData& mesh, 
     const glm::mat4& view, 
     const glm::mat4& projection,
-    const VisualizationMode visualizationMode ){
+    const VisualizationMode visualizationMode,
+    const MeshData* nextMesh,
+    float weight ){
+
+    checkFormat( );
 
-    std::vector< Vertex >& vertices = mesh.vertices_;
-    
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_);
-    glBufferData(GL_ARRAY_BUFFER,
-                 vertices.size() * sizeof(Vertex),
-                 vertices.data(),
-                 GL_DYNAMIC_DRAW);
+    // only attributes can be blended, steps with different geometry snap to the nearest one
+    if ( nextMesh && nextMesh->geometry_ != mesh.geometry_ && !difference_ ){
+        if ( weight >= 0.5f ){
+            renderMesh( *nextMesh, view, projection, visualizationMode );
+        }
+        else {
+            renderMesh( mesh, view, projection, visualizationMode );
+        }
+        return;
+    }
+
+    int attributes, nextAttributes;
+    {
+        ProfileScope scope( profiler_, ProfileStage::UPLOAD );
+        uploadGeometry( *mesh.geometry_ );
+        attributes = residentAttributes( mesh );
+        nextAttributes = nextMesh ? residentAttributes( *nextMesh ) : attributes;
+    }
+    GLsizei numberOfIndices = GLsizei( mesh.geometry_->indices_.size( ) );
+
+    // one query for the level of detail and the single pass overlay
+    GLint viewport[ 4 ];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    state_.count( 1 );
 
-    glUseProgram(shaderProgram_);
+    // a simplified level replaces the index buffer, its triangles fetch the
+    // attributes of the original triangle they stem from
+    int level = selectLevel( *mesh.geometry_, view, projection, float( viewport[ 3 ] ) );
+    drawnLevel_ = level;
+    // stays bound, the element buffer binding is part of it
+    state_.bindVertexArray( VAO_ );
+    state_.bindBuffer( GL_ELEMENT_ARRAY_BUFFER, level >= 0 ? levelBuffers_[ level ].elements_ : EBO_ );
+    if ( level >= 0 ){
+        numberOfIndices = levelBuffers_[ level ].numberOfIndices_;
+    }
 
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram_, "view"), 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram_, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    GLuint textures[ 6 ] = { resident_[ attributes ].textures_[ 0 ], resident_[ attributes ].textures_[ 1 ],
+        resident_[ nextAttributes ].textures_[ 0 ], resident_[ nextAttributes ].textures_[ 1 ],
+        positionTexture_, level >= 0 ? levelBuffers_[ level ].indexTexture_ : indexTexture_ };
+    for ( int unit = 0; unit < 6; unit++ ){
+        state_.bindTexture( unit, GL_TEXTURE_BUFFER, textures[ unit ] );
+    }
+    state_.bindTexture( 6, GL_TEXTURE_2D, difference_ ? colormaps_.texture( differenceColormap_ ) : colormapTexture( visualizationMode ) );
+    state_.bindTexture( 7, GL_TEXTURE_BUFFER, level >= 0 ? levelBuffers_[ level ].triangleTexture_ : 0 );
+    // colormap uploads bind on the active unit, keep it on one the renderer binds no 2D texture to
+    state_.activeTexture( 0 );
+
+    state_.useProgram( shaderProgram_ );
+    state_.uniform( interpolationWeightLocation_, nextMesh ? weight : 0.0f );
+    state_.uniform( differenceLocation_, difference_ ? 1 : 0 );
+    state_.uniform( differenceRangeLocation_, differenceRange_ );
+    state_.uniform( useTriangleMapLocation_, level >= 0 ? 1 : 0 );
+    state_.uniform( temperatureRangeLocation_, glm::vec2( temperatureRange_.min_, temperatureRange_.max_ ) );
+    // dequantization of the compact format, identity for floats
+    state_.uniform( positionOffsetLocation_, positionOffset_ );
+    state_.uniform( positionScaleLocation_, positionScale_ );
+    state_.uniform( positionStrideLocation_, residentCompact_ ? 4 : 3 );
+    if ( residentCompact_ ){
+        state_.uniform( temperatureEncodingLocation_, glm::vec2( residentTemperatureRange_.min_,
+            residentTemperatureRange_.max_ - residentTemperatureRange_.min_ ) );
+    }
+    else {
+        state_.uniform( temperatureEncodingLocation_, glm::vec2( 0.0f, 1.0f ) );
+    }
+    updateCamera( view, projection, glm::vec4( float(viewport[0]), float(viewport[1]), float(viewport[2]), float(viewport[3]) ) );
+
+    const glm::vec4 grey( 0.5f, 0.5f, 0.5f, 1.0f );
+    bool singlePass = wireFrameOverlay_ && singlePassOverlay_ && visualizationMode != VisualizationMode::WIREFRAME;
+    state_.uniform( wireframeWidthLocation_, singlePass ? wireframeWidth_ : 0.0f );
+    if ( singlePass ){
+        state_.uniform( wireframeColorLocation_, grey );
+    }
 
     switch( visualizationMode ){
         case VisualizationMode::WIREFRAME: {
-                
-            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-            glUniform1i(visualizationModeLocation_, int(visualizationMode));
-            glUniform4f(wireframeColorLocation_, 0.5f, 0.5f, 0.5f, 1.0f); // grey
-            glBindVertexArray(VAO_);
-            glDrawArrays(GL_TRIANGLES, 0, vertices.size());
-            glBindVertexArray(0);
+            ProfileScope scope( profiler_, ProfileStage::DRAW );
+            state_.polygonMode( GL_LINE );
+            state_.uniform( visualizationModeLocation_, int(visualizationMode) );
+            state_.uniform( wireframeColorLocation_, grey );
+            state_.drawElements( GL_TRIANGLES, numberOfIndices );
         
             break;
         }
         case VisualizationMode::TEMPERATURE:
         case VisualizationMode::SHADOW: {
             // Filled mode (shadow or temperature)
-            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-            glUniform1i(visualizationModeLocation_, int(visualizationMode));
-            glBindVertexArray(VAO_);
-            glDrawArrays(GL_TRIANGLES, 0, vertices.size());
-            glBindVertexArray(0);
+            {
+                ProfileScope scope( profiler_, ProfileStage::DRAW );
+                state_.polygonMode( GL_FILL );
+                state_.uniform( visualizationModeLocation_, int(visualizationMode) );
+                state_.drawElements( GL_TRIANGLES, numberOfIndices );
+            }
         
-            if ( wireFrameOverlay_ ) {
-                glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-                glEnable(GL_POLYGON_OFFSET_LINE);
-                glPolygonOffset(-1.0f, -1.0f);
+            // legacy overlay, the whole mesh again as lines
+            if ( wireFrameOverlay_ && !singlePassOverlay_ ) {
+                ProfileScope scope( profiler_, ProfileStage::OVERLAY );
+                state_.polygonMode( GL_LINE );
+                state_.enable( GL_POLYGON_OFFSET_LINE, true );
+                state_.polygonOffset( -1.0f, -1.0f );
             
-                glUniform1i(visualizationModeLocation_, int(VisualizationMode::WIREFRAME));
-                glUniform4f(wireframeColorLocation_, 0.5f, 0.5f, 0.5f, 1.0f);
-                glBindVertexArray(VAO_);
-                glDrawArrays(GL_TRIANGLES, 0, vertices.size());
-                glBindVertexArray(0);
+                state_.uniform( visualizationModeLocation_, int(VisualizationMode::WIREFRAME) );
+                state_.uniform( wireframeColorLocation_, grey );
+                state_.drawElements( GL_TRIANGLES, numberOfIndices );
             
-                glDisable(GL_POLYGON_OFFSET_LINE);
+                state_.enable( GL_POLYGON_OFFSET_LINE, false );
             }
             break;
         }
     }
-}
\ No newline at end of file
+}
+
+void Renderer::updateCamera( const glm::mat4& view, const glm::mat4& projection, const glm::vec4& viewport ){
+    CameraBlock camera{ view, projection, viewport };
+    if ( cameraValid_ && std::memcmp( &camera, &camera_, sizeof( CameraBlock ) ) == 0 ){
+        return;
+    }
+    state_.bindBuffer( GL_UNIFORM_BUFFER, cameraBuffer_ );
+    state_.bufferSubData( GL_UNIFORM_BUFFER, 0, sizeof( CameraBlock ), &camera );
+    camera_ = camera;
+    cameraValid_ = true;
+}
+
+void Renderer::renderDifference( const MeshData& mesh,
+    const MeshData& reference,
+    const glm::mat4& view,
+    const glm::mat4& projection,
+    const VisualizationMode visualizationMode,
+    float range ){
+
+    if ( mesh.numberOfTriangles( ) != reference.numberOfTriangles( ) ){
+        throw std::runtime_error( "Error, the difference view needs timesteps with the same triangles!" );
+    }
+    // the reference takes the place of the next timestep, drawn with the geometry of mesh
+    difference_ = true;
+    differenceRange_ = std::max( range, 1e-6f );
+    renderMesh( mesh, view, projection, visualizationMode, &reference, 0.0f );
+    difference_ = false;
+}